@@ -1,43 +1,148 @@
 #include "accelerator.h"
 
+#include "cpu/image/image_mixer.h"
 #include "ogl/image/image_mixer.h"
 #include "ogl/util/device.h"
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <common/bit_depth.hpp>
+#include <common/env.h>
+#include <common/except.h>
 
 #include <core/mixer/image/image_mixer.h>
 
+#include <future>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace caspar { namespace accelerator {
 
+enum class backend
+{
+    ogl,
+    cpu,
+};
+
+backend get_backend()
+{
+    auto name = env::properties().get(L"configuration.accelerator.backend", L"ogl");
+    if (name == L"ogl") {
+        return backend::ogl;
+    }
+    if (name == L"cpu") {
+        return backend::cpu;
+    }
+    CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid accelerator backend: " + name));
+}
+
+int get_device_count()
+{
+    auto count = env::properties().get(L"configuration.accelerator.devices", 1);
+    if (count < 1) {
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid accelerator devices: " + std::to_wstring(count)));
+    }
+    return count;
+}
+
+// Reports and collects the devices as one, for the GL INFO and GL GC commands.
+class device_group : public accelerator_device
+{
+    std::vector<std::shared_ptr<ogl::device>> devices_;
+
+  public:
+    explicit device_group(std::vector<std::shared_ptr<ogl::device>> devices)
+        : devices_(std::move(devices))
+    {
+    }
+
+    boost::property_tree::wptree info() const override
+    {
+        boost::property_tree::wptree info;
+        for (auto& device : devices_) {
+            info.add_child(L"devices.device", device->info());
+        }
+        return info;
+    }
+
+    std::future<void> gc() override
+    {
+        std::vector<std::future<void>> futures;
+        for (auto& device : devices_) {
+            futures.push_back(device->gc());
+        }
+        return std::async(std::launch::deferred, [futures = std::move(futures)]() mutable {
+            for (auto& future : futures) {
+                future.get();
+            }
+        });
+    }
+};
+
 struct accelerator::impl
 {
-    std::shared_ptr<ogl::device>        ogl_device_;
-    const core::video_format_repository format_repository_;
+    const backend                             backend_ = get_backend();
+    std::vector<std::shared_ptr<ogl::device>> ogl_devices_;
+    std::shared_ptr<accelerator_device>       ogl_device_group_;
+    int                                       next_device_ = 0;
+    const core::video_format_repository       format_repository_;
 
     impl(const core::video_format_repository format_repository)
         : format_repository_(format_repository)
     {
     }
 
-    std::unique_ptr<core::image_mixer> create_image_mixer(int channel_id, common::bit_depth depth)
+    std::unique_ptr<core::image_mixer> create_image_mixer(int channel_id, common::bit_depth depth, int device_index)
     {
+        if (backend_ == backend::cpu) {
+            return std::make_unique<cpu::image_mixer>(channel_id, depth);
+        }
+
+        auto& devices = get_devices();
+        if (device_index < 0 || device_index > static_cast<int>(devices.size())) {
+            CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid accelerator device " +
+                                                            std::to_wstring(device_index) + L" for channel " +
+                                                            std::to_wstring(channel_id)));
+        }
+
+        // Channels which don't ask for a device are spread over the devices in turn, so that their GL work is
+        // submitted from as many threads as there are devices.
+        auto& device = device_index > 0 ? devices[device_index - 1] : devices[next_device_++ % devices.size()];
+
         return std::make_unique<ogl::image_mixer>(
-            spl::make_shared_ptr(get_device()), channel_id, format_repository_.get_max_video_format_size(), depth);
+            spl::make_shared_ptr(device), channel_id, format_repository_.get_max_video_format_size(), depth);
     }
 
-    std::shared_ptr<ogl::device> get_device()
+    std::vector<std::shared_ptr<ogl::device>>& get_devices()
     {
-        if (!ogl_device_) {
-            ogl_device_ = std::make_shared<ogl::device>();
+        if (ogl_devices_.empty()) {
+            for (int n = get_device_count(); n > 0; --n) {
+                ogl_devices_.push_back(std::make_shared<ogl::device>());
+            }
         }
 
-        return ogl_device_;
+        return ogl_devices_;
+    }
+
+    std::shared_ptr<accelerator_device> get_device()
+    {
+        if (backend_ == backend::cpu) {
+            return nullptr;
+        }
+
+        auto& devices = get_devices();
+        if (devices.size() == 1) {
+            return devices.front();
+        }
+
+        if (!ogl_device_group_) {
+            ogl_device_group_ = std::make_shared<device_group>(devices);
+        }
+
+        return ogl_device_group_;
     }
 };
 
@@ -48,14 +153,12 @@ accelerator::accelerator(const core::video_format_repository format_repository)
 
 accelerator::~accelerator() {}
 
-std::unique_ptr<core::image_mixer> accelerator::create_image_mixer(const int channel_id, common::bit_depth depth)
+std::unique_ptr<core::image_mixer>
+accelerator::create_image_mixer(const int channel_id, common::bit_depth depth, int device_index)
 {
-    return impl_->create_image_mixer(channel_id, depth);
+    return impl_->create_image_mixer(channel_id, depth, device_index);
 }
 
-std::shared_ptr<accelerator_device> accelerator::get_device() const
-{
-    return std::dynamic_pointer_cast<accelerator_device>(impl_->get_device());
-}
+std::shared_ptr<accelerator_device> accelerator::get_device() const { return impl_->get_device(); }
 
 }} // namespace caspar::accelerator
@@ -30,8 +30,11 @@ class accelerator
 
     accelerator& operator=(accelerator&) = delete;
 
-    std::unique_ptr<caspar::core::image_mixer> create_image_mixer(int channel_id, common::bit_depth depth);
+    // Mixes the channel on the given device, counted from 1, see <accelerator><devices>. 0 picks the devices in turn.
+    std::unique_ptr<caspar::core::image_mixer>
+    create_image_mixer(int channel_id, common::bit_depth depth, int device_index = 0);
 
+    // Returns every device as one, or nullptr if the backend has no device.
     std::shared_ptr<accelerator_device> get_device() const;
 
   private:
@@ -0,0 +1,1423 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined(USE_SIMDE)
+#define SIMDE_ENABLE_NATIVE_ALIASES
+#include <simde/x86/avx2.h>
+#define CASPAR_CPU_KERNEL_AVX2
+#elif defined(__AVX2__) || defined(_MSC_VER)
+// MSVC provides the intrinsics without /arch:AVX2, which __AVX2__ depends on, as in audio_mixer.cpp.
+#include <immintrin.h>
+#define CASPAR_CPU_KERNEL_AVX2
+#endif
+
+#include "image_kernel.h"
+
+#include <common/assert.h>
+
+#include <core/frame/frame_transform.h>
+
+#include <tbb/blocked_range2d.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// The functions below follow shader.frag of the OpenGL mixer, and are kept in the same order. Like the shader, colors
+// are b, g, r, a ordered while they are processed.
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+namespace {
+
+const double epsilon = 0.001;
+
+// The target is drawn in parallel, in tiles of about this many pixels.
+const int tile_width  = 64;
+const int tile_height = 16;
+
+using vec3 = std::array<float, 3>;
+using vec4 = std::array<float, 4>;
+
+float clamp01(float value) { return std::min(std::max(value, 0.0f), 1.0f); }
+
+float mix(float x, float y, float a) { return x * (1.0f - a) + y * a; }
+
+float fract(float x) { return x - std::floor(x); }
+
+float smoothstep(float edge0, float edge1, float x)
+{
+    auto t = clamp01((x - edge0) / (edge1 - edge0));
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// The uniforms of the image shader.
+struct shader_params
+{
+    int   pixel_format;
+    int   blend_mode;
+    int   keyer;
+    bool  is_straight_alpha;
+    float color_matrix[9];
+    vec3  luma_coeff;
+    float opacity;
+    bool  invert;
+    bool  levels;
+    float min_input;
+    float max_input;
+    float gamma;
+    float min_output;
+    float max_output;
+    float precision_factor[4];
+    bool  csb;
+    float brt;
+    float sat;
+    float con;
+    bool  chroma;
+    bool  chroma_show_mask;
+    float chroma_target_hue;
+    float chroma_hue_width;
+    float chroma_min_saturation;
+    float chroma_min_brightness;
+    float chroma_softness;
+    float chroma_spill_suppress;
+    float chroma_spill_suppress_saturation;
+};
+
+// A texture as the image shader samples it: with bilinear filtering, clamped to its edges.
+struct texture_view
+{
+    enum class type
+    {
+        u8,
+        u16,
+        f32,
+    };
+
+    const void* data   = nullptr;
+    std::size_t size   = 0; // In bytes.
+    int         width  = 0;
+    int         height = 0;
+    int         stride = 0;
+    type        format = type::u8;
+
+    float value(std::size_t index) const
+    {
+        switch (format) {
+            case type::u8:
+                return static_cast<const std::uint8_t*>(data)[index] * (1.0f / 255.0f);
+            case type::u16:
+                return static_cast<const std::uint16_t*>(data)[index] * (1.0f / 65535.0f);
+            default:
+                return static_cast<const float*>(data)[index];
+        }
+    }
+
+    // Returns texel x, y as OpenGL does for the formats textures are uploaded with: RED, RG, BGR and BGRA.
+    vec4 fetch(int x, int y) const
+    {
+        auto  index = (static_cast<std::size_t>(y) * width + x) * stride;
+        float m[4]  = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int n = 0; n < stride; ++n) {
+            m[n] = value(index + n);
+        }
+
+        switch (stride) {
+            case 1:
+                return {m[0], 0.0f, 0.0f, 1.0f};
+            case 2:
+                return {m[0], m[1], 0.0f, 1.0f};
+            case 3:
+                return {m[2], m[1], m[0], 1.0f};
+            default:
+                return {m[2], m[1], m[0], m[3]};
+        }
+    }
+
+    vec4 sample(float s, float t) const
+    {
+        auto u  = s * static_cast<float>(width) - 0.5f;
+        auto v  = t * static_cast<float>(height) - 0.5f;
+        auto fu = std::floor(u);
+        auto fv = std::floor(v);
+        auto fx = u - fu;
+        auto fy = v - fv;
+
+        auto x0 = std::min(std::max(static_cast<int>(fu), 0), width - 1);
+        auto x1 = std::min(std::max(static_cast<int>(fu) + 1, 0), width - 1);
+        auto y0 = std::min(std::max(static_cast<int>(fv), 0), height - 1);
+        auto y1 = std::min(std::max(static_cast<int>(fv) + 1, 0), height - 1);
+
+        auto a = fetch(x0, y0);
+        auto b = fetch(x1, y0);
+        auto c = fetch(x0, y1);
+        auto d = fetch(x1, y1);
+
+        vec4 result;
+        for (int n = 0; n < 4; ++n) {
+            result[n] = mix(mix(a[n], b[n], fx), mix(c[n], d[n], fx), fy);
+        }
+        return result;
+    }
+};
+
+texture_view view(const surface& surface)
+{
+    return texture_view{surface.data.data(),
+                        surface.data.size() * sizeof(float),
+                        surface.width,
+                        surface.height,
+                        surface.channels,
+                        texture_view::type::f32};
+}
+
+vec4 bgra(const vec4& c) { return {c[2], c[1], c[0], c[3]}; }
+
+/*
+** Contrast, saturation, brightness
+*/
+
+vec3 contrast_saturation_brightness(vec4 color, const shader_params& p)
+{
+    const vec3 lum_coeff = {p.luma_coeff[2], p.luma_coeff[1], p.luma_coeff[0]};
+
+    if (color[3] > 0.0f) {
+        for (int n = 0; n < 3; ++n)
+            color[n] /= color[3];
+    }
+
+    vec3 brt_color;
+    for (int n = 0; n < 3; ++n)
+        brt_color[n] = color[n] * p.brt;
+
+    auto intensity = brt_color[0] * lum_coeff[0] + brt_color[1] * lum_coeff[1] + brt_color[2] * lum_coeff[2];
+
+    vec3 con_color;
+    for (int n = 0; n < 3; ++n)
+        con_color[n] = mix(0.5f, mix(intensity, brt_color[n], p.sat), p.con) * color[3];
+
+    return con_color;
+}
+
+/*
+** Levels control
+*/
+
+vec3 levels_control(const vec3& color, const shader_params& p)
+{
+    vec3 result;
+    for (int n = 0; n < 3; ++n) {
+        auto input = std::min(std::max(color[n] - p.min_input, 0.0f) / (p.max_input - p.min_input), 1.0f);
+        result[n]  = mix(p.min_output, p.max_output, std::pow(input, 1.0f / p.gamma));
+    }
+    return result;
+}
+
+/*
+** Hue, saturation, luminance
+*/
+
+vec3 rgb_to_hsl(const vec3& color)
+{
+    vec3 hsl;
+
+    auto fmin  = std::min(std::min(color[0], color[1]), color[2]);
+    auto fmax  = std::max(std::max(color[0], color[1]), color[2]);
+    auto delta = fmax - fmin;
+
+    hsl[2] = (fmax + fmin) / 2.0f;
+
+    if (delta == 0.0f) {
+        hsl[0] = 0.0f;
+        hsl[1] = 0.0f;
+    } else {
+        if (hsl[2] < 0.5f)
+            hsl[1] = delta / (fmax + fmin);
+        else
+            hsl[1] = delta / (2.0f - fmax - fmin);
+
+        auto delta_r = (((fmax - color[0]) / 6.0f) + (delta / 2.0f)) / delta;
+        auto delta_g = (((fmax - color[1]) / 6.0f) + (delta / 2.0f)) / delta;
+        auto delta_b = (((fmax - color[2]) / 6.0f) + (delta / 2.0f)) / delta;
+
+        hsl[0] = 0.0f;
+        if (color[0] == fmax)
+            hsl[0] = delta_b - delta_g;
+        else if (color[1] == fmax)
+            hsl[0] = (1.0f / 3.0f) + delta_r - delta_b;
+        else if (color[2] == fmax)
+            hsl[0] = (2.0f / 3.0f) + delta_g - delta_r;
+
+        if (hsl[0] < 0.0f)
+            hsl[0] += 1.0f;
+        else if (hsl[0] > 1.0f)
+            hsl[0] -= 1.0f;
+    }
+
+    return hsl;
+}
+
+float hue_to_rgb(float f1, float f2, float hue)
+{
+    if (hue < 0.0f)
+        hue += 1.0f;
+    else if (hue > 1.0f)
+        hue -= 1.0f;
+
+    if ((6.0f * hue) < 1.0f)
+        return f1 + (f2 - f1) * 6.0f * hue;
+    if ((2.0f * hue) < 1.0f)
+        return f2;
+    if ((3.0f * hue) < 2.0f)
+        return f1 + (f2 - f1) * ((2.0f / 3.0f) - hue) * 6.0f;
+    return f1;
+}
+
+vec3 hsl_to_rgb(const vec3& hsl)
+{
+    if (hsl[1] == 0.0f)
+        return {hsl[2], hsl[2], hsl[2]};
+
+    auto f2 = hsl[2] < 0.5f ? hsl[2] * (1.0f + hsl[1]) : (hsl[2] + hsl[1]) - (hsl[1] * hsl[2]);
+    auto f1 = 2.0f * hsl[2] - f2;
+
+    return {hue_to_rgb(f1, f2, hsl[0] + (1.0f / 3.0f)),
+            hue_to_rgb(f1, f2, hsl[0]),
+            hue_to_rgb(f1, f2, hsl[0] - (1.0f / 3.0f))};
+}
+
+/*
+** Float blending modes
+*/
+
+float blend_add(float base, float blend) { return std::min(base + blend, 1.0f); }
+float blend_subtract(float base, float blend) { return std::max(base + blend - 1.0f, 0.0f); }
+float blend_lighten(float base, float blend) { return std::max(blend, base); }
+float blend_darken(float base, float blend) { return std::min(blend, base); }
+float blend_linear_light(float base, float blend)
+{
+    return blend < 0.5f ? blend_subtract(base, 2.0f * blend) : blend_add(base, 2.0f * (blend - 0.5f));
+}
+float blend_screen(float base, float blend) { return 1.0f - ((1.0f - base) * (1.0f - blend)); }
+float blend_overlay(float base, float blend)
+{
+    return base < 0.5f ? (2.0f * base * blend) : (1.0f - 2.0f * (1.0f - base) * (1.0f - blend));
+}
+float blend_color_dodge(float base, float blend)
+{
+    return blend == 1.0f ? blend : std::min(base / (1.0f - blend), 1.0f);
+}
+float blend_color_burn(float base, float blend)
+{
+    return blend == 0.0f ? blend : std::max((1.0f - ((1.0f - base) / blend)), 0.0f);
+}
+float blend_vivid_light(float base, float blend)
+{
+    return blend < 0.5f ? blend_color_burn(base, 2.0f * blend) : blend_color_dodge(base, 2.0f * (blend - 0.5f));
+}
+float blend_pin_light(float base, float blend)
+{
+    return blend < 0.5f ? blend_darken(base, 2.0f * blend) : blend_lighten(base, 2.0f * (blend - 0.5f));
+}
+float blend_hard_mix(float base, float blend) { return blend_vivid_light(base, blend) < 0.5f ? 0.0f : 1.0f; }
+float blend_reflect(float base, float blend)
+{
+    return blend == 1.0f ? blend : std::min(base * base / (1.0f - blend), 1.0f);
+}
+
+template <typename Func>
+vec3 blend_each(const vec3& base, const vec3& blend, Func&& func)
+{
+    return {func(base[0], blend[0]), func(base[1], blend[1]), func(base[2], blend[2])};
+}
+
+vec3 blend_hue(const vec3& base, const vec3& blend)
+{
+    auto base_hsl = rgb_to_hsl(base);
+    return hsl_to_rgb({rgb_to_hsl(blend)[0], base_hsl[1], base_hsl[2]});
+}
+
+vec3 blend_saturation(const vec3& base, const vec3& blend)
+{
+    auto base_hsl = rgb_to_hsl(base);
+    return hsl_to_rgb({base_hsl[0], rgb_to_hsl(blend)[1], base_hsl[2]});
+}
+
+vec3 blend_color(const vec3& base, const vec3& blend)
+{
+    auto blend_hsl = rgb_to_hsl(blend);
+    return hsl_to_rgb({blend_hsl[0], blend_hsl[1], rgb_to_hsl(base)[2]});
+}
+
+vec3 blend_luminosity(const vec3& base, const vec3& blend)
+{
+    auto base_hsl = rgb_to_hsl(base);
+    return hsl_to_rgb({base_hsl[0], base_hsl[1], rgb_to_hsl(blend)[2]});
+}
+
+/*
+** Chroma keying
+*/
+
+float alpha_map(float d, const shader_params& p) { return 1.0f - smoothstep(1.0f, p.chroma_softness, d); }
+
+vec3 rgb2hsv(const vec3& c)
+{
+    const vec4 k = {0.0f, -1.0f / 3.0f, 2.0f / 3.0f, -1.0f};
+
+    auto p = c[1] >= c[2] ? vec4{c[1], c[2], k[0], k[1]} : vec4{c[2], c[1], k[3], k[2]};
+    auto q = c[0] >= p[0] ? vec4{c[0], p[1], p[2], p[0]} : vec4{p[0], p[1], p[3], c[0]};
+
+    auto d = q[0] - std::min(q[3], q[1]);
+    auto e = 1.0e-10f;
+    return {std::abs(q[2] + (q[3] - q[1]) / (6.0f * d + e)), d / (q[0] + e), q[0]};
+}
+
+vec3 hsv2rgb(const vec3& c)
+{
+    const vec4 k = {1.0f, 2.0f / 3.0f, 1.0f / 3.0f, 3.0f};
+
+    vec3 result;
+    for (int n = 0; n < 3; ++n) {
+        auto p    = std::abs(fract(c[0] + k[n]) * 6.0f - k[3]);
+        result[n] = c[2] * mix(k[0], clamp01(p - k[0]), c[1]);
+    }
+    return result;
+}
+
+float angle_diff(float angle1, float angle2) { return 0.5f - std::abs(std::abs(angle1 - angle2) - 0.5f); }
+
+float angle_diff_directional(float angle1, float angle2)
+{
+    auto diff = angle1 - angle2;
+    return diff < -0.5f ? diff + 1.0f : (diff > 0.5f ? diff - 1.0f : diff);
+}
+
+float distance(float actual, float target) { return std::min(0.0f, target - actual); }
+
+float color_distance(const vec3& hsv, const shader_params& p)
+{
+    auto hue_diff        = angle_diff(hsv[0], p.chroma_target_hue) * 2.0f;
+    auto saturation_diff = distance(hsv[1], p.chroma_min_saturation);
+    auto brightness_diff = distance(hsv[2], p.chroma_min_brightness);
+
+    auto saturation_brightness_score = std::max(brightness_diff, saturation_diff);
+    auto hue_score                   = hue_diff - p.chroma_hue_width;
+
+    return -hue_score * saturation_brightness_score;
+}
+
+vec3 supress_spill(vec3 c, const shader_params& p)
+{
+    auto hue  = c[0];
+    auto diff = angle_diff_directional(hue, p.chroma_target_hue);
+    auto dist = std::abs(diff) / p.chroma_spill_suppress;
+
+    if (dist < 1.0f) {
+        c[0] = diff < 0.0f ? p.chroma_target_hue - p.chroma_spill_suppress
+                           : p.chroma_target_hue + p.chroma_spill_suppress;
+        c[1] *= std::min(1.0f, dist + p.chroma_spill_suppress_saturation);
+    }
+
+    return c;
+}
+
+// Takes and returns r, g, b, a.
+vec4 chroma_on_custom_color(const vec4& c, const shader_params& p)
+{
+    auto hsv   = rgb2hsv({c[0], c[1], c[2]});
+    auto d     = color_distance(hsv, p) * -2.0f + 1.0f;
+    auto rgb   = hsv2rgb(supress_spill(hsv, p));
+    auto alpha = alpha_map(d, p);
+
+    vec4 suppressed = {rgb[0] * alpha, rgb[1] * alpha, rgb[2] * alpha, alpha};
+
+    return p.chroma_show_mask ? vec4{suppressed[3], suppressed[3], suppressed[3], 1.0f} : suppressed;
+}
+
+vec3 get_blend_color(const vec3& back, const vec3& fore, int blend_mode)
+{
+    switch (blend_mode) {
+        case 0:
+            return fore;
+        case 1:
+            return blend_each(back, fore, blend_lighten);
+        case 2:
+            return blend_each(back, fore, blend_darken);
+        case 3:
+            return blend_each(back, fore, [](float base, float blend) { return base * blend; });
+        case 4:
+            return blend_each(back, fore, [](float base, float blend) { return (base + blend) / 2.0f; });
+        case 5:
+            return blend_each(back, fore, blend_add);
+        case 6:
+            return blend_each(back, fore, blend_subtract);
+        case 7:
+            return blend_each(back, fore, [](float base, float blend) { return std::abs(base - blend); });
+        case 8:
+            return blend_each(
+                back, fore, [](float base, float blend) { return 1.0f - std::abs(1.0f - base - blend); });
+        case 9:
+            return blend_each(
+                back, fore, [](float base, float blend) { return base + blend - 2.0f * base * blend; });
+        case 10:
+            return blend_each(back, fore, blend_screen);
+        case 11:
+            return blend_each(back, fore, blend_overlay);
+        case 13:
+            return blend_each(fore, back, blend_overlay);
+        case 14:
+            return blend_each(back, fore, blend_color_dodge);
+        case 15:
+            return blend_each(back, fore, blend_color_burn);
+        case 16:
+            return blend_each(back, fore, blend_add);
+        case 17:
+            return blend_each(back, fore, blend_subtract);
+        case 18:
+            return blend_each(back, fore, blend_linear_light);
+        case 19:
+            return blend_each(back, fore, blend_vivid_light);
+        case 20:
+            return blend_each(back, fore, blend_pin_light);
+        case 21:
+            return blend_each(back, fore, blend_hard_mix);
+        case 22:
+            return blend_each(back, fore, blend_reflect);
+        case 23:
+            return blend_each(fore, back, blend_reflect);
+        case 24:
+            return blend_each(back, fore, [](float base, float blend) {
+                return std::min(base, blend) - std::max(base, blend) + 1.0f;
+            });
+        case 25:
+            return blend_hue(back, fore);
+        case 26:
+            return blend_saturation(back, fore);
+        case 27:
+            return blend_color(back, fore);
+        case 28:
+            return blend_luminosity(back, fore);
+    }
+    return fore;
+}
+
+vec4 blend(vec4 fore, const vec4& back, const shader_params& p)
+{
+    if (p.blend_mode != 0) {
+        auto color = get_blend_color({back[0] / (back[3] + 0.0000001f),
+                                      back[1] / (back[3] + 0.0000001f),
+                                      back[2] / (back[3] + 0.0000001f)},
+                                     {fore[0] / (fore[3] + 0.0000001f),
+                                      fore[1] / (fore[3] + 0.0000001f),
+                                      fore[2] / (fore[3] + 0.0000001f)},
+                                     p.blend_mode);
+        for (int n = 0; n < 3; ++n)
+            fore[n] = color[n] * fore[3];
+    }
+
+    vec4 result;
+    for (int n = 0; n < 4; ++n)
+        result[n] = p.keyer == 1 ? fore[n] + back[n] : fore[n] + (1.0f - fore[3]) * back[n];
+    return result;
+}
+
+vec4 ycbcra_to_rgba(float y, float cb, float cr, float a, const shader_params& p)
+{
+    const float luma_coefficient   = 255.0f / 219.0f;
+    const float chroma_coefficient = 255.0f / 224.0f;
+
+    const vec3 ycbcr = {(y * 255.0f - 16.0f) * luma_coefficient,
+                        (cb * 255.0f - 128.0f) * chroma_coefficient,
+                        (cr * 255.0f - 128.0f) * chroma_coefficient};
+
+    vec3 rgb;
+    for (int n = 0; n < 3; ++n) {
+        rgb[n] = (p.color_matrix[n * 3 + 0] * ycbcr[0] + p.color_matrix[n * 3 + 1] * ycbcr[1] +
+                  p.color_matrix[n * 3 + 2] * ycbcr[2]) /
+                 255.0f;
+    }
+
+    return {rgb[2], rgb[1], rgb[0], a};
+}
+
+vec4 get_rgba_color(const std::array<texture_view, 4>& plane, float s, float t, const shader_params& p)
+{
+    const auto& pf = p.precision_factor;
+
+    switch (p.pixel_format) {
+        case 0: // gray
+        {
+            auto r = plane[0].sample(s, t)[0] * pf[0];
+            return {r, r, r, 1.0f};
+        }
+        case 1: // bgra
+        {
+            auto c = plane[0].sample(s, t);
+            return {c[2] * pf[0], c[1] * pf[0], c[0] * pf[0], c[3] * pf[0]};
+        }
+        case 2: // rgba
+        {
+            auto c = plane[0].sample(s, t);
+            return {c[0] * pf[0], c[1] * pf[0], c[2] * pf[0], c[3] * pf[0]};
+        }
+        case 3: // argb
+        {
+            auto c = plane[0].sample(s, t);
+            return {c[3] * pf[0], c[0] * pf[0], c[1] * pf[0], c[2] * pf[0]};
+        }
+        case 4: // abgr
+        {
+            auto c = plane[0].sample(s, t);
+            return {c[1] * pf[0], c[2] * pf[0], c[3] * pf[0], c[0] * pf[0]};
+        }
+        case 5: // ycbcr
+        {
+            auto y  = plane[0].sample(s, t)[0] * pf[0];
+            auto cb = plane[1].sample(s, t)[0] * pf[1];
+            auto cr = plane[2].sample(s, t)[0] * pf[2];
+            return ycbcra_to_rgba(y, cb, cr, 1.0f, p);
+        }
+        case 6: // ycbcra
+        {
+            auto y  = plane[0].sample(s, t)[0] * pf[0];
+            auto cb = plane[1].sample(s, t)[0] * pf[1];
+            auto cr = plane[2].sample(s, t)[0] * pf[2];
+            auto a  = plane[3].sample(s, t)[0] * pf[3];
+            return ycbcra_to_rgba(y, cb, cr, a, p);
+        }
+        case 7: // luma
+        {
+            auto y = (plane[0].sample(s, t)[0] * pf[0] - 0.065f) / 0.859f;
+            return {y, y, y, 1.0f};
+        }
+        case 8: // bgr
+        {
+            auto c = plane[0].sample(s, t);
+            return {c[2] * pf[0], c[1] * pf[0], c[0] * pf[0], 1.0f};
+        }
+        case 9: // rgb
+        {
+            auto c = plane[0].sample(s, t);
+            return {c[0] * pf[0], c[1] * pf[0], c[2] * pf[0], 1.0f};
+        }
+        case 10: // uyvy
+        {
+            auto c0 = plane[0].sample(s, t);
+            auto c1 = plane[1].sample(s, t);
+            return ycbcra_to_rgba(c0[1] * pf[0], c1[2] * pf[1], c1[0] * pf[1], 1.0f, p);
+        }
+        case 11: // gbrp
+        {
+            auto g = plane[0].sample(s, t)[0] * pf[0];
+            auto b = plane[1].sample(s, t)[0] * pf[1];
+            auto r = plane[2].sample(s, t)[0] * pf[2];
+            return {b, g, r, 1.0f};
+        }
+        case 12: // gbrap
+        {
+            auto g = plane[0].sample(s, t)[0] * pf[0];
+            auto b = plane[1].sample(s, t)[0] * pf[1];
+            auto r = plane[2].sample(s, t)[0] * pf[2];
+            auto a = plane[3].sample(s, t)[0] * pf[3];
+            return {b, g, r, a};
+        }
+    }
+    return {0.0f, 0.0f, 0.0f, 0.0f};
+}
+
+// Returns the key value of pixel x, y. Keys are always the size of the target.
+float key_value(const surface& key, int x, int y)
+{
+    return key.data[(static_cast<std::size_t>(y) * key.width + x) * key.channels + (key.channels == 4 ? 2 : 0)];
+}
+
+// The chroma key, levels and contrast, saturation and brightness, in the order the shader applies them.
+void correct(vec4& color, const shader_params& p)
+{
+    if (p.chroma) {
+        color = bgra(chroma_on_custom_color(bgra(color), p));
+    }
+    if (p.levels) {
+        auto rgb = levels_control({color[0], color[1], color[2]}, p);
+        std::copy(rgb.begin(), rgb.end(), color.begin());
+    }
+    if (p.csb) {
+        auto rgb = contrast_saturation_brightness(color, p);
+        std::copy(rgb.begin(), rgb.end(), color.begin());
+    }
+}
+
+vec4 shade(const std::array<texture_view, 4>& plane,
+           float                              s,
+           float                              t,
+           int                                x,
+           int                                y,
+           const draw_params&                 params,
+           const shader_params&               p)
+{
+    auto color = get_rgba_color(plane, s, t, p);
+    if (p.is_straight_alpha) {
+        for (int n = 0; n < 3; ++n)
+            color[n] *= color[3];
+    }
+    correct(color, p);
+    if (params.local_key) {
+        auto key = key_value(*params.local_key, x, y);
+        for (auto& c : color)
+            c *= key;
+    }
+    if (params.layer_key) {
+        auto key = key_value(*params.layer_key, x, y);
+        for (auto& c : color)
+            c *= key;
+    }
+    for (auto& c : color)
+        c *= p.opacity;
+    if (p.invert) {
+        for (auto& c : color)
+            c = 1.0f - c;
+    }
+    return color;
+}
+
+double get_precision_factor(common::bit_depth depth)
+{
+    switch (depth) {
+        case common::bit_depth::bit8:
+            return 1.0;
+        case common::bit_depth::bit10:
+            return 64.0;
+        case common::bit_depth::bit12:
+            return 16.0;
+        case common::bit_depth::bit16:
+            return 1.0;
+        default:
+            return 1.0;
+    }
+}
+
+bool is_outside_screen(const std::vector<core::frame_geometry::coord>& coords)
+{
+    auto all = [&](auto&& pred) { return std::all_of(coords.begin(), coords.end(), pred); };
+    return all([](const auto& c) { return c.vertex_x < 0.0; }) || all([](const auto& c) { return c.vertex_x > 1.0; }) ||
+           all([](const auto& c) { return c.vertex_y < 0.0; }) || all([](const auto& c) { return c.vertex_y > 1.0; });
+}
+
+shader_params get_shader_params(const draw_params& params, const ogl::draw_transforms& transforms)
+{
+    const auto& image_transform = transforms.image_transform;
+
+    shader_params p{};
+    p.pixel_format      = static_cast<int>(params.pix_desc.format);
+    p.blend_mode        = static_cast<int>(image_transform.is_key ? core::blend_mode::normal : params.blend_mode);
+    p.keyer             = static_cast<int>(params.keyer);
+    p.is_straight_alpha = params.pix_desc.is_straight_alpha;
+
+    const auto is_hd       = params.pix_desc.planes.at(0).height > 700;
+    const auto color_space = is_hd ? params.pix_desc.color_space : core::color_space::bt601;
+
+    const float color_matrices[3][9] = {
+        {1.0, 0.0, 1.402, 1.0, -0.344, -0.509, 1.0, 1.772, 0.0},                          // bt.601
+        {1.0, 0.0, 1.5748, 1.0, -0.1873, -0.4681, 1.0, 1.8556, 0.0},                      // bt.709
+        {1.0, 0.0, 1.4746, 1.0, -0.16455312684366, -0.57135312684366, 1.0, 1.8814, 0.0}}; // bt.2020
+    const float luma_coefficients[3][3] = {{0.299f, 0.587f, 0.114f},     // bt.601
+                                           {0.2126f, 0.7152f, 0.0722f},  // bt.709
+                                           {0.2627f, 0.6780f, 0.0593f}}; // bt.2020
+
+    std::copy_n(color_matrices[static_cast<int>(color_space)], 9, p.color_matrix);
+    std::copy_n(luma_coefficients[static_cast<int>(color_space)], 3, p.luma_coeff.begin());
+
+    for (int n = 0; n < 4; ++n) {
+        p.precision_factor[n] = 1.0f;
+    }
+    for (int n = 0; n < static_cast<int>(params.pix_desc.planes.size()) && n < 4; ++n) {
+        p.precision_factor[n] =
+            params.source ? 1.0f : static_cast<float>(get_precision_factor(params.pix_desc.planes[n].depth));
+    }
+
+    p.opacity = static_cast<float>(image_transform.is_key ? 1.0 : image_transform.opacity);
+    p.invert  = image_transform.invert;
+
+    p.chroma = image_transform.chroma.enable;
+    if (p.chroma) {
+        p.chroma_show_mask                 = image_transform.chroma.show_mask;
+        p.chroma_target_hue                = static_cast<float>(image_transform.chroma.target_hue / 360.0);
+        p.chroma_hue_width                 = static_cast<float>(image_transform.chroma.hue_width);
+        p.chroma_min_saturation            = static_cast<float>(image_transform.chroma.min_saturation);
+        p.chroma_min_brightness            = static_cast<float>(image_transform.chroma.min_brightness);
+        p.chroma_softness                  = static_cast<float>(1.0 + image_transform.chroma.softness);
+        p.chroma_spill_suppress            = static_cast<float>(image_transform.chroma.spill_suppress / 360.0);
+        p.chroma_spill_suppress_saturation = static_cast<float>(image_transform.chroma.spill_suppress_saturation);
+    }
+
+    const auto& levels = image_transform.levels;
+    p.levels = levels.min_input > epsilon || levels.max_input < 1.0 - epsilon || levels.min_output > epsilon ||
+               levels.max_output < 1.0 - epsilon || std::abs(levels.gamma - 1.0) > epsilon;
+    if (p.levels) {
+        p.min_input  = static_cast<float>(levels.min_input);
+        p.max_input  = static_cast<float>(levels.max_input);
+        p.gamma      = static_cast<float>(levels.gamma);
+        p.min_output = static_cast<float>(levels.min_output);
+        p.max_output = static_cast<float>(levels.max_output);
+    }
+
+    p.csb = std::abs(image_transform.brightness - 1.0) > epsilon ||
+            std::abs(image_transform.saturation - 1.0) > epsilon || std::abs(image_transform.contrast - 1.0) > epsilon;
+    if (p.csb) {
+        p.brt = static_cast<float>(image_transform.brightness);
+        p.sat = static_cast<float>(image_transform.saturation);
+        p.con = static_cast<float>(image_transform.contrast);
+    }
+
+    return p;
+}
+
+// A triangle of the geometry, in target pixels, with its texture coordinates as the plane equations of s, t and q.
+struct triangle
+{
+    // Edge functions. A pixel center is inside when all three are non-negative.
+    std::array<float, 3> a, b, c;
+    // s, t and q at x, y are ds[0] * x + ds[1] * y + ds[2], and so on.
+    std::array<float, 3> ds, dt, dq;
+};
+
+bool make_triangle(const core::frame_geometry::coord& v0,
+                   const core::frame_geometry::coord& v1,
+                   const core::frame_geometry::coord& v2,
+                   int                                width,
+                   int                                height,
+                   triangle&                          result)
+{
+    const float x[3] = {static_cast<float>(v0.vertex_x * width),
+                        static_cast<float>(v1.vertex_x * width),
+                        static_cast<float>(v2.vertex_x * width)};
+    const float y[3] = {static_cast<float>(v0.vertex_y * height),
+                        static_cast<float>(v1.vertex_y * height),
+                        static_cast<float>(v2.vertex_y * height)};
+
+    auto area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::abs(area) < 1e-6f) {
+        return false;
+    }
+
+    // Barycentric weight of vertex n is a[n] * x + b[n] * y + c[n].
+    for (int n = 0; n < 3; ++n) {
+        auto i      = (n + 1) % 3;
+        auto j      = (n + 2) % 3;
+        result.a[n] = (y[i] - y[j]) / area;
+        result.b[n] = (x[j] - x[i]) / area;
+        result.c[n] = (x[i] * y[j] - x[j] * y[i]) / area;
+    }
+
+    auto plane = [&](double w0, double w1, double w2) {
+        std::array<float, 3> result_plane;
+        for (int n = 0; n < 3; ++n) {
+            auto& coefficients = n == 0 ? result.a : n == 1 ? result.b : result.c;
+            result_plane[n]    = static_cast<float>(coefficients[0] * w0 + coefficients[1] * w1 + coefficients[2] * w2);
+        }
+        return result_plane;
+    };
+    result.ds = plane(v0.texture_x, v1.texture_x, v2.texture_x);
+    result.dt = plane(v0.texture_y, v1.texture_y, v2.texture_y);
+    result.dq = plane(v0.texture_q, v1.texture_q, v2.texture_q);
+
+    return true;
+}
+
+// Draws pixel x, y with the first triangle of the fan which covers its center.
+void draw_pixel(int                                x,
+                int                                y,
+                const std::vector<triangle>&       triangles,
+                const std::array<texture_view, 4>& planes,
+                const draw_params&                 params,
+                const shader_params&               p,
+                surface&                           target)
+{
+    auto px = static_cast<float>(x) + 0.5f;
+    auto py = static_cast<float>(y) + 0.5f;
+
+    const triangle* covering = nullptr;
+    for (auto& tri : triangles) {
+        if (tri.a[0] * px + tri.b[0] * py + tri.c[0] >= 0.0f && tri.a[1] * px + tri.b[1] * py + tri.c[1] >= 0.0f &&
+            tri.a[2] * px + tri.b[2] * py + tri.c[2] >= 0.0f) {
+            covering = &tri;
+            break;
+        }
+    }
+    if (!covering) {
+        return;
+    }
+
+    auto s = covering->ds[0] * px + covering->ds[1] * py + covering->ds[2];
+    auto t = covering->dt[0] * px + covering->dt[1] * py + covering->dt[2];
+    auto q = covering->dq[0] * px + covering->dq[1] * py + covering->dq[2];
+
+    auto color = shade(planes, s / q, t / q, x, y, params, p);
+
+    auto  index = (static_cast<std::size_t>(y) * target.width + x) * target.channels;
+    auto* pixel = &target.data[index];
+    if (target.channels == 4) {
+        auto result = blend(color, {pixel[0], pixel[1], pixel[2], pixel[3]}, p);
+        for (int n = 0; n < 4; ++n)
+            pixel[n] = clamp01(result[n]);
+    } else {
+        // A single channel target is read as red and written from red, as a GL_R texture is.
+        auto result = blend(color, {0.0f, 0.0f, pixel[0], 1.0f}, p);
+        pixel[0]    = clamp01(result[2]);
+    }
+}
+
+#ifdef CASPAR_CPU_KERNEL_AVX2
+
+// The functions below draw 8 pixels of a row at a time, and give the same results as their scalar counterparts above.
+// Sampling, the common pixel formats, keys and the normal blend mode are vectorized. The chroma key, levels, contrast,
+// saturation, brightness and the other blend modes fall back to the scalar functions a pixel at a time.
+
+// 8 colors, one vector per channel, in the b, g, r, a order of vec4.
+struct vec4x8
+{
+    __m256 v[4];
+};
+
+__m256 mix8(__m256 x, __m256 y, __m256 a)
+{
+    return _mm256_add_ps(_mm256_mul_ps(x, _mm256_sub_ps(_mm256_set1_ps(1.0f), a)), _mm256_mul_ps(y, a));
+}
+
+__m256 clamp01_8(__m256 value)
+{
+    return _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+}
+
+// Calls func with the color and index of each of the 8 pixels, and keeps the colors it leaves.
+template <typename Func>
+void for_each_lane(vec4x8& color, Func&& func)
+{
+    alignas(32) float lanes[4][8];
+    for (int n = 0; n < 4; ++n)
+        _mm256_store_ps(lanes[n], color.v[n]);
+
+    for (int lane = 0; lane < 8; ++lane) {
+        vec4 c = {lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane]};
+        func(c, lane);
+        for (int n = 0; n < 4; ++n)
+            lanes[n][lane] = c[n];
+    }
+
+    for (int n = 0; n < 4; ++n)
+        color.v[n] = _mm256_load_ps(lanes[n]);
+}
+
+// Gathers the 32 bit words at the byte offsets of data, which holds size bytes. A word which would reach past the end
+// is read a byte at a time, with the missing bytes as 0.
+__m256i gather_words(const std::uint8_t* data, std::size_t size, __m256i offsets)
+{
+    const auto limit    = size >= 4 ? static_cast<int>(std::min<std::size_t>(size - 4, INT_MAX - 1)) : -1;
+    const auto in_range = _mm256_cmpgt_epi32(_mm256_set1_epi32(limit + 1), offsets);
+
+    auto words = _mm256_mask_i32gather_epi32(
+        _mm256_setzero_si256(), reinterpret_cast<const int*>(data), offsets, in_range, 1);
+
+    const auto outside = ~_mm256_movemask_ps(_mm256_castsi256_ps(in_range)) & 0xff;
+    if (outside != 0) {
+        alignas(32) std::int32_t lanes[8];
+        alignas(32) std::int32_t lane_offsets[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), words);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_offsets), offsets);
+        for (int n = 0; n < 8; ++n) {
+            if (outside & (1 << n)) {
+                std::uint32_t word = 0;
+                std::memcpy(&word, data + lane_offsets[n], size - lane_offsets[n]);
+                lanes[n] = static_cast<std::int32_t>(word);
+            }
+        }
+        words = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes));
+    }
+
+    return words;
+}
+
+// Returns texels x, y, as texture_view::fetch does.
+vec4x8 fetch8(const texture_view& tex, __m256i x, __m256i y)
+{
+    const auto zero  = _mm256_setzero_ps();
+    const auto one   = _mm256_set1_ps(1.0f);
+    const auto index = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(tex.width)), x),
+                                          _mm256_set1_epi32(tex.stride));
+
+    __m256 m[4] = {zero, zero, zero, zero};
+    switch (tex.format) {
+        case texture_view::type::u8: {
+            // Texels are at most 4 bytes, so a word holds all of one.
+            auto words = gather_words(static_cast<const std::uint8_t*>(tex.data), tex.size, index);
+            for (int n = 0; n < tex.stride; ++n) {
+                auto value = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_set1_epi32(8 * n)),
+                                              _mm256_set1_epi32(0xff));
+                m[n]       = _mm256_mul_ps(_mm256_cvtepi32_ps(value), _mm256_set1_ps(1.0f / 255.0f));
+            }
+            break;
+        }
+        case texture_view::type::u16: {
+            const auto offsets = _mm256_add_epi32(index, index);
+            for (int n = 0; n < tex.stride; n += 2) {
+                auto words = gather_words(static_cast<const std::uint8_t*>(tex.data),
+                                          tex.size,
+                                          _mm256_add_epi32(offsets, _mm256_set1_epi32(2 * n)));
+                m[n]       = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(words, _mm256_set1_epi32(0xffff))),
+                                     _mm256_set1_ps(1.0f / 65535.0f));
+                if (n + 1 < tex.stride) {
+                    m[n + 1] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(words, 16)),
+                                             _mm256_set1_ps(1.0f / 65535.0f));
+                }
+            }
+            break;
+        }
+        default: {
+            for (int n = 0; n < tex.stride; ++n) {
+                m[n] = _mm256_i32gather_ps(static_cast<const float*>(tex.data) + n, index, 4);
+            }
+            break;
+        }
+    }
+
+    switch (tex.stride) {
+        case 1:
+            return {{m[0], zero, zero, one}};
+        case 2:
+            return {{m[0], m[1], zero, one}};
+        case 3:
+            return {{m[2], m[1], m[0], one}};
+        default:
+            return {{m[2], m[1], m[0], m[3]}};
+    }
+}
+
+vec4x8 sample8(const texture_view& tex, __m256 s, __m256 t)
+{
+    auto u  = _mm256_sub_ps(_mm256_mul_ps(s, _mm256_set1_ps(static_cast<float>(tex.width))), _mm256_set1_ps(0.5f));
+    auto v  = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(static_cast<float>(tex.height))), _mm256_set1_ps(0.5f));
+    auto fu = _mm256_floor_ps(u);
+    auto fv = _mm256_floor_ps(v);
+    auto fx = _mm256_sub_ps(u, fu);
+    auto fy = _mm256_sub_ps(v, fv);
+
+    // Coordinates which don't fit an int, such as those of uncovered pixels, convert to INT_MIN and clamp to 0.
+    auto clamp = [](__m256i value, int size) {
+        return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), _mm256_set1_epi32(size - 1));
+    };
+    const auto one = _mm256_set1_epi32(1);
+    const auto iu  = _mm256_cvttps_epi32(fu);
+    const auto iv  = _mm256_cvttps_epi32(fv);
+
+    auto x0 = clamp(iu, tex.width);
+    auto x1 = clamp(_mm256_add_epi32(iu, one), tex.width);
+    auto y0 = clamp(iv, tex.height);
+    auto y1 = clamp(_mm256_add_epi32(iv, one), tex.height);
+
+    auto a = fetch8(tex, x0, y0);
+    auto b = fetch8(tex, x1, y0);
+    auto c = fetch8(tex, x0, y1);
+    auto d = fetch8(tex, x1, y1);
+
+    vec4x8 result;
+    for (int n = 0; n < 4; ++n) {
+        result.v[n] = mix8(mix8(a.v[n], b.v[n], fx), mix8(c.v[n], d.v[n], fx), fy);
+    }
+    return result;
+}
+
+vec4x8 ycbcra_to_rgba8(__m256 y, __m256 cb, __m256 cr, __m256 a, const shader_params& p)
+{
+    const auto luma_coefficient   = _mm256_set1_ps(255.0f / 219.0f);
+    const auto chroma_coefficient = _mm256_set1_ps(255.0f / 224.0f);
+    const auto max                = _mm256_set1_ps(255.0f);
+
+    const __m256 ycbcr[3] = {
+        _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(y, max), _mm256_set1_ps(16.0f)), luma_coefficient),
+        _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cb, max), _mm256_set1_ps(128.0f)), chroma_coefficient),
+        _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cr, max), _mm256_set1_ps(128.0f)), chroma_coefficient)};
+
+    __m256 rgb[3];
+    for (int n = 0; n < 3; ++n) {
+        auto sum = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.color_matrix[n * 3 + 0]), ycbcr[0]),
+                          _mm256_mul_ps(_mm256_set1_ps(p.color_matrix[n * 3 + 1]), ycbcr[1])),
+            _mm256_mul_ps(_mm256_set1_ps(p.color_matrix[n * 3 + 2]), ycbcr[2]));
+        rgb[n] = _mm256_div_ps(sum, max);
+    }
+
+    return {{rgb[2], rgb[1], rgb[0], a}};
+}
+
+vec4x8 get_rgba_color8(const std::array<texture_view, 4>& plane, __m256 s, __m256 t, const shader_params& p)
+{
+    const auto one = _mm256_set1_ps(1.0f);
+    const auto pf  = [&](int n) { return _mm256_set1_ps(p.precision_factor[n]); };
+    const auto mul = [](__m256 a, __m256 b) { return _mm256_mul_ps(a, b); };
+
+    switch (p.pixel_format) {
+        case 0: // gray
+        {
+            auto r = mul(sample8(plane[0], s, t).v[0], pf(0));
+            return {{r, r, r, one}};
+        }
+        case 1: // bgra
+        {
+            auto c = sample8(plane[0], s, t);
+            return {{mul(c.v[2], pf(0)), mul(c.v[1], pf(0)), mul(c.v[0], pf(0)), mul(c.v[3], pf(0))}};
+        }
+        case 2: // rgba
+        {
+            auto c = sample8(plane[0], s, t);
+            return {{mul(c.v[0], pf(0)), mul(c.v[1], pf(0)), mul(c.v[2], pf(0)), mul(c.v[3], pf(0))}};
+        }
+        case 3: // argb
+        {
+            auto c = sample8(plane[0], s, t);
+            return {{mul(c.v[3], pf(0)), mul(c.v[0], pf(0)), mul(c.v[1], pf(0)), mul(c.v[2], pf(0))}};
+        }
+        case 4: // abgr
+        {
+            auto c = sample8(plane[0], s, t);
+            return {{mul(c.v[1], pf(0)), mul(c.v[2], pf(0)), mul(c.v[3], pf(0)), mul(c.v[0], pf(0))}};
+        }
+        case 5: // ycbcr
+        {
+            auto y  = mul(sample8(plane[0], s, t).v[0], pf(0));
+            auto cb = mul(sample8(plane[1], s, t).v[0], pf(1));
+            auto cr = mul(sample8(plane[2], s, t).v[0], pf(2));
+            return ycbcra_to_rgba8(y, cb, cr, one, p);
+        }
+        case 6: // ycbcra
+        {
+            auto y  = mul(sample8(plane[0], s, t).v[0], pf(0));
+            auto cb = mul(sample8(plane[1], s, t).v[0], pf(1));
+            auto cr = mul(sample8(plane[2], s, t).v[0], pf(2));
+            auto a  = mul(sample8(plane[3], s, t).v[0], pf(3));
+            return ycbcra_to_rgba8(y, cb, cr, a, p);
+        }
+        case 7: // luma
+        {
+            auto y = _mm256_div_ps(_mm256_sub_ps(mul(sample8(plane[0], s, t).v[0], pf(0)), _mm256_set1_ps(0.065f)),
+                                   _mm256_set1_ps(0.859f));
+            return {{y, y, y, one}};
+        }
+        case 8: // bgr
+        {
+            auto c = sample8(plane[0], s, t);
+            return {{mul(c.v[2], pf(0)), mul(c.v[1], pf(0)), mul(c.v[0], pf(0)), one}};
+        }
+        case 9: // rgb
+        {
+            auto c = sample8(plane[0], s, t);
+            return {{mul(c.v[0], pf(0)), mul(c.v[1], pf(0)), mul(c.v[2], pf(0)), one}};
+        }
+        case 10: // uyvy
+        {
+            auto c0 = sample8(plane[0], s, t);
+            auto c1 = sample8(plane[1], s, t);
+            return ycbcra_to_rgba8(mul(c0.v[1], pf(0)), mul(c1.v[2], pf(1)), mul(c1.v[0], pf(1)), one, p);
+        }
+        case 11: // gbrp
+        {
+            auto g = mul(sample8(plane[0], s, t).v[0], pf(0));
+            auto b = mul(sample8(plane[1], s, t).v[0], pf(1));
+            auto r = mul(sample8(plane[2], s, t).v[0], pf(2));
+            return {{b, g, r, one}};
+        }
+        case 12: // gbrap
+        {
+            auto g = mul(sample8(plane[0], s, t).v[0], pf(0));
+            auto b = mul(sample8(plane[1], s, t).v[0], pf(1));
+            auto r = mul(sample8(plane[2], s, t).v[0], pf(2));
+            auto a = mul(sample8(plane[3], s, t).v[0], pf(3));
+            return {{b, g, r, a}};
+        }
+    }
+    const auto zero = _mm256_setzero_ps();
+    return {{zero, zero, zero, zero}};
+}
+
+// Returns the key values of the 8 pixels starting at x, y.
+__m256 key_value8(const surface& key, int x, int y)
+{
+    const auto* data =
+        key.data.data() + (static_cast<std::size_t>(y) * key.width + x) * key.channels + (key.channels == 4 ? 2 : 0);
+    if (key.channels == 1) {
+        return _mm256_loadu_ps(data);
+    }
+    return _mm256_i32gather_ps(
+        data, _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(key.channels)), 4);
+}
+
+vec4x8 shade8(const std::array<texture_view, 4>& plane,
+              __m256                             s,
+              __m256                             t,
+              int                                x,
+              int                                y,
+              const draw_params&                 params,
+              const shader_params&               p)
+{
+    auto color = get_rgba_color8(plane, s, t, p);
+    if (p.is_straight_alpha) {
+        for (int n = 0; n < 3; ++n)
+            color.v[n] = _mm256_mul_ps(color.v[n], color.v[3]);
+    }
+    if (p.chroma || p.levels || p.csb) {
+        for_each_lane(color, [&](vec4& c, int) { correct(c, p); });
+    }
+
+    auto factor = _mm256_set1_ps(p.opacity);
+    if (params.local_key) {
+        factor = _mm256_mul_ps(factor, key_value8(*params.local_key, x, y));
+    }
+    if (params.layer_key) {
+        factor = _mm256_mul_ps(factor, key_value8(*params.layer_key, x, y));
+    }
+    for (auto& c : color.v)
+        c = _mm256_mul_ps(c, factor);
+
+    if (p.invert) {
+        for (auto& c : color.v)
+            c = _mm256_sub_ps(_mm256_set1_ps(1.0f), c);
+    }
+    return color;
+}
+
+vec4x8 blend8(vec4x8 fore, const vec4x8& back, const shader_params& p)
+{
+    if (p.blend_mode != 0) {
+        alignas(32) float lanes[4][8];
+        for (int n = 0; n < 4; ++n)
+            _mm256_store_ps(lanes[n], back.v[n]);
+        for_each_lane(fore, [&](vec4& c, int lane) {
+            c = blend(c, {lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane]}, p);
+        });
+        return fore;
+    }
+
+    const auto inverse_alpha = _mm256_sub_ps(_mm256_set1_ps(1.0f), fore.v[3]);
+
+    vec4x8 result;
+    for (int n = 0; n < 4; ++n) {
+        result.v[n] = p.keyer == 1 ? _mm256_add_ps(fore.v[n], back.v[n])
+                                   : _mm256_add_ps(fore.v[n], _mm256_mul_ps(inverse_alpha, back.v[n]));
+    }
+    return result;
+}
+
+// Turns vectors which hold pixel n in their low half and pixel n + 4 in their high half, for n from 0 to 3, into
+// vectors of channels, and back.
+void transpose8(vec4x8& color)
+{
+    auto t0 = _mm256_unpacklo_ps(color.v[0], color.v[1]);
+    auto t1 = _mm256_unpackhi_ps(color.v[0], color.v[1]);
+    auto t2 = _mm256_unpacklo_ps(color.v[2], color.v[3]);
+    auto t3 = _mm256_unpackhi_ps(color.v[2], color.v[3]);
+
+    color.v[0] = _mm256_shuffle_ps(t0, t2, 0x44);
+    color.v[1] = _mm256_shuffle_ps(t0, t2, 0xee);
+    color.v[2] = _mm256_shuffle_ps(t1, t3, 0x44);
+    color.v[3] = _mm256_shuffle_ps(t1, t3, 0xee);
+}
+
+vec4x8 load_pixels8(const float* pixels)
+{
+    vec4x8 color;
+    for (int n = 0; n < 4; ++n) {
+        color.v[n] = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(_mm_loadu_ps(pixels + n * 4)), _mm_loadu_ps(pixels + (n + 4) * 4), 1);
+    }
+    transpose8(color);
+    return color;
+}
+
+void store_pixels8(float* pixels, vec4x8 color)
+{
+    transpose8(color);
+    for (int n = 0; n < 4; ++n) {
+        _mm_storeu_ps(pixels + n * 4, _mm256_castps256_ps128(color.v[n]));
+        _mm_storeu_ps(pixels + (n + 4) * 4, _mm256_extractf128_ps(color.v[n], 1));
+    }
+}
+
+// Draws the 8 pixels starting at x, y, as draw_pixel does each of them.
+void draw8(int                                x,
+           int                                y,
+           const std::vector<triangle>&       triangles,
+           const std::array<texture_view, 4>& planes,
+           const draw_params&                 params,
+           const shader_params&               p,
+           surface&                           target)
+{
+    const auto zero = _mm256_setzero_ps();
+    const auto px   = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)),
+                                  _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+    const auto py   = _mm256_set1_ps(static_cast<float>(y) + 0.5f);
+
+    // Plane d at the pixel centers, which is an edge function or a texture coordinate of a triangle.
+    auto plane = [&](float d0, float d1, float d2) {
+        return _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(d0), px), _mm256_mul_ps(_mm256_set1_ps(d1), py)),
+            _mm256_set1_ps(d2));
+    };
+    auto inside = [&](const triangle& tri, int n) {
+        return _mm256_cmp_ps(plane(tri.a[n], tri.b[n], tri.c[n]), zero, _CMP_GE_OQ);
+    };
+
+    auto covered = zero;
+    auto s       = zero;
+    auto t       = zero;
+    auto q       = _mm256_set1_ps(1.0f);
+    for (auto& tri : triangles) {
+        auto covers = _mm256_and_ps(_mm256_and_ps(inside(tri, 0), inside(tri, 1)), inside(tri, 2));
+        auto first  = _mm256_andnot_ps(covered, covers);
+
+        s       = _mm256_blendv_ps(s, plane(tri.ds[0], tri.ds[1], tri.ds[2]), first);
+        t       = _mm256_blendv_ps(t, plane(tri.dt[0], tri.dt[1], tri.dt[2]), first);
+        q       = _mm256_blendv_ps(q, plane(tri.dq[0], tri.dq[1], tri.dq[2]), first);
+        covered = _mm256_or_ps(covered, covers);
+    }
+    if (_mm256_movemask_ps(covered) == 0) {
+        return;
+    }
+
+    auto color = shade8(planes, _mm256_div_ps(s, q), _mm256_div_ps(t, q), x, y, params, p);
+
+    auto* pixel = &target.data[(static_cast<std::size_t>(y) * target.width + x) * target.channels];
+    if (target.channels == 4) {
+        auto back   = load_pixels8(pixel);
+        auto result = blend8(color, back, p);
+        for (int n = 0; n < 4; ++n)
+            result.v[n] = _mm256_blendv_ps(back.v[n], clamp01_8(result.v[n]), covered);
+        store_pixels8(pixel, result);
+    } else {
+        auto back   = _mm256_loadu_ps(pixel);
+        auto result = blend8(color, {{zero, zero, back, _mm256_set1_ps(1.0f)}}, p);
+        _mm256_storeu_ps(pixel, _mm256_blendv_ps(back, clamp01_8(result.v[2]), covered));
+    }
+}
+
+#endif
+
+} // namespace
+
+void draw(const draw_params& params)
+{
+    if (!params.background || (params.planes.empty() && !params.source)) {
+        return;
+    }
+
+    auto pix_desc = params.pix_desc;
+    if (params.source) {
+        pix_desc.format = core::pixel_format::bgra;
+        pix_desc.planes = {core::pixel_format_desc::plane(params.source->width, params.source->height, 4)};
+    }
+    CASPAR_ASSERT(params.source || pix_desc.planes.size() == params.planes.size());
+
+    if (params.transforms.image_transform.opacity < epsilon) {
+        return;
+    }
+
+    auto coords = params.geometry.data();
+    if (coords.empty()) {
+        return;
+    }
+
+    auto transforms = params.transforms.combine_scale_mode(
+        params.geometry.mode(), pix_desc.planes.at(0), params.target_width, params.target_height, params.aspect_ratio);
+
+    coords = transforms.transform_coords(coords);
+
+    // Skip drawing if all the coordinates will be outside the screen.
+    if (coords.size() < 3 || is_outside_screen(coords)) {
+        return;
+    }
+
+    auto p = get_shader_params(params, transforms);
+    if (params.source) {
+        p.pixel_format = static_cast<int>(core::pixel_format::bgra);
+    }
+
+    std::array<texture_view, 4> planes;
+    if (params.source) {
+        planes[0] = view(*params.source);
+    } else {
+        for (int n = 0; n < static_cast<int>(params.planes.size()) && n < 4; ++n) {
+            const auto& plane = pix_desc.planes[n];
+            planes[n]         = texture_view{params.planes[n].data(),
+                                     params.planes[n].size(),
+                                     plane.width,
+                                     plane.height,
+                                     plane.stride,
+                                     plane.depth == common::bit_depth::bit8 ? texture_view::type::u8
+                                                                            : texture_view::type::u16};
+        }
+    }
+
+    auto& target = *params.background;
+
+    std::vector<triangle> triangles;
+    for (std::size_t n = 1; n + 1 < coords.size(); ++n) {
+        triangle tri;
+        if (make_triangle(coords[0], coords[n], coords[n + 1], target.width, target.height, tri)) {
+            triangles.push_back(tri);
+        }
+    }
+
+    auto min_x = 1.0;
+    auto min_y = 1.0;
+    auto max_x = 0.0;
+    auto max_y = 0.0;
+    for (auto& coord : coords) {
+        min_x = std::min(min_x, coord.vertex_x);
+        min_y = std::min(min_y, coord.vertex_y);
+        max_x = std::max(max_x, coord.vertex_x);
+        max_y = std::max(max_y, coord.vertex_y);
+    }
+    auto x0 = std::max(0, static_cast<int>(std::floor(min_x * target.width)));
+    auto y0 = std::max(0, static_cast<int>(std::floor(min_y * target.height)));
+    auto x1 = std::min(target.width, static_cast<int>(std::ceil(max_x * target.width)));
+    auto y1 = std::min(target.height, static_cast<int>(std::ceil(max_y * target.height)));
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    tbb::parallel_for(tbb::blocked_range2d<int>(y0, y1, tile_height, x0, x1, tile_width),
+                      [&](const tbb::blocked_range2d<int>& tile) {
+                          for (auto y = tile.rows().begin(); y != tile.rows().end(); ++y) {
+                              auto x = tile.cols().begin();
+#ifdef CASPAR_CPU_KERNEL_AVX2
+                              for (; x + 8 <= tile.cols().end(); x += 8) {
+                                  draw8(x, y, triangles, planes, params, p, target);
+                              }
+#endif
+                              for (; x != tile.cols().end(); ++x) {
+                                  draw_pixel(x, y, triangles, planes, params, p, target);
+                              }
+                          }
+                      });
+}
+
+}}} // namespace caspar::accelerator::cpu
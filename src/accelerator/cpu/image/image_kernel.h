@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <core/mixer/image/blend_modes.h>
+
+#include <common/array.h>
+
+#include <core/frame/geometry.h>
+#include <core/frame/pixel_format.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "../../ogl/util/transforms.h"
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+enum class keyer
+{
+    linear = 0,
+    additive,
+};
+
+// Pixels of a render target. They are laid out as the OpenGL mixer's target textures are in memory: b, g, r, a with
+// 4 channels or a single key value with 1, premultiplied and normalized to [0, 1].
+struct surface final
+{
+    int                width    = 0;
+    int                height   = 0;
+    int                channels = 0;
+    std::vector<float> data;
+
+    surface(int width, int height, int channels)
+        : width(width)
+        , height(height)
+        , channels(channels)
+        , data(static_cast<std::size_t>(width) * height * channels, 0.0f)
+    {
+    }
+};
+
+struct draw_params final
+{
+    core::pixel_format_desc                pix_desc = core::pixel_format_desc(core::pixel_format::invalid);
+    std::vector<array<const std::uint8_t>> planes;
+    const surface*                         source = nullptr; // Drawn as a bgra frame, instead of planes.
+    ogl::draw_transforms                   transforms;
+    core::frame_geometry                   geometry   = core::frame_geometry::get_default();
+    core::blend_mode                       blend_mode = core::blend_mode::normal;
+    cpu::keyer                             keyer      = cpu::keyer::linear;
+    surface*                               background = nullptr;
+    const surface*                         local_key  = nullptr;
+    const surface*                         layer_key  = nullptr;
+    double                                 aspect_ratio = 1.0;
+    int                                    target_width;
+    int                                    target_height;
+};
+
+// Draws params onto its background. The result matches what the OpenGL mixer's image shader draws, apart from the
+// precision of intermediate targets, which are kept as floats rather than 8 or 16 bit.
+void draw(const draw_params& params);
+
+}}} // namespace caspar::accelerator::cpu
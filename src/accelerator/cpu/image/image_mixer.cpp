@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "image_mixer.h"
+
+#include "image_kernel.h"
+
+#include <common/array.h>
+#include <common/bit_depth.hpp>
+#include <common/executor.h>
+#include <common/future.h>
+#include <common/log.h>
+
+#include <core/frame/frame.h>
+#include <core/frame/frame_transform.h>
+#include <core/frame/geometry.h>
+#include <core/frame/pixel_format.h>
+#include <core/video_format.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+struct item
+{
+    core::pixel_format_desc                pix_desc = core::pixel_format_desc(core::pixel_format::invalid);
+    std::vector<array<const std::uint8_t>> planes;
+    ogl::draw_transforms                   transforms;
+    core::frame_geometry                   geometry = core::frame_geometry::get_default();
+};
+
+struct layer
+{
+    std::vector<layer> sublayers;
+    std::vector<item>  items;
+    core::blend_mode   blend_mode;
+
+    explicit layer(core::blend_mode blend_mode)
+        : blend_mode(blend_mode)
+    {
+    }
+};
+
+class image_renderer
+{
+    common::bit_depth                     depth_;
+    std::vector<std::shared_ptr<surface>> pool_;
+    std::vector<std::shared_ptr<surface>> used_;
+    array<const std::uint8_t>             blank_image_;
+    int                                   draw_calls_ = 0;
+    std::atomic<int>                      last_draw_calls_{0};
+    executor                              executor_{L"cpu image mixer"};
+
+  public:
+    explicit image_renderer(common::bit_depth depth)
+        : depth_(depth)
+    {
+    }
+
+    std::future<array<const std::uint8_t>> operator()(std::vector<layer>             layers,
+                                                      const core::video_format_desc& format_desc)
+    {
+        auto size = static_cast<std::size_t>(format_desc.width) * format_desc.height * 4 * bytes_per_channel();
+
+        if (layers.empty()) {
+            last_draw_calls_ = 0;
+            if (blank_image_.size() != size) {
+                blank_image_ = array<std::uint8_t>(size);
+            }
+            return make_ready_future(blank_image_);
+        }
+
+        return executor_.begin_invoke([this, size, format_desc, layers = std::move(layers)]() mutable {
+            auto target = create_surface(format_desc.width, format_desc.height, 4);
+
+            draw(target, std::move(layers), format_desc);
+
+            array<std::uint8_t> result(size);
+            convert(*target, result);
+
+            pool_.insert(pool_.end(), used_.begin(), used_.end());
+            used_.clear();
+
+            last_draw_calls_ = draw_calls_;
+            draw_calls_      = 0;
+
+            return array<const std::uint8_t>(std::move(result));
+        });
+    }
+
+    common::bit_depth depth() const { return depth_; }
+
+    int last_draw_calls() const { return last_draw_calls_; }
+
+  private:
+    std::size_t bytes_per_channel() const { return depth_ == common::bit_depth::bit8 ? 1 : 2; }
+
+    std::shared_ptr<surface> create_surface(int width, int height, int channels)
+    {
+        auto it = std::find_if(pool_.begin(), pool_.end(), [&](const std::shared_ptr<surface>& s) {
+            return s->width == width && s->height == height && s->channels == channels;
+        });
+
+        std::shared_ptr<surface> result;
+        if (it != pool_.end()) {
+            result = std::move(*it);
+            pool_.erase(it);
+            std::fill(result->data.begin(), result->data.end(), 0.0f);
+        } else {
+            result = std::make_shared<surface>(width, height, channels);
+        }
+
+        used_.push_back(result);
+        return result;
+    }
+
+    void convert(const surface& source, array<std::uint8_t>& dest) const
+    {
+        const auto* src   = source.data.data();
+        const auto  count = source.data.size();
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, count, 1 << 16), [&](const auto& r) {
+            if (depth_ == common::bit_depth::bit8) {
+                auto* dst = dest.data();
+                for (auto n = r.begin(); n != r.end(); ++n)
+                    dst[n] = static_cast<std::uint8_t>(std::lround(src[n] * 255.0f));
+            } else {
+                auto* dst = reinterpret_cast<std::uint16_t*>(dest.data());
+                for (auto n = r.begin(); n != r.end(); ++n)
+                    dst[n] = static_cast<std::uint16_t>(std::lround(src[n] * 65535.0f));
+            }
+        });
+    }
+
+    void draw(std::shared_ptr<surface>& target, std::vector<layer> layers, const core::video_format_desc& format_desc)
+    {
+        std::shared_ptr<surface> layer_key;
+
+        for (auto& layer : layers) {
+            draw(target, layer.sublayers, format_desc);
+            draw(target, std::move(layer), layer_key, format_desc);
+        }
+    }
+
+    void draw(std::shared_ptr<surface>&      target,
+              layer                          layer,
+              std::shared_ptr<surface>&      layer_key,
+              const core::video_format_desc& format_desc)
+    {
+        if (layer.items.empty())
+            return;
+
+        std::shared_ptr<surface> local_key;
+        std::shared_ptr<surface> local_mix;
+
+        if (layer.blend_mode != core::blend_mode::normal) {
+            auto layer_surface = create_surface(target->width, target->height, 4);
+
+            for (auto& item : layer.items)
+                draw(layer_surface, std::move(item), layer_key, local_key, local_mix, format_desc);
+
+            draw(layer_surface, std::move(local_mix), format_desc, core::blend_mode::normal);
+            draw(target, std::move(layer_surface), format_desc, layer.blend_mode);
+        } else {
+            for (auto& item : layer.items)
+                draw(target, std::move(item), layer_key, local_key, local_mix, format_desc);
+
+            draw(target, std::move(local_mix), format_desc, core::blend_mode::normal);
+        }
+
+        layer_key = std::move(local_key);
+    }
+
+    void draw(std::shared_ptr<surface>&      target,
+              item                           item,
+              std::shared_ptr<surface>&      layer_key,
+              std::shared_ptr<surface>&      local_key,
+              std::shared_ptr<surface>&      local_mix,
+              const core::video_format_desc& format_desc)
+    {
+        draw_params draw_params;
+        draw_params.target_width  = format_desc.square_width;
+        draw_params.target_height = format_desc.square_height;
+        draw_params.pix_desc      = std::move(item.pix_desc);
+        draw_params.planes        = std::move(item.planes);
+        draw_params.transforms    = std::move(item.transforms);
+        draw_params.geometry      = std::move(item.geometry);
+        draw_params.aspect_ratio =
+            static_cast<double>(format_desc.square_width) / static_cast<double>(format_desc.square_height);
+
+        if (draw_params.transforms.image_transform.is_key) {
+            // A key means we will use it for the next non-key item as a mask.
+            local_key = local_key ? local_key : create_surface(target->width, target->height, 1);
+
+            draw_params.background = local_key.get();
+            draw(draw_params);
+        } else if (draw_params.transforms.image_transform.is_mix) {
+            // A mix means precomp the items to a surface, before drawing to the channel.
+            local_mix = local_mix ? local_mix : create_surface(target->width, target->height, 4);
+
+            auto key               = std::move(local_key); // Use and reset the key
+            draw_params.background = local_mix.get();
+            draw_params.local_key  = key.get();
+            draw_params.layer_key  = layer_key.get();
+            draw_params.keyer      = keyer::additive;
+            draw(draw_params);
+        } else {
+            // If there is a mix, this is the end so draw it and reset.
+            draw(target, std::move(local_mix), format_desc, core::blend_mode::normal);
+
+            auto key               = std::move(local_key);
+            draw_params.background = target.get();
+            draw_params.local_key  = key.get();
+            draw_params.layer_key  = layer_key.get();
+            draw(draw_params);
+        }
+    }
+
+    void draw(std::shared_ptr<surface>&      target,
+              std::shared_ptr<surface>&&     source,
+              const core::video_format_desc& format_desc,
+              core::blend_mode               blend_mode = core::blend_mode::normal)
+    {
+        if (!source)
+            return;
+
+        draw_params draw_params;
+        draw_params.target_width  = format_desc.square_width;
+        draw_params.target_height = format_desc.square_height;
+        draw_params.source        = source.get();
+        draw_params.blend_mode    = blend_mode;
+        draw_params.background    = target.get();
+        draw_params.geometry      = core::frame_geometry::get_default();
+        draw(draw_params);
+
+        source.reset();
+    }
+
+    void draw(const draw_params& params)
+    {
+        cpu::draw(params);
+        draw_calls_++;
+    }
+};
+
+struct image_mixer::impl : public core::frame_factory
+{
+    image_renderer                    renderer_;
+    std::vector<ogl::draw_transforms> transform_stack_;
+    std::vector<layer>                layers_; // layer/stream/items
+    std::vector<layer*>               layer_stack_;
+
+    double aspect_ratio_ = 1.0;
+
+  public:
+    impl(const int channel_id, common::bit_depth depth)
+        : renderer_(depth)
+        , transform_stack_(1)
+    {
+        CASPAR_LOG(info) << L"Initialized CPU Image Mixer for channel " << channel_id;
+    }
+
+    void update_aspect_ratio(double aspect_ratio) { aspect_ratio_ = aspect_ratio; }
+
+    void push(const core::frame_transform& transform)
+    {
+        auto previous_layer_depth = transform_stack_.back().image_transform.layer_depth;
+
+        transform_stack_.push_back(transform_stack_.back().combine_transform(transform.image_transform, aspect_ratio_));
+
+        auto new_layer_depth = transform_stack_.back().image_transform.layer_depth;
+
+        if (previous_layer_depth < new_layer_depth) {
+            layer new_layer(transform_stack_.back().image_transform.blend_mode);
+
+            if (layer_stack_.empty()) {
+                layers_.push_back(std::move(new_layer));
+                layer_stack_.push_back(&layers_.back());
+            } else {
+                layer_stack_.back()->sublayers.push_back(std::move(new_layer));
+                layer_stack_.push_back(&layer_stack_.back()->sublayers.back());
+            }
+        }
+    }
+
+    void visit(const core::const_frame& frame)
+    {
+        if (frame.pixel_format_desc().format == core::pixel_format::invalid)
+            return;
+
+        if (frame.pixel_format_desc().planes.empty())
+            return;
+
+        item item;
+        item.pix_desc   = frame.pixel_format_desc();
+        item.transforms = transform_stack_.back();
+        item.geometry   = frame.geometry();
+
+        for (int n = 0; n < static_cast<int>(item.pix_desc.planes.size()); ++n) {
+            item.planes.push_back(frame.image_data(n));
+        }
+
+        layer_stack_.back()->items.push_back(std::move(item));
+    }
+
+    void pop()
+    {
+        transform_stack_.pop_back();
+        layer_stack_.resize(transform_stack_.back().image_transform.layer_depth);
+    }
+
+    std::future<array<const std::uint8_t>> render(const core::video_format_desc& format_desc)
+    {
+        return renderer_(std::move(layers_), format_desc);
+    }
+
+    core::mutable_frame create_frame(const void* tag, const core::pixel_format_desc& desc) override
+    {
+        return create_frame(tag, desc, common::bit_depth::bit8);
+    }
+
+    core::mutable_frame
+    create_frame(const void* tag, const core::pixel_format_desc& desc, common::bit_depth depth) override
+    {
+        std::vector<array<std::uint8_t>> image_data;
+        for (auto& plane : desc.planes) {
+            auto bytes_per_pixel = depth == common::bit_depth::bit8 ? 1 : 2;
+            image_data.emplace_back(plane.size * bytes_per_pixel);
+        }
+
+        return core::mutable_frame(tag, std::move(image_data), array<int32_t>{}, desc);
+    }
+
+    common::bit_depth depth() const { return renderer_.depth(); }
+
+    render_stats last_render_stats() const
+    {
+        render_stats stats;
+        stats.draw_calls = renderer_.last_draw_calls();
+        stats.draw_items = stats.draw_calls;
+        return stats;
+    }
+};
+
+image_mixer::image_mixer(const int channel_id, common::bit_depth depth)
+    : impl_(std::make_unique<impl>(channel_id, depth))
+{
+}
+image_mixer::~image_mixer() {}
+void image_mixer::push(const core::frame_transform& transform) { impl_->push(transform); }
+void image_mixer::visit(const core::const_frame& frame) { impl_->visit(frame); }
+void image_mixer::pop() { impl_->pop(); }
+void image_mixer::update_aspect_ratio(double aspect_ratio) { impl_->update_aspect_ratio(aspect_ratio); }
+std::future<array<const std::uint8_t>> image_mixer::render(const core::video_format_desc& format_desc)
+{
+    return impl_->render(format_desc);
+}
+core::mutable_frame image_mixer::create_frame(const void* tag, const core::pixel_format_desc& desc)
+{
+    return impl_->create_frame(tag, desc);
+}
+core::mutable_frame
+image_mixer::create_frame(const void* tag, const core::pixel_format_desc& desc, common::bit_depth depth)
+{
+    return impl_->create_frame(tag, desc, depth);
+}
+
+common::bit_depth               image_mixer::depth() const { return impl_->depth(); }
+core::image_mixer::render_stats image_mixer::last_render_stats() const { return impl_->last_render_stats(); }
+
+}}} // namespace caspar::accelerator::cpu
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/array.h>
+#include <common/bit_depth.hpp>
+
+#include <core/frame/frame.h>
+#include <core/frame/pixel_format.h>
+#include <core/mixer/image/image_mixer.h>
+#include <core/video_format.h>
+
+#include <future>
+#include <memory>
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+// An image mixer which composites on the CPU. It draws what the OpenGL image mixer draws, for servers without a GPU
+// and for comparing output against a reference.
+class image_mixer final : public core::image_mixer
+{
+  public:
+    image_mixer(int channel_id, common::bit_depth depth);
+    image_mixer(const image_mixer&) = delete;
+
+    ~image_mixer();
+
+    image_mixer& operator=(const image_mixer&) = delete;
+
+    std::future<array<const std::uint8_t>> render(const core::video_format_desc& format_desc) override;
+    core::mutable_frame                    create_frame(const void* tag, const core::pixel_format_desc& desc) override;
+    core::mutable_frame
+    create_frame(const void* video_stream_tag, const core::pixel_format_desc& desc, common::bit_depth depth) override;
+
+    void update_aspect_ratio(double aspect_ratio) override;
+
+    // core::image_mixer
+
+    void              push(const core::frame_transform& frame) override;
+    void              visit(const core::const_frame& frame) override;
+    void              pop() override;
+    common::bit_depth depth() const override;
+    render_stats      last_render_stats() const override;
+
+  private:
+    struct impl;
+    std::unique_ptr<impl> impl_;
+};
+
+}}} // namespace caspar::accelerator::cpu
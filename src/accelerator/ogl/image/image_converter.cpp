@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "image_converter.h"
+
+#include "../util/buffer.h"
+#include "../util/device.h"
+#include "../util/shader.h"
+#include "../util/texture.h"
+
+#include "ogl_image_convert.h"
+
+#include <common/except.h>
+#include <common/gl/gl_check.h>
+#include <common/log.h>
+
+#include <GL/glew.h>
+
+#include <string>
+#include <utility>
+
+namespace caspar { namespace accelerator { namespace ogl {
+
+struct image_converter::impl
+{
+    spl::shared_ptr<device> ogl_;
+    std::shared_ptr<shader> shader_;
+    bool                    failed_ = false;
+
+    explicit impl(const spl::shared_ptr<device>& ogl)
+        : ogl_(ogl)
+    {
+    }
+
+    // Compiles the shader on first use. Devices without compute shaders are left to convert on the CPU.
+    bool ready()
+    {
+        if (!shader_ && !failed_) {
+            try {
+                shader_ = std::make_shared<shader>(std::string(convert_shader));
+            } catch (...) {
+                CASPAR_LOG_CURRENT_EXCEPTION();
+                CASPAR_LOG(warning) << L"[image_converter] Output formats will be converted on the CPU.";
+                failed_ = true;
+            }
+        }
+        return shader_ != nullptr;
+    }
+
+    // Returns the number of invocations along each row and column, see convert.comp.
+    static std::pair<int, int> invocations(core::output_format format, int width, int height)
+    {
+        switch (format) {
+            case core::output_format::uyvy:
+                return {width / 2, height};
+            case core::output_format::v210:
+                return {static_cast<int>(core::output_format_linesize(format, width, common::bit_depth::bit8) / 16),
+                        height};
+            case core::output_format::nv12:
+                return {width / 4, height / 2};
+            case core::output_format::yuv422p10:
+                return {width / 4, height};
+            case core::output_format::bgra_half:
+            case core::output_format::bgra_quarter:
+            case core::output_format::bgra_eighth:
+                return {width / core::output_format_scale(format), height / core::output_format_scale(format)};
+            default:
+                return {0, 0};
+        }
+    }
+
+    bool supports(core::output_format format, int width, int height)
+    {
+        return format != core::output_format::bgra &&
+               core::output_format_size(format, width, height, common::bit_depth::bit8) > 0 && ready();
+    }
+
+    std::future<array<const std::uint8_t>>
+    operator()(const std::shared_ptr<texture>& source, core::output_format format, core::color_space color_space)
+    {
+        auto width  = source->width();
+        auto height = source->height();
+
+        if (!supports(format, width, height)) {
+            CASPAR_THROW_EXCEPTION(invalid_argument()
+                                   << msg_info(L"Can't convert to " + core::to_wstring(format) + L" on the GPU."));
+        }
+
+        auto matrix = core::v210_matrix(color_space);
+
+        double kr = 0.2126;
+        double kb = 0.0722;
+        if (color_space == core::color_space::bt601) {
+            kr = 0.299;
+            kb = 0.114;
+        } else if (color_space == core::color_space::bt2020) {
+            kr = 0.2627;
+            kb = 0.0593;
+        }
+
+        auto size    = static_cast<int>(core::output_format_size(format, width, height, source->depth()));
+        auto columns = invocations(format, width, height).first;
+        auto rows    = invocations(format, width, height).second;
+
+        return ogl_->read_async(size, [=, shader = shader_](buffer& dest) {
+            shader->use();
+            shader->set("format", format);
+            shader->set("luma_coeff", kr, kb);
+            shader->set("width", width);
+            shader->set("height", height);
+            shader->set("columns", columns);
+            shader->set("rows", rows);
+            shader->set("box_size", core::output_format_scale(format));
+            shader->set("high_bitdepth", source->depth() != common::bit_depth::bit8);
+            shader->set_array("v210_matrix", matrix);
+
+            source->bind(0);
+            GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, dest.id()));
+            GL(glDispatchCompute((columns + 7) / 8, (rows + 7) / 8, 1));
+            GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0));
+
+            // The buffer is read through its persistent mapping, which shader writes are not coherent with.
+            GL(glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT));
+        });
+    }
+};
+
+image_converter::image_converter(const spl::shared_ptr<device>& ogl)
+    : impl_(new impl(ogl))
+{
+}
+image_converter::~image_converter() {}
+bool image_converter::supports(core::output_format format, int width, int height)
+{
+    return impl_->supports(format, width, height);
+}
+std::future<array<const std::uint8_t>> image_converter::operator()(const std::shared_ptr<texture>& source,
+                                                                   core::output_format             format,
+                                                                   core::color_space               color_space)
+{
+    return (*impl_)(source, format, color_space);
+}
+
+}}} // namespace caspar::accelerator::ogl
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <common/array.h>
+#include <common/memory.h>
+
+#include <core/frame/output_format.h>
+#include <core/frame/pixel_format.h>
+
+#include <cstdint>
+#include <future>
+#include <memory>
+
+namespace caspar { namespace accelerator { namespace ogl {
+
+class device;
+class texture;
+
+// Converts rendered images to the formats consumers read, with a compute shader, so that only the converted image is
+// read back. The result matches core::convert_image.
+class image_converter final
+{
+  public:
+    explicit image_converter(const spl::shared_ptr<device>& ogl);
+    image_converter(const image_converter&) = delete;
+
+    ~image_converter();
+
+    image_converter& operator=(const image_converter&) = delete;
+
+    // Returns whether format can be converted from an image of width x height. Must be called on the device thread.
+    bool supports(core::output_format format, int width, int height);
+
+    // Must be called on the device thread.
+    std::future<array<const std::uint8_t>>
+    operator()(const std::shared_ptr<texture>& source, core::output_format format, core::color_space color_space);
+
+  private:
+    struct impl;
+    std::unique_ptr<impl> impl_;
+};
+
+}}} // namespace caspar::accelerator::ogl
@@ -27,18 +27,28 @@
 #include "../util/texture.h"
 
 #include <common/assert.h>
+#include <common/env.h>
 #include <common/gl/gl_check.h>
 
 #include <core/frame/frame_transform.h>
 #include <core/frame/pixel_format.h>
 
 #include <boost/algorithm/cxx11/all_of.hpp>
+#include <boost/property_tree/ptree.hpp>
 #include <boost/range/adaptor/transformed.hpp>
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace caspar::accelerator::ogl {
 
@@ -80,113 +90,405 @@ bool is_outside_screen(const std::vector<core::frame_geometry::coord>& coords)
 
 static const double epsilon = 0.001;
 
+// Vertex layout in the vertex buffer: Position (x, y), TexCoordIn (s, t, r, q) and the index of the item's parameters.
+struct vertex
+{
+    float        position[2];
+    float        tex_coord[4];
+    std::int32_t item;
+};
+
+// The parameters of an item, laid out as item_params in shader.frag (std430).
+struct item_params
+{
+    float         color_matrix[3][4]; // Columns, padded to vec4.
+    float         luma_coeff[3];
+    float         opacity;
+    float         precision_factor[4];
+    float         min_input;
+    float         max_input;
+    float         gamma;
+    float         min_output;
+    float         max_output;
+    float         brt;
+    float         sat;
+    float         con;
+    std::uint32_t chroma_show_mask;
+    float         chroma_target_hue;
+    float         chroma_hue_width;
+    float         chroma_min_saturation;
+    float         chroma_min_brightness;
+    float         chroma_softness;
+    float         chroma_spill_suppress;
+    float         chroma_spill_suppress_saturation;
+    std::int32_t  slot;
+    std::int32_t  padding[3];
+};
+static_assert(sizeof(item_params) == 160, "item_params must match the std430 layout of shader.frag");
+
+static const int textures_per_slot = static_cast<int>(texture_id::count);
+
+// A persistently mapped buffer used as a ring of T. It is split in two halves which are fenced so that elements are
+// never overwritten while the GPU may still read them.
+template <typename T>
+struct stream_buffer
+{
+    GLuint                id       = 0;
+    T*                    data     = nullptr;
+    GLsizei               capacity = 0;
+    GLsizei               next     = 0;
+    std::array<GLsync, 2> fences{};
+
+    void create(GLsizei size)
+    {
+        capacity   = size;
+        auto bytes = static_cast<GLsizeiptr>(sizeof(T)) * capacity;
+        auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GL(glCreateBuffers(1, &id));
+        GL(glNamedBufferStorage(id, bytes, nullptr, flags));
+        data = reinterpret_cast<T*>(GL2(glMapNamedBufferRange(id, 0, bytes, flags)));
+    }
+
+    void destroy()
+    {
+        for (auto fence : fences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+        GL(glUnmapNamedBuffer(id));
+        GL(glDeleteBuffers(1, &id));
+    }
+
+    // Returns the index of count consecutive elements, which never span both halves. When entering the other half,
+    // issue is called to submit what reads the half being left, before that half is fenced.
+    template <typename F>
+    GLsizei allocate(GLsizei count, F&& issue)
+    {
+        const auto half_capacity = capacity / 2;
+        CASPAR_VERIFY(count <= half_capacity);
+
+        auto first = next;
+        if (first / half_capacity != (first + count - 1) / half_capacity) {
+            first = (first + count - 1) / half_capacity * half_capacity;
+        }
+        first %= capacity;
+
+        // Entering the other half. Fence the one we are leaving, and wait until the GPU is done with this one.
+        auto half = first / half_capacity;
+        if (next > 0 && half != (next - 1) / half_capacity) {
+            issue();
+            auto& leaving = fences[1 - half];
+            if (!leaving) {
+                leaving = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+            if (fences[half]) {
+                while (glClientWaitSync(fences[half], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+                }
+                glDeleteSync(fences[half]);
+                fences[half] = nullptr;
+            }
+        }
+
+        next = first + count;
+        return first;
+    }
+};
+
+static const GLsizei vertex_capacity = 1 << 16;
+static const GLsizei item_capacity   = 1 << 12;
+
+// Draws which are issued as one multi-draw call. They share a shader variant, a target and a scissor, and each samples
+// the textures of its slot.
+struct batch
+{
+    image_shader_variant                                                  variant;
+    std::shared_ptr<texture>                                              target;
+    std::optional<pixel_rect>                                             scissor;
+    std::vector<std::array<std::shared_ptr<texture>, textures_per_slot>> slots;
+    std::vector<GLint>                                                    firsts;
+    std::vector<GLsizei>                                                  counts;
+};
+
 struct image_kernel::impl
 {
-    spl::shared_ptr<device> ogl_;
-    spl::shared_ptr<shader> shader_;
-    GLuint                  vao_;
-    GLuint                  vbo_;
+    spl::shared_ptr<device>    ogl_;
+    GLuint                     vao_;
+    stream_buffer<vertex>      vertices_;
+    stream_buffer<item_params> items_;
+    int                        batch_slots_ = 1;
+    batch                      batch_;
+
+    // The texture unit of each sampler of the shader, but the background.
+    std::vector<std::pair<std::string, int>> samplers_;
+
+    // Areas of each target which have been drawn since the last texture barrier, including those of the batch. A
+    // draw which reads any of them from its background has to wait for a barrier first.
+    std::vector<std::pair<const texture*, std::vector<pixel_rect>>> dirty_;
+
+    core::image_mixer::render_stats stats_;
+
+    std::map<image_shader_variant, std::shared_ptr<shader>> shaders_;
 
     explicit impl(const spl::shared_ptr<device>& ogl)
         : ogl_(ogl)
-        , shader_(ogl_->dispatch_sync([&] { return get_image_shader(ogl); }))
     {
         ogl_->dispatch_sync([&] {
-            GL(glGenVertexArrays(1, &vao_));
-            GL(glGenBuffers(1, &vbo_));
+            // Every slot takes a set of texture units, and the background one more.
+            GLint max_units = 0;
+            GL(glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units));
+            batch_slots_ = std::clamp(env::properties().get(L"configuration.accelerator.batch-slots", 4),
+                                      1,
+                                      std::max(1, (max_units - 1) / textures_per_slot));
+
+            for (int slot = 0; slot < batch_slots_; ++slot) {
+                auto unit = slot * textures_per_slot;
+                for (int n = 0; n < 4; ++n) {
+                    samplers_.emplace_back("plane[" + std::to_string(slot * 4 + n) + "]", unit + n);
+                }
+                auto index = "[" + std::to_string(slot) + "]";
+                samplers_.emplace_back("local_key" + index, unit + static_cast<int>(texture_id::local_key));
+                samplers_.emplace_back("layer_key" + index, unit + static_cast<int>(texture_id::layer_key));
+            }
+
+            // Compile the variants which plain layers need up front, so that the first frames do not stall on them.
+            if (env::properties().get(L"configuration.accelerator.prewarm-shaders", true)) {
+                for (auto format : {core::pixel_format::bgra,
+                                    core::pixel_format::rgba,
+                                    core::pixel_format::ycbcr,
+                                    core::pixel_format::ycbcra,
+                                    core::pixel_format::uyvy}) {
+                    for (auto is_straight_alpha : {false, true}) {
+                        image_shader_variant variant;
+                        variant.pixel_format      = static_cast<int>(format);
+                        variant.is_straight_alpha = is_straight_alpha;
+                        variant.batch_slots       = batch_slots_;
+                        get_shader(variant);
+                    }
+                }
+            }
+
+            GL(glCreateVertexArrays(1, &vao_));
+            vertices_.create(vertex_capacity);
+            items_.create(item_capacity);
+
+            // Attribute locations are fixed by the vertex shader, and so shared by all variants.
+            const GLuint vtx_loc  = 0;
+            const GLuint tex_loc  = 1;
+            const GLuint item_loc = 2;
+
+            GL(glVertexArrayVertexBuffer(vao_, 0, vertices_.id, 0, sizeof(vertex)));
+            GL(glVertexArrayAttribFormat(vao_, vtx_loc, 2, GL_FLOAT, GL_FALSE, offsetof(vertex, position)));
+            GL(glVertexArrayAttribFormat(vao_, tex_loc, 4, GL_FLOAT, GL_FALSE, offsetof(vertex, tex_coord)));
+            GL(glVertexArrayAttribIFormat(vao_, item_loc, 1, GL_INT, offsetof(vertex, item)));
+            GL(glVertexArrayAttribBinding(vao_, vtx_loc, 0));
+            GL(glVertexArrayAttribBinding(vao_, tex_loc, 0));
+            GL(glVertexArrayAttribBinding(vao_, item_loc, 0));
+            GL(glEnableVertexArrayAttrib(vao_, vtx_loc));
+            GL(glEnableVertexArrayAttrib(vao_, tex_loc));
+            GL(glEnableVertexArrayAttrib(vao_, item_loc));
         });
     }
 
     ~impl()
     {
         ogl_->dispatch_sync([&] {
+            vertices_.destroy();
+            items_.destroy();
             GL(glDeleteVertexArrays(1, &vao_));
-            GL(glDeleteBuffers(1, &vbo_));
         });
     }
 
-    void draw(draw_params params)
+    shader& get_shader(const image_shader_variant& variant)
     {
-        CASPAR_ASSERT(params.pix_desc.planes.size() == params.textures.size());
-
-        if (params.textures.empty() || !params.background) {
-            return;
+        auto& shader = shaders_[variant];
+        if (!shader) {
+            shader = get_image_shader(ogl_, variant);
         }
+        return *shader;
+    }
 
-        if (params.transforms.image_transform.opacity < epsilon) {
+    // Issues the batch as one draw call.
+    void flush()
+    {
+        if (batch_.counts.empty()) {
             return;
         }
 
-        auto coords = params.geometry.data();
-        if (coords.empty()) {
-            return;
+        auto& shader = get_shader(batch_.variant);
+        shader.use();
+
+        for (int slot = 0; slot < static_cast<int>(batch_.slots.size()); ++slot) {
+            for (int n = 0; n < textures_per_slot; ++n) {
+                if (batch_.slots[slot][n]) {
+                    batch_.slots[slot][n]->bind(slot * textures_per_slot + n);
+                }
+            }
+        }
+        for (auto& sampler : samplers_) {
+            shader.set(sampler.first, sampler.second);
         }
 
-        auto transforms = params.transforms;
+        const auto background_unit = batch_slots_ * textures_per_slot;
+        batch_.target->bind(background_unit);
+        shader.set("background", background_unit);
 
-        auto const first_plane = params.pix_desc.planes.at(0);
-        if (params.geometry.mode() != core::frame_geometry::scale_mode::stretch && first_plane.width > 0 &&
-            first_plane.height > 0) {
-            auto width_scale  = static_cast<double>(params.target_width) / static_cast<double>(first_plane.width);
-            auto height_scale = static_cast<double>(params.target_height) / static_cast<double>(first_plane.height);
+        // Setup drawing area
 
-            core::image_transform transform;
-            double                target_scale;
-            switch (params.geometry.mode()) {
-                case core::frame_geometry::scale_mode::fit:
-                    target_scale = std::min(width_scale, height_scale);
+        GL(glViewport(0, 0, batch_.target->width(), batch_.target->height()));
+        glDisable(GL_DEPTH_TEST);
 
-                    transform.fill_scale[0] *= target_scale / width_scale;
-                    transform.fill_scale[1] *= target_scale / height_scale;
-                    break;
+        // Set render target
+        batch_.target->attach();
 
-                case core::frame_geometry::scale_mode::fill:
-                    target_scale = std::max(width_scale, height_scale);
-                    transform.fill_scale[0] *= target_scale / width_scale;
-                    transform.fill_scale[1] *= target_scale / height_scale;
-                    break;
+        if (batch_.scissor) {
+            auto& rect = *batch_.scissor;
+            GL(glEnable(GL_SCISSOR_TEST));
+            GL(glScissor(rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0));
+        }
 
-                case core::frame_geometry::scale_mode::original:
-                    transform.fill_scale[0] /= width_scale;
-                    transform.fill_scale[1] /= height_scale;
-                    break;
+        // Draw
+        GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, items_.id));
+        GL(glBindVertexArray(vao_));
+        GL(glMultiDrawArrays(GL_TRIANGLE_FAN,
+                             batch_.firsts.data(),
+                             batch_.counts.data(),
+                             static_cast<GLsizei>(batch_.counts.size())));
+        GL(glBindVertexArray(0));
+        GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0));
+        stats_.draw_calls++;
 
-                case core::frame_geometry::scale_mode::hfill:
-                    transform.fill_scale[1] *= width_scale / height_scale;
-                    break;
+        // Cleanup
+        GL(glDisable(GL_SCISSOR_TEST));
+        GL(glDisable(GL_BLEND));
 
-                case core::frame_geometry::scale_mode::vfill:
-                    transform.fill_scale[0] *= height_scale / width_scale;
-                    break;
+        batch_.target.reset();
+        batch_.slots.clear();
+        batch_.firsts.clear();
+        batch_.counts.clear();
+    }
 
-                default:;
-            }
+    void texture_barrier()
+    {
+        flush();
+        GL(glTextureBarrier());
+        stats_.texture_barriers++;
+        dirty_.clear();
+    }
+    // Issues a texture barrier if any of source was drawn since the last one.
+    void read(const texture* source)
+    {
+        if (source && std::any_of(dirty_.begin(), dirty_.end(), [&](const auto& p) { return p.first == source; })) {
+            texture_barrier();
+        }
+    }
 
-            transforms = transforms.combine_transform(transform, params.aspect_ratio);
+    // Issues a texture barrier if rect of target was drawn since the last one, and records it as drawn.
+    void read_and_write(const texture* target, const pixel_rect& rect)
+    {
+        auto it = std::find_if(dirty_.begin(), dirty_.end(), [&](const auto& p) { return p.first == target; });
+        if (it != dirty_.end() &&
+            std::any_of(it->second.begin(), it->second.end(), [&](const auto& r) { return r.intersects(rect); })) {
+            texture_barrier();
+            it = dirty_.end();
+        }
+        if (it == dirty_.end()) {
+            dirty_.emplace_back(target, std::vector<pixel_rect>{});
+            it = std::prev(dirty_.end());
+        }
+        it->second.push_back(rect);
+    }
+
+    core::image_mixer::render_stats end_frame()
+    {
+        if (!dirty_.empty()) {
+            texture_barrier();
+        }
+        return std::exchange(stats_, core::image_mixer::render_stats{});
+    }
+
+    // Returns the coords of params in target space, or nothing if the draw would not be visible. transforms is set
+    // to the transforms the draw is made with.
+    std::vector<core::frame_geometry::coord> transform_coords(const draw_params& params, draw_transforms& transforms)
+    {
+        if (params.transforms.image_transform.opacity < epsilon) {
+            return {};
         }
 
+        auto coords = params.geometry.data();
+        if (coords.empty()) {
+            return {};
+        }
+
+        transforms = params.transforms;
+
+        transforms = transforms.combine_scale_mode(params.geometry.mode(),
+                                                   params.pix_desc.planes.at(0),
+                                                   params.target_width,
+                                                   params.target_height,
+                                                   params.aspect_ratio);
+
         coords = transforms.transform_coords(coords);
 
         // Skip drawing if all the coordinates will be outside the screen.
         if (coords.size() < 3 || is_outside_screen(coords)) {
-            return;
+            return {};
         }
 
-        double precision_factor[4] = {1, 1, 1, 1};
+        return coords;
+    }
 
-        // Bind textures
+    // Returns the pixels covered by coords, padded by a pixel for filtering.
+    static pixel_rect bounds(const std::vector<core::frame_geometry::coord>& coords, int width, int height)
+    {
+        if (coords.empty()) {
+            return {};
+        }
 
-        for (int n = 0; n < params.textures.size(); ++n) {
-            params.textures[n]->bind(n);
-            precision_factor[n] = get_precision_factor(params.textures[n]->depth());
+        auto min_x = 1.0;
+        auto min_y = 1.0;
+        auto max_x = 0.0;
+        auto max_y = 0.0;
+        for (auto& coord : coords) {
+            min_x = std::min(min_x, coord.vertex_x);
+            min_y = std::min(min_y, coord.vertex_y);
+            max_x = std::max(max_x, coord.vertex_x);
+            max_y = std::max(max_y, coord.vertex_y);
         }
+        return pixel_rect{std::max(0, static_cast<int>(std::floor(min_x * width)) - 1),
+                          std::max(0, static_cast<int>(std::floor(min_y * height)) - 1),
+                          std::min(width, static_cast<int>(std::ceil(max_x * width)) + 1),
+                          std::min(height, static_cast<int>(std::ceil(max_y * height)) + 1)};
+    }
+
+    pixel_rect bounds(const draw_params& params, int width, int height)
+    {
+        draw_transforms transforms;
+        return bounds(transform_coords(params, transforms), width, height);
+    }
+
+    void draw(draw_params params)
+    {
+        CASPAR_ASSERT(params.pix_desc.planes.size() == params.textures.size());
 
-        if (params.local_key) {
-            params.local_key->bind(static_cast<int>(texture_id::local_key));
+        if (params.textures.empty() || !params.background) {
+            return;
         }
 
-        if (params.layer_key) {
-            params.layer_key->bind(static_cast<int>(texture_id::layer_key));
+        draw_transforms transforms;
+        auto            coords = transform_coords(params, transforms);
+        if (coords.empty()) {
+            return;
+        }
+
+        // The shader blends with the background, which is also the render target. Only wait for earlier draws when
+        // they touched the pixels this one covers.
+        auto rect = bounds(coords, params.background->width(), params.background->height());
+        if (params.scissor) {
+            rect = rect.intersected(*params.scissor);
+        }
+        if (rect.empty()) {
+            return;
         }
 
         const auto is_hd       = params.pix_desc.planes.at(0).height > 700;
@@ -203,123 +505,130 @@ struct image_kernel::impl
                                                {0.2627, 0.6780, 0.0593}}; // bt.2020
         const auto  luma_coeff              = luma_coefficients[static_cast<int>(color_space)];
 
-        // Setup shader
-        shader_->use();
-
-        shader_->set("is_straight_alpha", params.pix_desc.is_straight_alpha);
-        shader_->set("plane[0]", texture_id::plane0);
-        shader_->set("plane[1]", texture_id::plane1);
-        shader_->set("plane[2]", texture_id::plane2);
-        shader_->set("plane[3]", texture_id::plane3);
-        shader_->set("precision_factor[0]", precision_factor[0]);
-        shader_->set("precision_factor[1]", precision_factor[1]);
-        shader_->set("precision_factor[2]", precision_factor[2]);
-        shader_->set("precision_factor[3]", precision_factor[3]);
-        shader_->set("local_key", texture_id::local_key);
-        shader_->set("layer_key", texture_id::layer_key);
-        shader_->set_matrix3("color_matrix", color_matrix);
-        shader_->set("luma_coeff", luma_coeff[0], luma_coeff[1], luma_coeff[2]);
-        shader_->set("has_local_key", static_cast<bool>(params.local_key));
-        shader_->set("has_layer_key", static_cast<bool>(params.layer_key));
-        shader_->set("pixel_format", params.pix_desc.format);
-        shader_->set("opacity", transforms.image_transform.is_key ? 1.0 : transforms.image_transform.opacity);
-
-        if (transforms.image_transform.chroma.enable) {
-            shader_->set("chroma", true);
-            shader_->set("chroma_show_mask", transforms.image_transform.chroma.show_mask);
-            shader_->set("chroma_target_hue", transforms.image_transform.chroma.target_hue / 360.0);
-            shader_->set("chroma_hue_width", transforms.image_transform.chroma.hue_width);
-            shader_->set("chroma_min_saturation", transforms.image_transform.chroma.min_saturation);
-            shader_->set("chroma_min_brightness", transforms.image_transform.chroma.min_brightness);
-            shader_->set("chroma_softness", 1.0 + transforms.image_transform.chroma.softness);
-            shader_->set("chroma_spill_suppress", transforms.image_transform.chroma.spill_suppress / 360.0);
-            shader_->set("chroma_spill_suppress_saturation",
-                         transforms.image_transform.chroma.spill_suppress_saturation);
-        } else {
-            shader_->set("chroma", false);
-        }
-
-        // Setup blend_func
-
         if (transforms.image_transform.is_key) {
             params.blend_mode = core::blend_mode::normal;
         }
 
-        params.background->bind(static_cast<int>(texture_id::background));
-        shader_->set("background", texture_id::background);
-        shader_->set("blend_mode", params.blend_mode);
-        shader_->set("keyer", params.keyer);
+        // Setup shader
 
-        // Setup image-adjustments
-        shader_->set("invert", transforms.image_transform.invert);
-
-        if (transforms.image_transform.levels.min_input > epsilon ||
-            transforms.image_transform.levels.max_input < 1.0 - epsilon ||
-            transforms.image_transform.levels.min_output > epsilon ||
-            transforms.image_transform.levels.max_output < 1.0 - epsilon ||
-            std::abs(transforms.image_transform.levels.gamma - 1.0) > epsilon) {
-            shader_->set("levels", true);
-            shader_->set("min_input", transforms.image_transform.levels.min_input);
-            shader_->set("max_input", transforms.image_transform.levels.max_input);
-            shader_->set("min_output", transforms.image_transform.levels.min_output);
-            shader_->set("max_output", transforms.image_transform.levels.max_output);
-            shader_->set("gamma", transforms.image_transform.levels.gamma);
-        } else {
-            shader_->set("levels", false);
+        image_shader_variant variant;
+        variant.pixel_format      = static_cast<int>(params.pix_desc.format);
+        variant.blend_mode        = static_cast<int>(params.blend_mode);
+        variant.keyer             = static_cast<int>(params.keyer);
+        variant.is_straight_alpha = params.pix_desc.is_straight_alpha;
+        variant.has_local_key     = static_cast<bool>(params.local_key);
+        variant.has_layer_key     = static_cast<bool>(params.layer_key);
+        variant.chroma            = transforms.image_transform.chroma.enable;
+        variant.invert            = transforms.image_transform.invert;
+        variant.batch_slots       = batch_slots_;
+
+        const auto& levels = transforms.image_transform.levels;
+        variant.levels     = levels.min_input > epsilon || levels.max_input < 1.0 - epsilon ||
+                         levels.min_output > epsilon || levels.max_output < 1.0 - epsilon ||
+                         std::abs(levels.gamma - 1.0) > epsilon;
+        variant.csb = std::abs(transforms.image_transform.brightness - 1.0) > epsilon ||
+                      std::abs(transforms.image_transform.saturation - 1.0) > epsilon ||
+                      std::abs(transforms.image_transform.contrast - 1.0) > epsilon;
+
+        for (auto& texture : params.textures) {
+            read(texture.get());
         }
-
-        if (std::abs(transforms.image_transform.brightness - 1.0) > epsilon ||
-            std::abs(transforms.image_transform.saturation - 1.0) > epsilon ||
-            std::abs(transforms.image_transform.contrast - 1.0) > epsilon) {
-            shader_->set("csb", true);
-
-            shader_->set("brt", transforms.image_transform.brightness);
-            shader_->set("sat", transforms.image_transform.saturation);
-            shader_->set("con", transforms.image_transform.contrast);
-        } else {
-            shader_->set("csb", false);
+        read(params.local_key.get());
+        read(params.layer_key.get());
+        read_and_write(params.background.get(), rect);
+
+        // Join the batch if it draws with the same program and state, and has a slot with these textures or room for
+        // another.
+        std::array<std::shared_ptr<texture>, textures_per_slot> textures;
+        for (std::size_t n = 0; n < params.textures.size(); ++n) {
+            textures[n] = params.textures[n];
+        }
+        textures[static_cast<int>(texture_id::local_key)] = params.local_key;
+        textures[static_cast<int>(texture_id::layer_key)] = params.layer_key;
+
+        auto same_scissor = [&] {
+            return batch_.scissor.has_value() == params.scissor.has_value() &&
+                   (!params.scissor || (batch_.scissor->x0 == params.scissor->x0 &&
+                                        batch_.scissor->y0 == params.scissor->y0 &&
+                                        batch_.scissor->x1 == params.scissor->x1 &&
+                                        batch_.scissor->y1 == params.scissor->y1));
+        };
+        auto has_slot = [&] {
+            return static_cast<int>(batch_.slots.size()) < batch_slots_ ||
+                   std::find(batch_.slots.begin(), batch_.slots.end(), textures) != batch_.slots.end();
+        };
+        if (!batch_.counts.empty() && (batch_.variant.tie() != variant.tie() || batch_.target != params.background ||
+                                       !same_scissor() || !has_slot())) {
+            flush();
         }
 
-        // Setup drawing area
-
-        GL(glViewport(0, 0, params.background->width(), params.background->height()));
-        glDisable(GL_DEPTH_TEST);
-
-        // Set render target
-        params.background->attach();
-
-        // Draw
-        GL(glBindVertexArray(vao_));
-        GL(glBindBuffer(GL_ARRAY_BUFFER, vbo_));
-
-        GL(glBufferData(GL_ARRAY_BUFFER,
-                        static_cast<GLsizeiptr>(sizeof(core::frame_geometry::coord)) * coords.size(),
-                        coords.data(),
-                        GL_STATIC_DRAW));
-
-        auto stride = static_cast<GLsizei>(sizeof(core::frame_geometry::coord));
+        auto item  = items_.allocate(1, [&] { flush(); });
+        auto first = vertices_.allocate(static_cast<GLsizei>(coords.size()), [&] { flush(); });
 
-        auto vtx_loc = shader_->get_attrib_location("Position");
-        auto tex_loc = shader_->get_attrib_location("TexCoordIn");
+        if (batch_.counts.empty()) {
+            batch_.variant = variant;
+            batch_.target  = params.background;
+            batch_.scissor = params.scissor;
+        }
 
-        GL(glEnableVertexAttribArray(vtx_loc));
-        GL(glEnableVertexAttribArray(tex_loc));
+        auto slot = std::find(batch_.slots.begin(), batch_.slots.end(), textures) - batch_.slots.begin();
+        if (slot == static_cast<std::ptrdiff_t>(batch_.slots.size())) {
+            batch_.slots.push_back(textures);
+        }
 
-        GL(glVertexAttribPointer(vtx_loc, 2, GL_DOUBLE, GL_FALSE, stride, nullptr));
-        GL(glVertexAttribPointer(tex_loc, 4, GL_DOUBLE, GL_FALSE, stride, (GLvoid*)(2 * sizeof(GLdouble))));
+        // Setup item parameters
 
-        GL(glDrawArrays(GL_TRIANGLE_FAN, 0, static_cast<GLsizei>(coords.size())));
-        GL(glTextureBarrier());
+        auto& p = items_.data[item];
+        for (int row = 0; row < 3; ++row) {
+            for (int column = 0; column < 3; ++column) {
+                p.color_matrix[column][row] = color_matrix[row * 3 + column];
+            }
+            p.luma_coeff[row] = luma_coeff[row];
+        }
+        for (int n = 0; n < 4; ++n) {
+            p.precision_factor[n] =
+                n < static_cast<int>(params.textures.size())
+                    ? static_cast<float>(get_precision_factor(params.textures[n]->depth()))
+                    : 1.0f;
+        }
+        p.opacity = static_cast<float>(transforms.image_transform.is_key ? 1.0 : transforms.image_transform.opacity);
 
-        GL(glDisableVertexAttribArray(vtx_loc));
-        GL(glDisableVertexAttribArray(tex_loc));
+        // Setup image-adjustments
 
-        GL(glBindVertexArray(0));
-        GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        p.min_input  = static_cast<float>(levels.min_input);
+        p.max_input  = static_cast<float>(levels.max_input);
+        p.min_output = static_cast<float>(levels.min_output);
+        p.max_output = static_cast<float>(levels.max_output);
+        p.gamma      = static_cast<float>(levels.gamma);
+        p.brt        = static_cast<float>(transforms.image_transform.brightness);
+        p.sat        = static_cast<float>(transforms.image_transform.saturation);
+        p.con        = static_cast<float>(transforms.image_transform.contrast);
+
+        const auto& chroma                 = transforms.image_transform.chroma;
+        p.chroma_show_mask                 = chroma.show_mask ? 1 : 0;
+        p.chroma_target_hue                = static_cast<float>(chroma.target_hue / 360.0);
+        p.chroma_hue_width                 = static_cast<float>(chroma.hue_width);
+        p.chroma_min_saturation            = static_cast<float>(chroma.min_saturation);
+        p.chroma_min_brightness            = static_cast<float>(chroma.min_brightness);
+        p.chroma_softness                  = static_cast<float>(1.0 + chroma.softness);
+        p.chroma_spill_suppress            = static_cast<float>(chroma.spill_suppress / 360.0);
+        p.chroma_spill_suppress_saturation = static_cast<float>(chroma.spill_suppress_saturation);
+        p.slot                             = static_cast<std::int32_t>(slot);
+
+        for (std::size_t n = 0; n < coords.size(); ++n) {
+            auto& v        = vertices_.data[first + n];
+            v.position[0]  = static_cast<float>(coords[n].vertex_x);
+            v.position[1]  = static_cast<float>(coords[n].vertex_y);
+            v.tex_coord[0] = static_cast<float>(coords[n].texture_x);
+            v.tex_coord[1] = static_cast<float>(coords[n].texture_y);
+            v.tex_coord[2] = static_cast<float>(coords[n].texture_r);
+            v.tex_coord[3] = static_cast<float>(coords[n].texture_q);
+            v.item         = item;
+        }
 
-        // Cleanup
-        GL(glDisable(GL_SCISSOR_TEST));
-        GL(glDisable(GL_BLEND));
+        batch_.firsts.push_back(first);
+        batch_.counts.push_back(static_cast<GLsizei>(coords.size()));
+        stats_.draw_items++;
     }
 };
 
@@ -328,6 +637,11 @@ image_kernel::image_kernel(const spl::shared_ptr<device>& ogl)
 {
 }
 image_kernel::~image_kernel() {}
-void image_kernel::draw(const draw_params& params) { impl_->draw(params); }
+void       image_kernel::draw(const draw_params& params) { impl_->draw(params); }
+pixel_rect image_kernel::bounds(const draw_params& params, int width, int height)
+{
+    return impl_->bounds(params, width, height);
+}
+core::image_mixer::render_stats image_kernel::end_frame() { return impl_->end_frame(); }
 
 } // namespace caspar::accelerator::ogl
@@ -28,7 +28,10 @@
 #include <core/frame/frame_transform.h>
 #include <core/frame/geometry.h>
 #include <core/frame/pixel_format.h>
+#include <core/mixer/image/image_mixer.h>
 
+#include <algorithm>
+#include <optional>
 #include <utility>
 
 #include "../util/matrix.h"
@@ -42,6 +45,37 @@ enum class keyer
     additive,
 };
 
+// A rectangle of pixels, [x0, x1) x [y0, y1), counted from the first row of the texture.
+struct pixel_rect final
+{
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    int  area() const { return empty() ? 0 : (x1 - x0) * (y1 - y0); }
+
+    bool intersects(const pixel_rect& other) const
+    {
+        return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+    }
+
+    pixel_rect intersected(const pixel_rect& other) const
+    {
+        return {std::max(x0, other.x0), std::max(y0, other.y0), std::min(x1, other.x1), std::min(y1, other.y1)};
+    }
+
+    pixel_rect united(const pixel_rect& other) const
+    {
+        if (empty())
+            return other;
+        if (other.empty())
+            return *this;
+        return {std::min(x0, other.x0), std::min(y0, other.y0), std::max(x1, other.x1), std::max(y1, other.y1)};
+    }
+};
+
 struct draw_params final
 {
     core::pixel_format_desc                     pix_desc = core::pixel_format_desc(core::pixel_format::invalid);
@@ -56,6 +90,7 @@ struct draw_params final
     double                                      aspect_ratio = 1.0;
     int                                         target_width;
     int                                         target_height;
+    std::optional<pixel_rect>                   scissor;
 };
 
 class image_kernel final
@@ -67,8 +102,18 @@ class image_kernel final
     explicit image_kernel(const spl::shared_ptr<class device>& ogl);
     ~image_kernel();
 
+    // Draws are batched, and issued once a draw can't join the batch, a texture barrier is needed or the frame ends.
+    // Textures which are drawn to or sampled must not be written otherwise until then.
     void draw(const draw_params& params);
 
+    // Returns the pixels of a width x height background which drawing params would touch. Textures and background
+    // are not needed.
+    pixel_rect bounds(const draw_params& params, int width, int height);
+
+    // Makes everything drawn so far visible to later draws, and returns the draw calls and texture barriers issued
+    // since the previous call.
+    core::image_mixer::render_stats end_frame();
+
   private:
     struct impl;
     spl::unique_ptr<impl> impl_;
@@ -20,6 +20,7 @@
  */
 #include "image_mixer.h"
 
+#include "image_converter.h"
 #include "image_kernel.h"
 
 #include "../util/buffer.h"
@@ -36,24 +37,61 @@
 #include <core/frame/frame.h>
 #include <core/frame/frame_transform.h>
 #include <core/frame/geometry.h>
+#include <core/frame/output_format.h>
 #include <core/frame/pixel_format.h>
 #include <core/video_format.h>
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <any>
+#include <atomic>
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace caspar { namespace accelerator { namespace ogl {
 
 using future_texture = std::shared_future<std::shared_ptr<texture>>;
 
-struct item
+// Textures uploaded for a frame. They are stored as the frame's opaque value, so a frame which is drawn on many ticks,
+// such as a still image or a paused clip, is only uploaded once and its textures are released with the frame.
+struct frame_textures
 {
-    core::pixel_format_desc     pix_desc = core::pixel_format_desc(core::pixel_format::invalid);
+    const device*               owner = nullptr; // Textures can only be drawn by the device which uploaded them.
     std::vector<future_texture> textures;
-    draw_transforms             transforms;
-    core::frame_geometry        geometry = core::frame_geometry::get_default();
+    std::shared_ptr<void>       resident;
+    std::atomic<bool>           drawn{false};
+};
+
+template <typename ImageData>
+std::shared_ptr<frame_textures>
+upload_frame_textures(device& ogl, const ImageData& image_data, const core::pixel_format_desc& desc)
+{
+    auto result   = std::make_shared<frame_textures>();
+    result->owner = &ogl;
+
+    std::size_t size = 0;
+    for (int n = 0; n < static_cast<int>(desc.planes.size()); ++n) {
+        result->textures.emplace_back(ogl.copy_async(image_data[n],
+                                                     desc.planes[n].width,
+                                                     desc.planes[n].height,
+                                                     desc.planes[n].stride,
+                                                     desc.planes[n].depth));
+        size += image_data[n].size();
+    }
+    result->resident = ogl.retain_frame_textures(size);
+
+    return result;
+}
+
+struct item
+{
+    core::pixel_format_desc         pix_desc = core::pixel_format_desc(core::pixel_format::invalid);
+    std::shared_ptr<frame_textures> source;
+    std::vector<future_texture>     textures;
+    draw_transforms                 transforms;
+    core::frame_geometry            geometry = core::frame_geometry::get_default();
 };
 
 struct layer
@@ -68,43 +106,194 @@ struct layer
     }
 };
 
+// Everything which decides what the layers of a tick render to. Ticks with equal fingerprints render equal images.
+struct scene_fingerprint
+{
+    std::vector<double> values;
+
+    // The frames drawn. They are kept alive so that their addresses can not be reused by other frames.
+    std::vector<std::shared_ptr<frame_textures>> sources;
+
+    scene_fingerprint() = default;
+
+    scene_fingerprint(const std::vector<layer>&               layers,
+                      const core::video_format_desc&          format_desc,
+                      const std::vector<core::output_format>& formats,
+                      core::color_space                       color_space)
+    {
+        values.insert(values.end(),
+                      {static_cast<double>(format_desc.width),
+                       static_cast<double>(format_desc.height),
+                       static_cast<double>(format_desc.square_width),
+                       static_cast<double>(format_desc.square_height),
+                       static_cast<double>(color_space),
+                       static_cast<double>(formats.size())});
+        for (auto format : formats) {
+            values.push_back(static_cast<double>(format));
+        }
+        add(layers);
+    }
+
+    bool operator==(const scene_fingerprint& other) const
+    {
+        return sources == other.sources && values == other.values;
+    }
+
+  private:
+    void add(const std::vector<layer>& layers)
+    {
+        for (auto& layer : layers) {
+            values.insert(values.end(),
+                          {static_cast<double>(layer.blend_mode),
+                           static_cast<double>(layer.sublayers.size()),
+                           static_cast<double>(layer.items.size())});
+            add(layer.sublayers);
+
+            for (auto& item : layer.items) {
+                sources.push_back(item.source);
+
+                auto& transform = item.transforms.image_transform;
+                values.insert(values.end(),
+                              {transform.opacity,
+                               transform.contrast,
+                               transform.brightness,
+                               transform.saturation,
+                               transform.levels.min_input,
+                               transform.levels.max_input,
+                               transform.levels.gamma,
+                               transform.levels.min_output,
+                               transform.levels.max_output,
+                               static_cast<double>(transform.chroma.enable),
+                               static_cast<double>(transform.chroma.show_mask),
+                               transform.chroma.target_hue,
+                               transform.chroma.hue_width,
+                               transform.chroma.min_saturation,
+                               transform.chroma.min_brightness,
+                               transform.chroma.softness,
+                               transform.chroma.spill_suppress,
+                               transform.chroma.spill_suppress_saturation,
+                               static_cast<double>(transform.is_key),
+                               static_cast<double>(transform.is_mix),
+                               static_cast<double>(transform.invert),
+                               static_cast<double>(item.geometry.mode())});
+
+                // The transformed coords stand in for every geometry transform, crop and perspective.
+                for (auto& coord : item.transforms.transform_coords(item.geometry.data())) {
+                    values.insert(values.end(),
+                                  {coord.vertex_x,
+                                   coord.vertex_y,
+                                   coord.texture_x,
+                                   coord.texture_y,
+                                   coord.texture_r,
+                                   coord.texture_q});
+                }
+            }
+        }
+    }
+};
+
 class image_renderer
 {
     spl::shared_ptr<device> ogl_;
     image_kernel            kernel_;
+    image_converter         converter_;
     const size_t            max_frame_size_;
     common::bit_depth       depth_;
+    std::atomic<int>        draw_calls_{0};
+    std::atomic<int>        draw_items_{0};
+    std::atomic<int>        texture_barriers_{0};
+    std::atomic<int>        readback_depth_{2};
+
+    // Render targets are reused in turn, so that a target is not written again until the readback_depth frames
+    // rendered after it have been read back. Only accessed on the device thread.
+    std::vector<std::shared_ptr<texture>> targets_;
+    std::size_t                           next_target_ = 0;
 
   public:
     explicit image_renderer(const spl::shared_ptr<device>& ogl, const size_t max_frame_size, common::bit_depth depth)
         : ogl_(ogl)
         , kernel_(ogl_)
+        , converter_(ogl_)
         , max_frame_size_(max_frame_size)
         , depth_(depth)
     {
     }
 
-    std::future<array<const std::uint8_t>> operator()(std::vector<layer>             layers,
-                                                      const core::video_format_desc& format_desc)
+    std::future<core::converted_images> operator()(std::vector<layer>                      layers,
+                                                   const core::video_format_desc&          format_desc,
+                                                   const std::vector<core::output_format>& formats,
+                                                   core::color_space                       color_space)
     {
-        if (layers.empty()) { // Bypass GPU with empty frame.
+        if (layers.empty() && formats == std::vector<core::output_format>{core::output_format::bgra}) {
+            // Bypass GPU with empty frame.
             static const std::vector<uint8_t, boost::alignment::aligned_allocator<uint8_t, 32>> buffer(max_frame_size_, 0);
-            return make_ready_future(array<const std::uint8_t>(buffer.data(), format_desc.size, true));
+            core::converted_images images;
+            images.emplace(core::output_format::bgra, array<const std::uint8_t>(buffer.data(), format_desc.size, true));
+            return make_ready_future(std::move(images));
         }
 
         return flatten(ogl_->dispatch_async(
-            [&, layers = std::move(layers)]() mutable -> std::shared_future<array<const std::uint8_t>> {
-                auto target_texture = ogl_->create_texture(format_desc.width, format_desc.height, 4, depth_);
+            [&, layers = std::move(layers), formats, color_space]() mutable -> std::future<core::converted_images> {
+                auto target_texture = next_target(format_desc);
 
                 draw(target_texture, std::move(layers), format_desc);
 
-                return ogl_->copy_async(target_texture);
+                auto stats = kernel_.end_frame();
+                draw_calls_       = stats.draw_calls;
+                draw_items_       = stats.draw_items;
+                texture_barriers_ = stats.texture_barriers;
+
+                // Read back each format, rather than the image, when it can be converted here. The rest are left to
+                // the caller, which converts them from the image.
+                bool needs_image = false;
+                std::vector<std::pair<core::output_format, std::future<array<const std::uint8_t>>>> reads;
+                for (auto format : formats) {
+                    if (converter_.supports(format, format_desc.width, format_desc.height)) {
+                        reads.emplace_back(format, converter_(target_texture, format, color_space));
+                    } else {
+                        needs_image = true;
+                    }
+                }
+                if (needs_image) {
+                    reads.emplace_back(core::output_format::bgra, ogl_->copy_async(target_texture));
+                }
+
+                return std::async(std::launch::deferred, [reads = std::move(reads)]() mutable {
+                    core::converted_images images;
+                    for (auto& read : reads) {
+                        images.emplace(read.first, read.second.get());
+                    }
+                    return images;
+                });
             }));
     }
 
     common::bit_depth depth() const { return depth_; }
 
+    void set_readback_depth(int frames) { readback_depth_ = std::max(1, frames); }
+
+    core::image_mixer::render_stats last_render_stats() const
+    {
+        return core::image_mixer::render_stats{draw_calls_, draw_items_, texture_barriers_};
+    }
+
   private:
+    std::shared_ptr<texture> next_target(const core::video_format_desc& format_desc)
+    {
+        // Both fields of an interlaced frame are in flight at once.
+        targets_.resize(static_cast<std::size_t>(readback_depth_ * std::max(1, format_desc.field_count)));
+        next_target_ %= targets_.size();
+
+        auto& target = targets_[next_target_++];
+        if (target && target->width() == format_desc.width && target->height() == format_desc.height &&
+            target->depth() == depth_) {
+            target->clear();
+        } else {
+            target = ogl_->create_texture(format_desc.width, format_desc.height, 4, depth_);
+        }
+        return target;
+    }
+
     void draw(std::shared_ptr<texture>&      target_texture,
               std::vector<layer>             layers,
               const core::video_format_desc& format_desc)
@@ -125,55 +314,101 @@ class image_renderer
         if (layer.items.empty())
             return;
 
+        // Find the pixels each item draws to, so that intermediate textures are only cleared and composited where
+        // something is drawn. mix_damage[n] is what the mix texture receives from item n until it is drawn.
+        std::vector<pixel_rect> mix_damage(layer.items.size());
+        pixel_rect              layer_damage;
+        pixel_rect              run_damage;
+        int                     visible_items = 0;
+        bool                    has_mix       = false;
+        for (auto n = layer.items.size(); n-- > 0;) {
+            auto& image_transform = layer.items[n].transforms.image_transform;
+            if (!image_transform.is_key) {
+                auto bounds = kernel_.bounds(
+                    make_draw_params(layer.items[n], format_desc), target_texture->width(), target_texture->height());
+                run_damage   = image_transform.is_mix ? run_damage.united(bounds) : pixel_rect{};
+                layer_damage = layer_damage.united(bounds);
+                visible_items += bounds.empty() ? 0 : 1;
+                has_mix = has_mix || image_transform.is_mix;
+            }
+            mix_damage[n] = run_damage;
+        }
+
         std::shared_ptr<texture> local_key_texture;
         std::shared_ptr<texture> local_mix_texture;
+        pixel_rect               local_mix_damage;
 
-        if (layer.blend_mode != core::blend_mode::normal) {
-            auto layer_texture = ogl_->create_texture(target_texture->width(), target_texture->height(), 4, depth_);
+        // A single item can be blended straight onto the target, and if nothing is visible there is nothing to blend.
+        if (layer.blend_mode != core::blend_mode::normal && (visible_items > 1 || has_mix)) {
+            auto layer_texture =
+                ogl_->create_texture(target_texture->width(), target_texture->height(), 4, depth_, false);
+            clear(*layer_texture, layer_damage);
 
-            for (auto& item : layer.items)
+            for (std::size_t n = 0; n < layer.items.size(); ++n)
                 draw(layer_texture,
-                     std::move(item),
+                     std::move(layer.items[n]),
                      layer_key_texture,
                      local_key_texture,
                      local_mix_texture,
+                     local_mix_damage,
+                     mix_damage[n],
+                     core::blend_mode::normal,
                      format_desc);
 
-            draw(layer_texture, std::move(local_mix_texture), format_desc, core::blend_mode::normal);
-            draw(target_texture, std::move(layer_texture), format_desc, layer.blend_mode);
+            draw(layer_texture, std::move(local_mix_texture), format_desc, core::blend_mode::normal, local_mix_damage);
+            draw(target_texture, std::move(layer_texture), format_desc, layer.blend_mode, layer_damage);
         } else // fast path
         {
-            for (auto& item : layer.items)
+            for (std::size_t n = 0; n < layer.items.size(); ++n)
                 draw(target_texture,
-                     std::move(item),
+                     std::move(layer.items[n]),
                      layer_key_texture,
                      local_key_texture,
                      local_mix_texture,
+                     local_mix_damage,
+                     mix_damage[n],
+                     layer.blend_mode,
                      format_desc);
 
-            draw(target_texture, std::move(local_mix_texture), format_desc, core::blend_mode::normal);
+            draw(target_texture, std::move(local_mix_texture), format_desc, core::blend_mode::normal, local_mix_damage);
         }
 
         layer_key_texture = std::move(local_key_texture);
     }
 
-    void draw(std::shared_ptr<texture>&      target_texture,
-              item                           item,
-              std::shared_ptr<texture>&      layer_key_texture,
-              std::shared_ptr<texture>&      local_key_texture,
-              std::shared_ptr<texture>&      local_mix_texture,
-              const core::video_format_desc& format_desc)
+    static draw_params make_draw_params(const item& item, const core::video_format_desc& format_desc)
     {
         draw_params draw_params;
         draw_params.target_width  = format_desc.square_width;
         draw_params.target_height = format_desc.square_height;
         // TODO: Pass the target color_space
 
-        draw_params.pix_desc   = std::move(item.pix_desc);
-        draw_params.transforms = std::move(item.transforms);
-        draw_params.geometry   = std::move(item.geometry);
+        draw_params.pix_desc   = item.pix_desc;
+        draw_params.transforms = item.transforms;
+        draw_params.geometry   = item.geometry;
         draw_params.aspect_ratio =
             static_cast<double>(format_desc.square_width) / static_cast<double>(format_desc.square_height);
+        return draw_params;
+    }
+
+    static void clear(texture& texture, const pixel_rect& rect)
+    {
+        if (!rect.empty()) {
+            texture.clear(rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0);
+        }
+    }
+
+    void draw(std::shared_ptr<texture>&      target_texture,
+              item                           item,
+              std::shared_ptr<texture>&      layer_key_texture,
+              std::shared_ptr<texture>&      local_key_texture,
+              std::shared_ptr<texture>&      local_mix_texture,
+              pixel_rect&                    local_mix_damage,
+              const pixel_rect&              mix_damage,
+              core::blend_mode               blend_mode,
+              const core::video_format_desc& format_desc)
+    {
+        auto draw_params = make_draw_params(item, format_desc);
 
         for (auto& future_texture : item.textures) {
             draw_params.textures.push_back(spl::make_shared_ptr(future_texture.get()));
@@ -192,9 +427,12 @@ class image_renderer
             kernel_.draw(std::move(draw_params));
         } else if (draw_params.transforms.image_transform
                        .is_mix) { // A mix means precomp the items to a texture, before drawing to the channel
-            local_mix_texture =
-                local_mix_texture ? local_mix_texture
-                                  : ogl_->create_texture(target_texture->width(), target_texture->height(), 4, depth_);
+            if (!local_mix_texture) {
+                local_mix_texture =
+                    ogl_->create_texture(target_texture->width(), target_texture->height(), 4, depth_, false);
+                local_mix_damage = mix_damage;
+                clear(*local_mix_texture, local_mix_damage);
+            }
 
             draw_params.background = local_mix_texture;
             draw_params.local_key  = std::move(local_key_texture); // Use and reset the key
@@ -205,22 +443,25 @@ class image_renderer
             kernel_.draw(std::move(draw_params));
         } else {
             // If there is a mix, this is the end so draw it and reset
-            draw(target_texture, std::move(local_mix_texture), format_desc, core::blend_mode::normal);
+            draw(target_texture, std::move(local_mix_texture), format_desc, core::blend_mode::normal, local_mix_damage);
 
             draw_params.background = target_texture;
             draw_params.local_key  = std::move(local_key_texture);
             draw_params.layer_key  = layer_key_texture;
+            draw_params.blend_mode = blend_mode;
 
             kernel_.draw(std::move(draw_params));
         }
     }
 
+    // Composites source_texture onto target_texture, within damage.
     void draw(std::shared_ptr<texture>&  target_texture,
               std::shared_ptr<texture>&& source_texture,
               core::video_format_desc    format_desc,
-              core::blend_mode           blend_mode = core::blend_mode::normal)
+              core::blend_mode           blend_mode,
+              const pixel_rect&          damage)
     {
-        if (!source_texture)
+        if (!source_texture || damage.empty())
             return;
 
         draw_params draw_params;
@@ -233,6 +474,7 @@ class image_renderer
         draw_params.blend_mode      = blend_mode;
         draw_params.background      = target_texture;
         draw_params.geometry        = core::frame_geometry::get_default();
+        draw_params.scissor         = damage;
 
         kernel_.draw(std::move(draw_params));
     }
@@ -250,6 +492,13 @@ struct image_mixer::impl
 
     double aspect_ratio_ = 1.0;
 
+    std::size_t last_host_array_count_ = 0;
+
+    scene_fingerprint                          last_fingerprint_;
+    std::shared_future<core::converted_images> last_images_;
+    std::atomic<bool>                          last_reused_{false};
+    std::atomic<std::uint64_t>                 reused_frames_{0};
+
   public:
     impl(const spl::shared_ptr<device>& ogl, const int channel_id, const size_t max_frame_size, common::bit_depth depth)
         : ogl_(ogl)
@@ -295,20 +544,35 @@ struct image_mixer::impl
         item.transforms = transform_stack_.back();
         item.geometry   = frame.geometry();
 
-        auto textures_ptr = std::any_cast<std::shared_ptr<std::vector<future_texture>>>(frame.opaque());
-
-        if (textures_ptr) {
-            item.textures = *textures_ptr;
-        } else {
+        auto upload = [&] {
+            std::vector<array<const std::uint8_t>> image_data;
             for (int n = 0; n < static_cast<int>(item.pix_desc.planes.size()); ++n) {
-                item.textures.emplace_back(ogl_->copy_async(frame.image_data(n),
-                                                            item.pix_desc.planes[n].width,
-                                                            item.pix_desc.planes[n].height,
-                                                            item.pix_desc.planes[n].stride,
-                                                            item.pix_desc.planes[n].depth));
+                image_data.push_back(frame.image_data(n));
             }
+            return upload_frame_textures(*ogl_, image_data, item.pix_desc);
+        };
+
+        // Frames created by create_frame were uploaded when they were committed. Any other frame is uploaded the
+        // first time it is drawn, and keeps its textures from then on.
+        auto opaque = frame.opaque([&]() -> std::any { return upload(); });
+
+        auto textures_ptr = std::any_cast<std::shared_ptr<frame_textures>>(&opaque);
+        if (!textures_ptr || !*textures_ptr) {
+            CASPAR_LOG(warning) << L"[image_mixer] Frame has no textures.";
+            return;
         }
 
+        auto textures = *textures_ptr;
+        if (textures->owner != ogl_.get()) {
+            // The frame was uploaded by a channel on another device, such as the source of a route. Upload it again
+            // for this tick, since the frame only keeps the textures of one device.
+            textures = upload();
+        }
+
+        ogl_->count_frame_textures_lookup(textures->drawn.exchange(true));
+        item.source   = textures;
+        item.textures = textures->textures;
+
         layer_stack_.back()->items.push_back(item);
     }
 
@@ -320,7 +584,30 @@ struct image_mixer::impl
 
     std::future<array<const std::uint8_t>> render(const core::video_format_desc& format_desc)
     {
-        return renderer_(std::move(layers_), format_desc);
+        auto images = render(format_desc, {core::output_format::bgra}, core::color_space::bt709);
+        return std::async(std::launch::deferred, [images = std::move(images)]() mutable {
+            return images.get().at(core::output_format::bgra);
+        });
+    }
+
+    std::future<core::converted_images> render(const core::video_format_desc&          format_desc,
+                                               const std::vector<core::output_format>& formats,
+                                               core::color_space                       color_space)
+    {
+        // A channel showing a still, a paused clip or an idle template renders the same scene tick after tick. Hand
+        // out the images which were read back the last time, rather than drawing and reading them back again.
+        scene_fingerprint fingerprint(layers_, format_desc, formats, color_space);
+        if (last_images_.valid() && fingerprint == last_fingerprint_) {
+            layers_.clear();
+            reused_frames_++;
+            last_reused_ = true;
+        } else {
+            last_images_      = renderer_(std::move(layers_), format_desc, formats, color_space).share();
+            last_fingerprint_ = std::move(fingerprint);
+            last_reused_      = false;
+        }
+
+        return std::async(std::launch::deferred, [images = last_images_] { return images.get(); });
     }
 
     core::mutable_frame create_frame(const void* tag, const core::pixel_format_desc& desc) override
@@ -347,19 +634,28 @@ struct image_mixer::impl
                                        if (!self) {
                                            return std::any{};
                                        }
-                                       std::vector<future_texture> textures;
-                                       for (int n = 0; n < static_cast<int>(desc.planes.size()); ++n) {
-                                           textures.emplace_back(self->ogl_->copy_async(image_data[n],
-                                                                                        desc.planes[n].width,
-                                                                                        desc.planes[n].height,
-                                                                                        desc.planes[n].stride,
-                                                                                        desc.planes[n].depth));
-                                       }
-                                       return std::make_shared<decltype(textures)>(std::move(textures));
+                                       return upload_frame_textures(*self->ogl_, image_data, desc);
                                    });
     }
 
     common::bit_depth depth() const { return renderer_.depth(); }
+
+    void set_readback_depth(int frames) { renderer_.set_readback_depth(frames); }
+
+    std::size_t take_host_array_count()
+    {
+        auto count             = ogl_->host_array_count();
+        auto result            = count - last_host_array_count_;
+        last_host_array_count_ = count;
+        return result;
+    }
+
+    render_stats last_render_stats() const
+    {
+        auto stats          = last_reused_ ? render_stats{} : renderer_.last_render_stats();
+        stats.reused_frames = reused_frames_;
+        return stats;
+    }
 };
 
 image_mixer::image_mixer(const spl::shared_ptr<device>& ogl,
@@ -378,6 +674,12 @@ std::future<array<const std::uint8_t>> image_mixer::render(const core::video_for
 {
     return impl_->render(format_desc);
 }
+std::future<core::converted_images> image_mixer::render(const core::video_format_desc&          format_desc,
+                                                        const std::vector<core::output_format>& formats,
+                                                        core::color_space                       color_space)
+{
+    return impl_->render(format_desc, formats, color_space);
+}
 core::mutable_frame image_mixer::create_frame(const void* tag, const core::pixel_format_desc& desc)
 {
     return impl_->create_frame(tag, desc);
@@ -389,5 +691,8 @@ image_mixer::create_frame(const void* tag, const core::pixel_format_desc& desc,
 }
 
 common::bit_depth image_mixer::depth() const { return impl_->depth(); }
+void              image_mixer::set_readback_depth(int frames) { impl_->set_readback_depth(frames); }
+std::size_t       image_mixer::take_host_array_count() { return impl_->take_host_array_count(); }
+core::image_mixer::render_stats image_mixer::last_render_stats() const { return impl_->last_render_stats(); }
 
 }}} // namespace caspar::accelerator::ogl
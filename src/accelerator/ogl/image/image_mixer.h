@@ -31,6 +31,7 @@
 #include <core/video_format.h>
 
 #include <future>
+#include <vector>
 
 namespace caspar { namespace accelerator { namespace ogl {
 
@@ -48,6 +49,9 @@ class image_mixer final : public core::image_mixer
     image_mixer& operator=(const image_mixer&) = delete;
 
     std::future<array<const std::uint8_t>> render(const core::video_format_desc& format_desc) override;
+    std::future<core::converted_images>    render(const core::video_format_desc&          format_desc,
+                                                  const std::vector<core::output_format>& formats,
+                                                  core::color_space                       color_space) override;
     core::mutable_frame                    create_frame(const void* tag, const core::pixel_format_desc& desc) override;
     core::mutable_frame
     create_frame(const void* video_stream_tag, const core::pixel_format_desc& desc, common::bit_depth depth) override;
@@ -60,6 +64,9 @@ class image_mixer final : public core::image_mixer
     void              visit(const core::const_frame& frame) override;
     void              pop() override;
     common::bit_depth depth() const override;
+    void              set_readback_depth(int frames) override;
+    std::size_t       take_host_array_count() override;
+    render_stats      last_render_stats() const override;
 
   private:
     struct impl;
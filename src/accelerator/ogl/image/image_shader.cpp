@@ -26,15 +26,46 @@
 #include "ogl_image_fragment.h"
 #include "ogl_image_vertex.h"
 
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
 namespace caspar { namespace accelerator { namespace ogl {
 
-std::weak_ptr<shader> g_shader;
-std::mutex            g_shader_mutex;
+// Programs are compiled per device, as the contexts of different devices share no objects.
+std::map<std::pair<const device*, image_shader_variant>, std::weak_ptr<shader>> g_shaders;
+std::mutex                                                                      g_shader_mutex;
+
+std::string specialize(const std::string& source, const image_shader_variant& variant)
+{
+    std::ostringstream defines;
+    defines << "#define SPECIALIZED\n"
+            << "#define VARIANT_PIXEL_FORMAT " << variant.pixel_format << "\n"
+            << "#define VARIANT_BLEND_MODE " << variant.blend_mode << "\n"
+            << "#define VARIANT_KEYER " << variant.keyer << "\n"
+            << "#define VARIANT_IS_STRAIGHT_ALPHA " << variant.is_straight_alpha << "\n"
+            << "#define VARIANT_HAS_LOCAL_KEY " << variant.has_local_key << "\n"
+            << "#define VARIANT_HAS_LAYER_KEY " << variant.has_layer_key << "\n"
+            << "#define VARIANT_CHROMA " << variant.chroma << "\n"
+            << "#define VARIANT_LEVELS " << variant.levels << "\n"
+            << "#define VARIANT_CSB " << variant.csb << "\n"
+            << "#define VARIANT_INVERT " << variant.invert << "\n"
+            << "#define BATCH_SLOTS " << variant.batch_slots << "\n";
+
+    // Defines have to follow the #version directive.
+    auto result = source;
+    result.insert(result.find('\n') + 1, defines.str());
+    return result;
+}
 
-std::shared_ptr<shader> get_image_shader(const spl::shared_ptr<device>& ogl)
+std::shared_ptr<shader> get_image_shader(const spl::shared_ptr<device>& ogl, const image_shader_variant& variant)
 {
     std::lock_guard<std::mutex> lock(g_shader_mutex);
-    auto                        existing_shader = g_shader.lock();
+    auto                        key             = std::make_pair(ogl.get(), variant);
+    auto                        existing_shader = g_shaders[key].lock();
 
     if (existing_shader) {
         return existing_shader;
@@ -52,9 +83,12 @@ std::shared_ptr<shader> get_image_shader(const spl::shared_ptr<device>& ogl)
         }
     };
 
-    existing_shader.reset(new shader(std::string(vertex_shader), std::string(fragment_shader)), deleter);
+    auto start = std::chrono::steady_clock::now();
+    existing_shader.reset(new shader(std::string(vertex_shader), specialize(std::string(fragment_shader), variant)),
+                          deleter);
+    ogl->count_shader_compile(std::chrono::steady_clock::now() - start);
 
-    g_shader = existing_shader;
+    g_shaders[key] = existing_shader;
 
     return existing_shader;
 }
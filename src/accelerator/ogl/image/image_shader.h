@@ -23,11 +23,15 @@
 
 #include <common/memory.h>
 
+#include <tuple>
+
 namespace caspar { namespace accelerator { namespace ogl {
 
 class shader;
 class device;
 
+// The texture units of an item. Each item of a batch samples its own set, so that of slot n is at
+// n * texture_id::count, and the background, which the items share, follows those of the last slot.
 enum class texture_id
 {
     plane0 = 0,
@@ -36,9 +40,44 @@ enum class texture_id
     plane3,
     local_key,
     layer_key,
-    background
+    count
+};
+
+// The switches which the image shader is specialized by. Each combination is compiled into its own program, so that
+// features which are not in use cost nothing per fragment.
+struct image_shader_variant
+{
+    int  pixel_format      = 1; // bgra
+    int  blend_mode        = 0; // normal
+    int  keyer             = 0; // linear
+    bool is_straight_alpha = false;
+    bool has_local_key     = false;
+    bool has_layer_key     = false;
+    bool chroma            = false;
+    bool levels            = false;
+    bool csb               = false;
+    bool invert            = false;
+    int  batch_slots       = 1; // Items with different textures which one draw call can hold.
+
+    auto tie() const
+    {
+        return std::tie(pixel_format,
+                        blend_mode,
+                        keyer,
+                        is_straight_alpha,
+                        has_local_key,
+                        has_layer_key,
+                        chroma,
+                        levels,
+                        csb,
+                        invert,
+                        batch_slots);
+    }
+
+    bool operator<(const image_shader_variant& other) const { return tie() < other.tie(); }
 };
 
-std::shared_ptr<shader> get_image_shader(const spl::shared_ptr<device>& ogl);
+// Returns the image shader specialized for variant, compiling it on first use. Must be called on the device thread.
+std::shared_ptr<shader> get_image_shader(const spl::shared_ptr<device>& ogl, const image_shader_variant& variant);
 
 }}} // namespace caspar::accelerator::ogl
@@ -1,47 +1,125 @@
 #version 450
 in vec4 TexCoord;
 in vec4 TexCoord2;
+flat in int Item;
 out vec4 fragColor;
 
-uniform sampler2D	background;
-uniform sampler2D	plane[4];
-uniform sampler2D	local_key;
-uniform sampler2D	layer_key;
+#ifndef BATCH_SLOTS
+#define BATCH_SLOTS 1
+#endif
 
+// Each item of a batch samples the textures of its slot, see texture_id.
+uniform sampler2D	background;
+uniform sampler2D	plane[4 * BATCH_SLOTS];
+uniform sampler2D	local_key[BATCH_SLOTS];
+uniform sampler2D	layer_key[BATCH_SLOTS];
+
+#ifdef SPECIALIZED
+const int  pixel_format      = VARIANT_PIXEL_FORMAT;
+const int  blend_mode        = VARIANT_BLEND_MODE;
+const int  keyer             = VARIANT_KEYER;
+const bool is_straight_alpha = VARIANT_IS_STRAIGHT_ALPHA != 0;
+const bool has_local_key     = VARIANT_HAS_LOCAL_KEY != 0;
+const bool has_layer_key     = VARIANT_HAS_LAYER_KEY != 0;
+const bool chroma            = VARIANT_CHROMA != 0;
+const bool levels            = VARIANT_LEVELS != 0;
+const bool csb               = VARIANT_CSB != 0;
+const bool invert            = VARIANT_INVERT != 0;
+#else
+uniform int			pixel_format;
+uniform int			blend_mode;
+uniform int			keyer;
 uniform bool        is_straight_alpha;
-
-uniform mat3		color_matrix;
-uniform vec3		luma_coeff;
 uniform bool		has_local_key;
 uniform bool		has_layer_key;
-uniform int			blend_mode;
-uniform int			keyer;
-uniform int			pixel_format;
-
-uniform bool        invert;
-uniform float		opacity;
+uniform bool		chroma;
 uniform bool		levels;
-uniform float		min_input;
-uniform float		max_input;
-uniform float		gamma;
-uniform float		min_output;
-uniform float		max_output;
-uniform float	    precision_factor[4];
-
 uniform bool		csb;
-uniform float		brt;
-uniform float		sat;
-uniform float		con;
+uniform bool        invert;
+#endif
 
-uniform bool		chroma;
-uniform bool		chroma_show_mask;
-uniform float		chroma_target_hue;
-uniform float		chroma_hue_width;
-uniform float		chroma_min_saturation;
-uniform float		chroma_min_brightness;
-uniform float		chroma_softness;
-uniform float		chroma_spill_suppress;
-uniform float		chroma_spill_suppress_saturation;
+// The parameters of each item of a batch, see image_kernel.cpp.
+struct item_params
+{
+	mat3	color_matrix;
+	vec3	luma_coeff;
+	float	opacity;
+	float	precision_factor[4];
+	float	min_input;
+	float	max_input;
+	float	gamma;
+	float	min_output;
+	float	max_output;
+	float	brt;
+	float	sat;
+	float	con;
+	bool	chroma_show_mask;
+	float	chroma_target_hue;
+	float	chroma_hue_width;
+	float	chroma_min_saturation;
+	float	chroma_min_brightness;
+	float	chroma_softness;
+	float	chroma_spill_suppress;
+	float	chroma_spill_suppress_saturation;
+	int		slot;
+};
+
+layout(std430, binding = 1) readonly buffer items
+{
+	item_params item[];
+};
+
+// The parameters of this fragment's item, set by load_item.
+mat3		color_matrix;
+vec3		luma_coeff;
+
+float		opacity;
+float		min_input;
+float		max_input;
+float		gamma;
+float		min_output;
+float		max_output;
+float	    precision_factor[4];
+
+float		brt;
+float		sat;
+float		con;
+
+bool		chroma_show_mask;
+float		chroma_target_hue;
+float		chroma_hue_width;
+float		chroma_min_saturation;
+float		chroma_min_brightness;
+float		chroma_softness;
+float		chroma_spill_suppress;
+float		chroma_spill_suppress_saturation;
+
+int			slot;
+
+void load_item()
+{
+	color_matrix						= item[Item].color_matrix;
+	luma_coeff							= item[Item].luma_coeff;
+	opacity								= item[Item].opacity;
+	min_input							= item[Item].min_input;
+	max_input							= item[Item].max_input;
+	gamma								= item[Item].gamma;
+	min_output							= item[Item].min_output;
+	max_output							= item[Item].max_output;
+	precision_factor					= item[Item].precision_factor;
+	brt									= item[Item].brt;
+	sat									= item[Item].sat;
+	con									= item[Item].con;
+	chroma_show_mask					= item[Item].chroma_show_mask;
+	chroma_target_hue					= item[Item].chroma_target_hue;
+	chroma_hue_width					= item[Item].chroma_hue_width;
+	chroma_min_saturation				= item[Item].chroma_min_saturation;
+	chroma_min_brightness				= item[Item].chroma_min_brightness;
+	chroma_softness						= item[Item].chroma_softness;
+	chroma_spill_suppress				= item[Item].chroma_spill_suppress;
+	chroma_spill_suppress_saturation	= item[Item].chroma_spill_suppress_saturation;
+	slot								= item[Item].slot;
+}
 
 /*
 ** Contrast, saturation, brightness
@@ -450,9 +528,33 @@ vec4 ycbcra_to_rgba(float Y, float Cb, float Cr, float A)
     return vec4(color_matrix * YCbCr / 255, A).bgra;
 }
 
-vec4 get_sample(sampler2D sampler, vec2 coords)
+// Samplers may only be indexed by expressions which are the same across a draw, and the slot is not, so the slot's
+// texture is picked by branching.
+vec4 get_sample(int n, vec2 coords)
+{
+    for (int s = 0; s < BATCH_SLOTS; ++s) {
+        if (s == slot)
+            return texture(plane[s * 4 + n], coords);
+    }
+    return vec4(0.0);
+}
+
+float get_local_key(vec2 coords)
 {
-    return texture(sampler, coords);
+    for (int s = 0; s < BATCH_SLOTS; ++s) {
+        if (s == slot)
+            return texture(local_key[s], coords).r;
+    }
+    return 0.0;
+}
+
+float get_layer_key(vec2 coords)
+{
+    for (int s = 0; s < BATCH_SLOTS; ++s) {
+        if (s == slot)
+            return texture(layer_key[s], coords).r;
+    }
+    return 0.0;
 }
 
 vec4 get_rgba_color()
@@ -460,59 +562,59 @@ vec4 get_rgba_color()
     switch(pixel_format)
     {
     case 0:		//gray
-        return vec4(get_sample(plane[0], TexCoord.st / TexCoord.q).rrr * precision_factor[0], 1.0);
+        return vec4(get_sample(0, TexCoord.st / TexCoord.q).rrr * precision_factor[0], 1.0);
     case 1:		//bgra,
-        return get_sample(plane[0], TexCoord.st / TexCoord.q).bgra * precision_factor[0];
+        return get_sample(0, TexCoord.st / TexCoord.q).bgra * precision_factor[0];
     case 2:		//rgba,
-        return get_sample(plane[0], TexCoord.st / TexCoord.q).rgba * precision_factor[0];
+        return get_sample(0, TexCoord.st / TexCoord.q).rgba * precision_factor[0];
     case 3:		//argb,
-        return get_sample(plane[0], TexCoord.st / TexCoord.q).argb * precision_factor[0];
+        return get_sample(0, TexCoord.st / TexCoord.q).argb * precision_factor[0];
     case 4:		//abgr,
-        return get_sample(plane[0], TexCoord.st / TexCoord.q).gbar * precision_factor[0];
+        return get_sample(0, TexCoord.st / TexCoord.q).gbar * precision_factor[0];
     case 5:		//ycbcr,
         {
-            float y  = get_sample(plane[0], TexCoord.st / TexCoord.q).r * precision_factor[0];
-            float cb = get_sample(plane[1], TexCoord.st / TexCoord.q).r * precision_factor[1];
-            float cr = get_sample(plane[2], TexCoord.st / TexCoord.q).r * precision_factor[2];
+            float y  = get_sample(0, TexCoord.st / TexCoord.q).r * precision_factor[0];
+            float cb = get_sample(1, TexCoord.st / TexCoord.q).r * precision_factor[1];
+            float cr = get_sample(2, TexCoord.st / TexCoord.q).r * precision_factor[2];
             return ycbcra_to_rgba(y, cb, cr, 1.0);
         }
     case 6:		//ycbcra
         {
-            float y  = get_sample(plane[0], TexCoord.st / TexCoord.q).r * precision_factor[0];
-            float cb = get_sample(plane[1], TexCoord.st / TexCoord.q).r * precision_factor[1];
-            float cr = get_sample(plane[2], TexCoord.st / TexCoord.q).r * precision_factor[2];
-            float a  = get_sample(plane[3], TexCoord.st / TexCoord.q).r * precision_factor[3];
+            float y  = get_sample(0, TexCoord.st / TexCoord.q).r * precision_factor[0];
+            float cb = get_sample(1, TexCoord.st / TexCoord.q).r * precision_factor[1];
+            float cr = get_sample(2, TexCoord.st / TexCoord.q).r * precision_factor[2];
+            float a  = get_sample(3, TexCoord.st / TexCoord.q).r * precision_factor[3];
             return ycbcra_to_rgba(y, cb, cr, a);
         }
     case 7:		//luma
         {
-            vec3 y3 = get_sample(plane[0], TexCoord.st / TexCoord.q).rrr * precision_factor[0];
+            vec3 y3 = get_sample(0, TexCoord.st / TexCoord.q).rrr * precision_factor[0];
             return vec4((y3-0.065)/0.859, 1.0);
         }
     case 8:		//bgr,
-        return vec4(get_sample(plane[0], TexCoord.st / TexCoord.q).bgr * precision_factor[0], 1.0);
+        return vec4(get_sample(0, TexCoord.st / TexCoord.q).bgr * precision_factor[0], 1.0);
     case 9:		//rgb,
-        return vec4(get_sample(plane[0], TexCoord.st / TexCoord.q).rgb * precision_factor[0], 1.0);
+        return vec4(get_sample(0, TexCoord.st / TexCoord.q).rgb * precision_factor[0], 1.0);
 	case 10:	// uyvy
 		{
-			float y = get_sample(plane[0], TexCoord.st / TexCoord.q).g * precision_factor[0];
-			float cb = get_sample(plane[1], TexCoord.st / TexCoord.q).b * precision_factor[1];
-			float cr = get_sample(plane[1], TexCoord.st / TexCoord.q).r * precision_factor[1];
+			float y = get_sample(0, TexCoord.st / TexCoord.q).g * precision_factor[0];
+			float cb = get_sample(1, TexCoord.st / TexCoord.q).b * precision_factor[1];
+			float cr = get_sample(1, TexCoord.st / TexCoord.q).r * precision_factor[1];
 			return ycbcra_to_rgba(y, cb, cr, 1.0);
 		}
     case 11:    // gbrp
         {
-            float g  = get_sample(plane[0], TexCoord.st / TexCoord.q).r * precision_factor[0];
-            float b = get_sample(plane[1], TexCoord.st / TexCoord.q).r * precision_factor[1];
-            float r = get_sample(plane[2], TexCoord.st / TexCoord.q).r * precision_factor[2];
+            float g  = get_sample(0, TexCoord.st / TexCoord.q).r * precision_factor[0];
+            float b = get_sample(1, TexCoord.st / TexCoord.q).r * precision_factor[1];
+            float r = get_sample(2, TexCoord.st / TexCoord.q).r * precision_factor[2];
 			return vec4(b, g, r, 1.0);
         }
     case 12:    // gbrap
         {
-            float g  = get_sample(plane[0], TexCoord.st / TexCoord.q).r * precision_factor[0];
-            float b = get_sample(plane[1], TexCoord.st / TexCoord.q).r * precision_factor[1];
-            float r = get_sample(plane[2], TexCoord.st / TexCoord.q).r * precision_factor[2];
-            float a  = get_sample(plane[3], TexCoord.st / TexCoord.q).r * precision_factor[3];
+            float g  = get_sample(0, TexCoord.st / TexCoord.q).r * precision_factor[0];
+            float b = get_sample(1, TexCoord.st / TexCoord.q).r * precision_factor[1];
+            float r = get_sample(2, TexCoord.st / TexCoord.q).r * precision_factor[2];
+            float a  = get_sample(3, TexCoord.st / TexCoord.q).r * precision_factor[3];
 			return vec4(b, g, r, a);
         }
     }
@@ -521,6 +623,8 @@ vec4 get_rgba_color()
 
 void main()
 {
+    load_item();
+
     vec4 color = get_rgba_color();
     if (is_straight_alpha)
         color.rgb *= color.a;
@@ -531,9 +635,9 @@ void main()
     if(csb)
         color.rgb = ContrastSaturationBrightness(color, brt, sat, con);
     if(has_local_key)
-        color *= texture(local_key, TexCoord2.st).r;
+        color *= get_local_key(TexCoord2.st);
     if(has_layer_key)
-        color *= texture(layer_key, TexCoord2.st).r;
+        color *= get_layer_key(TexCoord2.st);
     color *= opacity;
     if (invert)
         color = 1.0 - color;
@@ -1,13 +1,16 @@
 #version 450
-in vec4 TexCoordIn;
-in vec2 Position;
+layout(location = 0) in vec2 Position;
+layout(location = 1) in vec4 TexCoordIn;
+layout(location = 2) in int ItemIn;
 
 out vec4 TexCoord;
 out vec4 TexCoord2;
+flat out int Item;
 
 void main()
 {
     TexCoord = TexCoordIn;
+    Item = ItemIn;
     vec4 pos = vec4(Position, 0, 1);
     TexCoord2 = vec4(pos.xy, 0.0, 0.0);
     pos.x = pos.x*2.0 - 1.0;
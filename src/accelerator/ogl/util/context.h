@@ -14,11 +14,16 @@ class device_context final
 
     device_context& operator=(const device_context&) = delete;
 
+    // Creates a context which shares textures, buffers and sync objects with this one. The new context is not bound.
+    std::unique_ptr<device_context> create_shared() const;
+
     void bind();
     void unbind();
 
   private:
     struct impl;
+    explicit device_context(std::shared_ptr<impl> impl);
+
     std::shared_ptr<impl> impl_;
 };
 
@@ -6,23 +6,38 @@
 
 #include <EGL/egl.h>
 
+#include <mutex>
+
 namespace caspar::accelerator::ogl {
 
+// The primary context of every device is created on the default display, which EGL does not reference count. It is
+// initialized for the first and terminated with the last.
+static std::mutex g_display_mutex;
+static int        g_display_refs = 0;
+
 struct device_context::impl
 {
     EGLDisplay eglDisplay_;
+    EGLConfig  eglConfig_;
     EGLContext eglContext_;
+    bool       ownsDisplay_;
 
     impl()
         : eglDisplay_(EGL_NO_DISPLAY)
         , eglContext_(EGL_NO_CONTEXT)
+        , ownsDisplay_(true)
     {
         CASPAR_LOG(info) << L"Initializing OpenGL Device.";
 
         eglDisplay_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
 
-        EGLint major, minor;
-        eglInitialize(eglDisplay_, &major, &minor);
+        {
+            std::lock_guard<std::mutex> lock(g_display_mutex);
+            if (g_display_refs++ == 0) {
+                EGLint major, minor;
+                eglInitialize(eglDisplay_, &major, &minor);
+            }
+        }
 
         const EGLint configAttribs[] = {EGL_SURFACE_TYPE,
                                         EGL_PBUFFER_BIT,
@@ -36,9 +51,8 @@ struct device_context::impl
                                         EGL_OPENGL_BIT,
                                         EGL_NONE};
 
-        EGLint    numConfigs;
-        EGLConfig eglConfig;
-        if (!eglChooseConfig(eglDisplay_, configAttribs, &eglConfig, 1, &numConfigs)) {
+        EGLint numConfigs;
+        if (!eglChooseConfig(eglDisplay_, configAttribs, &eglConfig_, 1, &numConfigs)) {
             CASPAR_THROW_EXCEPTION(gl::ogl_exception() << msg_info("Failed to initialize OpenGL: eglChooseConfig"));
         }
 
@@ -46,7 +60,7 @@ struct device_context::impl
             CASPAR_THROW_EXCEPTION(gl::ogl_exception() << msg_info("Failed to initialize OpenGL: eglBindAPI"));
         }
 
-        eglContext_ = eglCreateContext(eglDisplay_, eglConfig, EGL_NO_CONTEXT, NULL);
+        eglContext_ = eglCreateContext(eglDisplay_, eglConfig_, EGL_NO_CONTEXT, NULL);
         if (eglContext_ == EGL_NO_CONTEXT) {
             CASPAR_THROW_EXCEPTION(gl::ogl_exception() << msg_info("Failed to initialize OpenGL: eglCreateContext"));
         }
@@ -56,6 +70,19 @@ struct device_context::impl
         }
     }
 
+    explicit impl(const impl& shared)
+        : eglDisplay_(shared.eglDisplay_)
+        , eglConfig_(shared.eglConfig_)
+        , eglContext_(EGL_NO_CONTEXT)
+        , ownsDisplay_(false)
+    {
+        eglContext_ = eglCreateContext(eglDisplay_, eglConfig_, shared.eglContext_, NULL);
+        if (eglContext_ == EGL_NO_CONTEXT) {
+            CASPAR_THROW_EXCEPTION(gl::ogl_exception()
+                                   << msg_info("Failed to initialize shared OpenGL context: eglCreateContext"));
+        }
+    }
+
     ~impl()
     {
         eglMakeCurrent(eglDisplay_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
@@ -64,7 +91,12 @@ struct device_context::impl
             eglDestroyContext(eglDisplay_, eglContext_);
         }
 
-        eglTerminate(eglDisplay_);
+        if (ownsDisplay_) {
+            std::lock_guard<std::mutex> lock(g_display_mutex);
+            if (--g_display_refs == 0) {
+                eglTerminate(eglDisplay_);
+            }
+        }
     }
 };
 
@@ -72,8 +104,17 @@ device_context::device_context()
     : impl_(new impl())
 {
 }
+device_context::device_context(std::shared_ptr<impl> impl)
+    : impl_(std::move(impl))
+{
+}
 device_context::~device_context() {}
 
+std::unique_ptr<device_context> device_context::create_shared() const
+{
+    return std::unique_ptr<device_context>(new device_context(std::make_shared<impl>(*impl_)));
+}
+
 void device_context::bind() { eglMakeCurrent(impl_->eglDisplay_, EGL_NO_SURFACE, EGL_NO_SURFACE, impl_->eglContext_); }
 void device_context::unbind() { eglMakeCurrent(impl_->eglDisplay_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
 
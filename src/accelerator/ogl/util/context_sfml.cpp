@@ -22,8 +22,20 @@ device_context::device_context()
     : impl_(new impl())
 {
 }
+device_context::device_context(std::shared_ptr<impl> impl)
+    : impl_(std::move(impl))
+{
+}
 device_context::~device_context() {}
 
+std::unique_ptr<device_context> device_context::create_shared() const
+{
+    // SFML shares all of its contexts with an internal context, so a new context can see this one's objects.
+    auto context = std::unique_ptr<device_context>(new device_context(std::make_shared<impl>()));
+    context->unbind();
+    return context;
+}
+
 void device_context::bind() { impl_->device_.setActive(true); }
 void device_context::unbind() { impl_->device_.setActive(false); }
 
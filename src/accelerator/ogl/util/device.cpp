@@ -22,6 +22,7 @@
 
 #include "buffer.h"
 #include "context.h"
+#include "pool.h"
 #include "shader.h"
 #include "texture.h"
 
@@ -38,31 +39,105 @@
 #include <GL/wglew.h>
 #endif
 
-#include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 #include <tbb/concurrent_queue.h>
-#include <tbb/concurrent_unordered_map.h>
+#include <tbb/task_arena.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <thread>
+#include <tuple>
 
 namespace caspar { namespace accelerator { namespace ogl {
 
 using namespace boost::asio;
 
+// Upper bounds (in milliseconds) of the readback latency histogram buckets. The last bucket catches the rest.
+static constexpr std::array<double, 7> readback_latency_buckets = {1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 64.0};
+
+// Pooled textures are keyed by their exact format, since the renderer relies on the texture dimensions.
+struct texture_key
+{
+    int depth_index;
+    int stride;
+    int width;
+    int height;
+
+    bool operator<(const texture_key& other) const
+    {
+        return std::tie(depth_index, stride, width, height) <
+               std::tie(other.depth_index, other.stride, other.width, other.height);
+    }
+};
+
+// Pooled host buffers are keyed by size class, so that buffers of similar sizes can be reused for each other.
+struct buffer_key
+{
+    bool        write;
+    std::size_t size_class;
+
+    bool operator<(const buffer_key& other) const
+    {
+        return std::tie(write, size_class) < std::tie(other.write, other.size_class);
+    }
+};
+
+// Maximum number of buffers of one size class which are allocated in the background at any time.
+static const int max_pending_provisions = 4;
+
+// Rounds size up to one of four classes per power of two, which wastes at most 25% of a buffer.
+static std::size_t buffer_size_class(std::size_t size)
+{
+    if (size <= 4096) {
+        return 4096;
+    }
+
+    std::size_t msb = 1;
+    while ((msb << 1) <= size) {
+        msb <<= 1;
+    }
+    auto granularity = msb / 4;
+    return (size + granularity - 1) / granularity * granularity;
+}
+
 struct device::impl : public std::enable_shared_from_this<impl>
 {
-    using texture_queue_t = tbb::concurrent_bounded_queue<std::shared_ptr<texture>>;
-    using buffer_queue_t  = tbb::concurrent_bounded_queue<std::shared_ptr<buffer>>;
+    using texture_pool_t = resource_pool<texture_key, texture>;
+    using buffer_pool_t  = resource_pool<buffer_key, buffer>;
 
-    std::unique_ptr<device_context> context_;
+    struct pending_fence
+    {
+        GLsync                                  fence = nullptr;
+        std::chrono::steady_clock::time_point   start;
+        std::function<void(std::exception_ptr)> on_complete;
+    };
+
+    // Returns a buffer to the pool of the device which allocated it, which copy_async checks for, since a buffer can
+    // only be used by its own device's context.
+    struct pooled_buffer
+    {
+        std::shared_ptr<impl>   owner;
+        std::shared_ptr<buffer> buf;
+        buffer_key              key;
 
-    std::array<std::array<tbb::concurrent_unordered_map<size_t, texture_queue_t>, 4>, 2> device_pools_;
-    std::array<tbb::concurrent_unordered_map<size_t, buffer_queue_t>, 2>                 host_pools_;
+        void operator()(buffer*) { owner->host_pool_.push(key, std::move(buf), key.size_class); }
+    };
+
+    std::unique_ptr<device_context> context_;
+    std::unique_ptr<device_context> fence_context_;
 
     GLuint fbo_;
 
@@ -72,9 +147,43 @@ struct device::impl : public std::enable_shared_from_this<impl>
     decltype(make_work_guard(service_)) work_;
     std::thread                         thread_;
 
+    texture_pool_t             device_pool_;
+    buffer_pool_t              host_pool_;
+    const std::chrono::seconds pool_max_idle_;
+    steady_timer               pool_trim_timer_;
+
+    tbb::concurrent_bounded_queue<pending_fence>                                fences_;
+    std::thread                                                                 fence_thread_;
+    std::array<std::atomic<std::uint64_t>, readback_latency_buckets.size() + 1> readback_latency_histogram_{};
+
+    std::mutex                provisions_mutex_;
+    std::map<buffer_key, int> pending_provisions_;
+    std::atomic<std::size_t>  provisioned_buffer_count_{0};
+    std::atomic<std::size_t>  host_array_count_{0};
+
+    std::atomic<std::size_t> frame_textures_count_{0};
+    std::atomic<std::size_t> frame_textures_size_{0};
+    std::atomic<std::size_t> frame_textures_hits_{0};
+    std::atomic<std::size_t> frame_textures_misses_{0};
+
+    std::atomic<std::size_t>  shader_compile_count_{0};
+    std::atomic<std::int64_t> shader_compile_time_us_{0};
+
+    tbb::task_arena          upload_arena_;
+    std::atomic<std::size_t> zero_copy_upload_count_{0};
+    std::atomic<std::size_t> zero_copy_upload_size_{0};
+    std::atomic<std::size_t> copied_upload_count_{0};
+    std::atomic<std::size_t> copied_upload_size_{0};
+
     impl()
         : context_(new device_context())
         , work_(make_work_guard(service_))
+        , device_pool_(env::properties().get<std::size_t>(L"configuration.accelerator.pool.device-budget", 0) << 20,
+                       [this](texture_pool_t::resources_t textures) { dispose(std::move(textures)); })
+        , host_pool_(env::properties().get<std::size_t>(L"configuration.accelerator.pool.host-budget", 0) << 20,
+                     [this](buffer_pool_t::resources_t buffers) { dispose(std::move(buffers)); })
+        , pool_max_idle_(env::properties().get(L"configuration.accelerator.pool.max-idle", 30))
+        , pool_trim_timer_(service_)
     {
         CASPAR_LOG(info) << L"Initializing OpenGL Device.";
 
@@ -110,31 +219,71 @@ struct device::impl : public std::enable_shared_from_this<impl>
 
         context_->unbind();
 
+        fence_context_ = context_->create_shared();
+
+        if (pool_max_idle_.count() > 0) {
+            schedule_pool_trim();
+        }
+
         thread_ = std::thread([&] {
             context_->bind();
             set_thread_name(L"OpenGL Device");
             service_.run();
             context_->unbind();
         });
+
+        fence_thread_ = std::thread([&] {
+            fence_context_->bind();
+            set_thread_name(L"OpenGL Fence");
+            wait_fences();
+            fence_context_->unbind();
+        });
     }
 
     ~impl()
     {
+        boost::asio::post(service_, [this] { pool_trim_timer_.cancel(); });
+
         work_.reset();
         thread_.join();
 
-        context_->bind();
+        fences_.push(pending_fence{});
+        fence_thread_.join();
 
-        for (auto& pool : host_pools_)
-            pool.clear();
+        context_->bind();
 
-        for (auto& pools : device_pools_)
-            for (auto& pool : pools)
-                pool.clear();
+        host_pool_.clear();
+        device_pool_.clear();
 
         GL(glDeleteFramebuffers(1, &fbo_));
     }
 
+    // Destroys evicted resources on the OpenGL thread, where the context is bound.
+    template <typename T>
+    void dispose(std::vector<std::shared_ptr<T>> resources)
+    {
+        boost::asio::post(service_, [resources = std::move(resources)] {});
+    }
+
+    void schedule_pool_trim()
+    {
+        pool_trim_timer_.expires_after(std::chrono::seconds(1));
+        pool_trim_timer_.async_wait([this](const boost::system::error_code& ec) {
+            if (ec) {
+                return;
+            }
+
+            try {
+                device_pool_.trim(pool_max_idle_);
+                host_pool_.trim(pool_max_idle_);
+            } catch (...) {
+                CASPAR_LOG_CURRENT_EXCEPTION();
+            }
+
+            schedule_pool_trim();
+        });
+    }
+
     template <typename Func>
     auto spawn_async(Func&& func)
     {
@@ -181,13 +330,10 @@ struct device::impl : public std::enable_shared_from_this<impl>
         CASPAR_VERIFY(stride > 0 && stride < 5);
         CASPAR_VERIFY(width > 0 && height > 0);
 
-        auto depth_pool_index = depth == common::bit_depth::bit8 ? 0 : 1;
-
-        // TODO (perf) Shared pool.
-        auto pool = &device_pools_[depth_pool_index][stride - 1][(width << 16 & 0xFFFF0000) | (height & 0x0000FFFF)];
+        auto key = texture_key{depth == common::bit_depth::bit8 ? 0 : 1, stride, width, height};
 
-        std::shared_ptr<texture> tex;
-        if (!pool->try_pop(tex)) {
+        auto tex = device_pool_.try_pop(key);
+        if (!tex) {
             tex = std::make_shared<texture>(width, height, stride, depth);
         }
         tex->set_depth(depth);
@@ -197,87 +343,229 @@ struct device::impl : public std::enable_shared_from_this<impl>
         }
 
         auto ptr = tex.get();
-        return std::shared_ptr<texture>(
-            ptr, [tex = std::move(tex), pool, self = shared_from_this()](texture*) mutable { pool->push(tex); });
+        return std::shared_ptr<texture>(ptr, [tex = std::move(tex), key, self = shared_from_this()](texture*) mutable {
+            auto size = tex->size();
+            self->device_pool_.push(key, std::move(tex), size);
+        });
     }
 
     std::shared_ptr<buffer> create_buffer(int size, bool write)
     {
         CASPAR_VERIFY(size > 0);
 
-        // TODO (perf) Shared pool.
-        auto pool = &host_pools_[static_cast<int>(write ? 1 : 0)][size];
+        auto key = buffer_key{write, buffer_size_class(size)};
 
-        std::shared_ptr<buffer> buf;
-        if (!pool->try_pop(buf)) {
-            // TODO (perf) Avoid blocking in create_array.
-            dispatch_sync([&] { buf = std::make_shared<buffer>(size, write); });
+        auto buf = host_pool_.try_pop(key);
+        if (!buf) {
+            dispatch_sync([&] { buf = std::make_shared<buffer>(static_cast<int>(key.size_class), write); });
         }
 
+        return wrap_buffer(std::move(buf), key);
+    }
+
+    std::shared_ptr<buffer> wrap_buffer(std::shared_ptr<buffer> buf, const buffer_key& key)
+    {
         auto ptr = buf.get();
-        return std::shared_ptr<buffer>(ptr, [buf = std::move(buf), self = shared_from_this()](buffer*) mutable {
-            auto pool = &self->host_pools_[static_cast<int>(buf->write() ? 1 : 0)][buf->size()];
-            pool->push(std::move(buf));
+        return std::shared_ptr<buffer>(ptr, pooled_buffer{shared_from_this(), std::move(buf), key});
+    }
+
+    // Allocates a buffer on the OpenGL thread and adds it to the pool, without waiting for it.
+    void provision_buffer(const buffer_key& key)
+    {
+        {
+            std::lock_guard<std::mutex> lock(provisions_mutex_);
+            auto&                       pending = pending_provisions_[key];
+            if (pending >= max_pending_provisions) {
+                return;
+            }
+            pending++;
+        }
+
+        boost::asio::post(service_, [this, key, self = shared_from_this()] {
+            try {
+                auto buf = std::make_shared<buffer>(static_cast<int>(key.size_class), key.write);
+                host_pool_.push(key, std::move(buf), key.size_class);
+                provisioned_buffer_count_++;
+            } catch (...) {
+                CASPAR_LOG_CURRENT_EXCEPTION();
+            }
+
+            std::lock_guard<std::mutex> lock(provisions_mutex_);
+            pending_provisions_[key]--;
         });
     }
 
     array<uint8_t> create_array(int size)
     {
-        auto buf = create_buffer(size, true);
+        CASPAR_VERIFY(size > 0);
+
+        auto key = buffer_key{true, buffer_size_class(size)};
+
+        auto buf = host_pool_.try_pop(key);
+        if (!buf) {
+            // Don't make the caller wait behind the OpenGL queue. Hand out host memory, which copy_async stages into an
+            // upload buffer, and top up the pool in the background.
+            provision_buffer(key);
+            host_array_count_++;
+
+            // The caller fills the array, so it isn't cleared.
+            auto storage = std::shared_ptr<void>(std::malloc(size), std::free);
+            if (!storage) {
+                throw std::bad_alloc();
+            }
+            return array<uint8_t>(static_cast<uint8_t*>(storage.get()), size, std::move(storage));
+        }
+
+        buf      = wrap_buffer(std::move(buf), key);
         auto ptr = reinterpret_cast<uint8_t*>(buf->data());
-        return array<uint8_t>(ptr, buf->size(), std::move(buf));
+        return array<uint8_t>(ptr, size, std::move(buf));
+    }
+
+    std::shared_ptr<texture>
+    upload(const std::shared_ptr<buffer>& buf, int width, int height, int stride, common::bit_depth depth)
+    {
+        auto tex = create_texture(width, height, stride, depth, false);
+        tex->copy_from(*buf);
+        return tex;
     }
 
     std::future<std::shared_ptr<texture>>
     copy_async(const array<const uint8_t>& source, int width, int height, int stride, common::bit_depth depth)
     {
-        return dispatch_async([&] {
-            std::shared_ptr<buffer> buf;
+        // Buffers of another device, such as those of a frame routed from a channel on it, are staged like host memory.
+        auto tmp    = source.storage<std::shared_ptr<buffer>>();
+        auto pooled = tmp ? std::get_deleter<pooled_buffer>(*tmp) : nullptr;
+        if (pooled && pooled->owner.get() == this) {
+            zero_copy_upload_count_++;
+            zero_copy_upload_size_ += source.size();
+
+            return dispatch_async([=, this, self = shared_from_this(), buf = *tmp] {
+                return upload(buf, width, height, stride, depth);
+            });
+        }
 
-            auto tmp = source.storage<std::shared_ptr<buffer>>();
-            if (tmp) {
-                buf = *tmp;
-            } else {
-                buf = create_buffer(static_cast<int>(source.size()), true);
-                // TODO (perf) Copy inside a TBB worker.
+        copied_upload_count_++;
+        copied_upload_size_ += source.size();
+
+        // Stage the data on a worker thread, so that only the texture upload is left for the OpenGL thread.
+        auto promise = std::make_shared<std::promise<std::shared_ptr<texture>>>();
+        auto future  = promise->get_future();
+
+        upload_arena_.enqueue([=, this, self = shared_from_this()] {
+            try {
+                // Upload buffers are only allocated on the OpenGL thread, which the worker mustn't wait for. When the
+                // pool is empty the texture is uploaded straight from the source's host memory instead, and the pool
+                // is topped up in the background.
+                auto key = buffer_key{true, buffer_size_class(source.size())};
+                auto buf = host_pool_.try_pop(key);
+                if (!buf) {
+                    provision_buffer(key);
+                    host_array_count_++;
+
+                    boost::asio::dispatch(service_, [=, this, self = self] {
+                        try {
+                            auto tex = create_texture(width, height, stride, depth, false);
+                            tex->copy_from(source.data());
+                            promise->set_value(std::move(tex));
+                        } catch (...) {
+                            promise->set_exception(std::current_exception());
+                        }
+                    });
+                    return;
+                }
+
+                buf = wrap_buffer(std::move(buf), key);
                 std::memcpy(buf->data(), source.data(), source.size());
-            }
 
-            auto tex = create_texture(width, height, stride, depth, false);
-            tex->copy_from(*buf);
-            // TODO (perf) save tex on source
-            return tex;
+                boost::asio::dispatch(service_, [=, this, self = self, buf = std::move(buf)] {
+                    try {
+                        promise->set_value(upload(buf, width, height, stride, depth));
+                    } catch (...) {
+                        promise->set_exception(std::current_exception());
+                    }
+                });
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
         });
+
+        return future;
     }
 
     std::future<array<const uint8_t>> copy_async(const std::shared_ptr<texture>& source)
     {
-        return spawn_async([&](yield_context yield) {
-            auto buf = create_buffer(source->size(), false);
-            source->copy_to(*buf);
+        return read_async(source->size(), [source](buffer& buf) { source->copy_to(buf); });
+    }
+
+    std::future<array<const uint8_t>> read_async(int size, std::function<void(buffer&)> write)
+    {
+        auto promise = std::make_shared<std::promise<array<const uint8_t>>>();
+        auto future  = promise->get_future();
+
+        boost::asio::dispatch(service_, [this, size, write = std::move(write), promise] {
+            try {
+                auto buf = create_buffer(size, false);
+                write(*buf);
 
-            auto fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                pending_fence pending;
+                pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                pending.start = std::chrono::steady_clock::now();
 
-            GL(glFlush());
+                // The fence is waited on from another context, so it has to reach the GPU before it can signal.
+                GL(glFlush());
 
-            deadline_timer timer(service_);
-            for (auto n = 0; true; ++n) {
-                // TODO (perf) Smarter non-polling solution?
-                timer.expires_from_now(boost::posix_time::milliseconds(2));
-                timer.async_wait(yield);
+                pending.on_complete = [buf = std::move(buf), size, promise](std::exception_ptr error) mutable {
+                    if (error) {
+                        promise->set_exception(error);
+                        return;
+                    }
+                    auto ptr = reinterpret_cast<uint8_t*>(buf->data());
+                    promise->set_value(array<const uint8_t>(ptr, size, std::move(buf)));
+                };
+                fences_.push(std::move(pending));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        });
 
-                auto wait = glClientWaitSync(fence, 0, 1);
-                if (wait == GL_ALREADY_SIGNALED || wait == GL_CONDITION_SATISFIED) {
-                    break;
+        return future;
+    }
+
+    void wait_fences()
+    {
+        // Fences are signaled in submission order, so they can be waited on one at a time.
+        pending_fence pending;
+        while (true) {
+            fences_.pop(pending);
+            if (!pending.fence) {
+                return;
+            }
+
+            std::exception_ptr error;
+            try {
+                while (true) {
+                    auto wait = glClientWaitSync(pending.fence, 0, 1000000000); // 1 s
+                    if (wait == GL_ALREADY_SIGNALED || wait == GL_CONDITION_SATISFIED) {
+                        break;
+                    }
+                    if (wait == GL_WAIT_FAILED) {
+                        CASPAR_THROW_EXCEPTION(gl::ogl_exception() << msg_info("glClientWaitSync failed."));
+                    }
                 }
+            } catch (...) {
+                error = std::current_exception();
             }
 
-            glDeleteSync(fence);
+            glDeleteSync(pending.fence);
 
-            auto ptr  = reinterpret_cast<uint8_t*>(buf->data());
-            auto size = buf->size();
-            return array<const uint8_t>(ptr, size, std::move(buf));
-        });
+            auto latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.start);
+            auto bucket =
+                std::upper_bound(readback_latency_buckets.begin(), readback_latency_buckets.end(), latency.count());
+            readback_latency_histogram_[bucket - readback_latency_buckets.begin()]++;
+
+            pending.on_complete(error);
+            pending = {};
+        }
     }
 
     boost::property_tree::wptree info() const
@@ -288,38 +576,21 @@ struct device::impl : public std::enable_shared_from_this<impl>
         size_t                       total_pooled_device_buffer_size  = 0;
         size_t                       total_pooled_device_buffer_count = 0;
 
-        for (size_t i = 0; i < device_pools_.size(); ++i) {
-            auto& depth_pools = device_pools_.at(i);
-            for (size_t j = 0; j < depth_pools.size(); ++j) {
-                auto& pools      = depth_pools.at(j);
-                bool  mipmapping = j > 3;
-                auto  stride     = mipmapping ? j - 3 : j + 1;
-
-                for (auto& pool : pools) {
-                    auto width  = pool.first >> 16;
-                    auto height = pool.first & 0x0000FFFF;
-                    auto size   = width * height * stride;
-                    auto count  = pool.second.size();
-
-                    if (count == 0)
-                        continue;
+        device_pool_.for_each([&](const texture_key& key, size_t count, size_t size) {
+            boost::property_tree::wptree pool_info;
 
-                    boost::property_tree::wptree pool_info;
+            pool_info.add(L"stride", key.stride);
+            pool_info.add(L"depth", key.depth_index == 0 ? 8 : 16);
+            pool_info.add(L"width", key.width);
+            pool_info.add(L"height", key.height);
+            pool_info.add(L"size", size / count);
+            pool_info.add(L"count", count);
 
-                    pool_info.add(L"stride", stride);
-                    pool_info.add(L"mipmapping", mipmapping);
-                    pool_info.add(L"width", width);
-                    pool_info.add(L"height", height);
-                    pool_info.add(L"size", size);
-                    pool_info.add(L"count", count);
+            total_pooled_device_buffer_size += size;
+            total_pooled_device_buffer_count += count;
 
-                    total_pooled_device_buffer_size += size * count;
-                    total_pooled_device_buffer_count += count;
-
-                    pooled_device_buffers.add_child(L"device_buffer_pool", pool_info);
-                }
-            }
-        }
+            pooled_device_buffers.add_child(L"device_buffer_pool", pool_info);
+        });
 
         info.add_child(L"gl.details.pooled_device_buffers", pooled_device_buffers);
 
@@ -329,29 +600,18 @@ struct device::impl : public std::enable_shared_from_this<impl>
         size_t                       total_read_count  = 0;
         size_t                       total_write_count = 0;
 
-        for (size_t i = 0; i < host_pools_.size(); ++i) {
-            auto& pools    = host_pools_.at(i);
-            auto  is_write = i == 1;
+        host_pool_.for_each([&](const buffer_key& key, size_t count, size_t size) {
+            boost::property_tree::wptree pool_info;
 
-            for (auto& pool : pools) {
-                auto size  = pool.first;
-                auto count = pool.second.size();
+            pool_info.add(L"usage", key.write ? L"write_only" : L"read_only");
+            pool_info.add(L"size", key.size_class);
+            pool_info.add(L"count", count);
 
-                if (count == 0)
-                    continue;
+            pooled_host_buffers.add_child(L"host_buffer_pool", pool_info);
 
-                boost::property_tree::wptree pool_info;
-
-                pool_info.add(L"usage", is_write ? L"write_only" : L"read_only");
-                pool_info.add(L"size", size);
-                pool_info.add(L"count", count);
-
-                pooled_host_buffers.add_child(L"host_buffer_pool", pool_info);
-
-                (is_write ? total_write_count : total_read_count) += count;
-                (is_write ? total_write_size : total_read_size) += size * count;
-            }
-        }
+            (key.write ? total_write_count : total_read_count) += count;
+            (key.write ? total_write_size : total_read_size) += size;
+        });
 
         info.add_child(L"gl.details.pooled_host_buffers", pooled_host_buffers);
         info.add(L"gl.summary.pooled_device_buffers.total_count", total_pooled_device_buffer_count);
@@ -361,27 +621,71 @@ struct device::impl : public std::enable_shared_from_this<impl>
         info.add(L"gl.summary.pooled_host_buffers.total_write_count", total_write_count);
         info.add(L"gl.summary.pooled_host_buffers.total_read_size", total_read_size);
         info.add(L"gl.summary.pooled_host_buffers.total_write_size", total_write_size);
+        info.add_child(L"gl.summary.pools.device", device_pool_.info());
+        info.add_child(L"gl.summary.pools.host", host_pool_.info());
+        info.add(L"gl.summary.pools.host.provisioned", provisioned_buffer_count_.load());
+        info.add(L"gl.summary.pools.host.host_arrays", host_array_count_.load());
         info.add_child(L"gl.summary.all_host_buffers", buffer::info());
 
+        boost::property_tree::wptree readback_latency;
+        for (size_t n = 0; n < readback_latency_histogram_.size(); ++n) {
+            boost::property_tree::wptree bucket_info;
+            if (n < readback_latency_buckets.size()) {
+                bucket_info.add(L"max_ms", readback_latency_buckets[n]);
+            } else {
+                bucket_info.add(L"max_ms", L"inf");
+            }
+            bucket_info.add(L"count", readback_latency_histogram_[n].load());
+            readback_latency.add_child(L"bucket", bucket_info);
+        }
+        info.add_child(L"gl.summary.readback_latency", readback_latency);
+
+        info.add(L"gl.summary.uploads.zero_copy_count", zero_copy_upload_count_.load());
+        info.add(L"gl.summary.uploads.zero_copy_size", zero_copy_upload_size_.load());
+        info.add(L"gl.summary.uploads.copied_count", copied_upload_count_.load());
+        info.add(L"gl.summary.uploads.copied_size", copied_upload_size_.load());
+
+        auto hits   = frame_textures_hits_.load();
+        auto misses = frame_textures_misses_.load();
+        info.add(L"gl.summary.frame_textures.hits", hits);
+        info.add(L"gl.summary.frame_textures.misses", misses);
+        info.add(L"gl.summary.frame_textures.hit_rate",
+                 hits + misses > 0 ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0);
+        info.add(L"gl.summary.frame_textures.resident_count", frame_textures_count_.load());
+        info.add(L"gl.summary.frame_textures.resident_size", frame_textures_size_.load());
+
+        info.add(L"gl.summary.shaders.compiled_variants", shader_compile_count_.load());
+        info.add(L"gl.summary.shaders.compile_time_ms", static_cast<double>(shader_compile_time_us_.load()) / 1000.0);
+
         return info;
     }
 
+    std::shared_ptr<void> retain_frame_textures(std::size_t size)
+    {
+        frame_textures_count_++;
+        frame_textures_size_ += size;
+        return std::shared_ptr<void>(static_cast<void*>(nullptr), [size, self = shared_from_this()](void*) {
+            self->frame_textures_count_--;
+            self->frame_textures_size_ -= size;
+        });
+    }
+
+    void count_frame_textures_lookup(bool hit) { (hit ? frame_textures_hits_ : frame_textures_misses_)++; }
+
+    void count_shader_compile(std::chrono::steady_clock::duration duration)
+    {
+        shader_compile_count_++;
+        shader_compile_time_us_ += std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
     std::future<void> gc()
     {
         return spawn_async([&](yield_context yield) {
             CASPAR_LOG(info) << " ogl: Running GC.";
 
             try {
-                for (auto& depth_pools : device_pools_) {
-                    for (auto& pools : depth_pools) {
-                        for (auto& pool : pools)
-                            pool.second.clear();
-                    }
-                }
-                for (auto& pools : host_pools_) {
-                    for (auto& pool : pools)
-                        pool.second.clear();
-                }
+                device_pool_.clear();
+                host_pool_.clear();
             } catch (...) {
                 CASPAR_LOG_CURRENT_EXCEPTION();
             }
@@ -394,11 +698,13 @@ device::device()
 {
 }
 device::~device() {}
-std::shared_ptr<texture> device::create_texture(int width, int height, int stride, common::bit_depth depth)
+std::shared_ptr<texture>
+device::create_texture(int width, int height, int stride, common::bit_depth depth, bool clear)
 {
-    return impl_->create_texture(width, height, stride, depth, true);
+    return impl_->create_texture(width, height, stride, depth, clear);
 }
 array<uint8_t> device::create_array(int size) { return impl_->create_array(size); }
+std::size_t    device::host_array_count() const { return impl_->host_array_count_; }
 std::future<std::shared_ptr<texture>>
 device::copy_async(const array<const uint8_t>& source, int width, int height, int stride, common::bit_depth depth)
 {
@@ -408,6 +714,16 @@ std::future<array<const uint8_t>> device::copy_async(const std::shared_ptr<textu
 {
     return impl_->copy_async(source);
 }
+std::future<array<const uint8_t>> device::read_async(int size, std::function<void(buffer&)> write)
+{
+    return impl_->read_async(size, std::move(write));
+}
+std::shared_ptr<void> device::retain_frame_textures(std::size_t size) { return impl_->retain_frame_textures(size); }
+void                  device::count_frame_textures_lookup(bool hit) { impl_->count_frame_textures_lookup(hit); }
+void device::count_shader_compile(std::chrono::steady_clock::duration duration)
+{
+    impl_->count_shader_compile(duration);
+}
 void         device::dispatch(std::function<void()> func) { boost::asio::dispatch(impl_->service_, std::move(func)); }
 std::wstring device::version() const { return impl_->version(); }
 boost::property_tree::wptree device::info() const { return impl_->info(); }
@@ -25,6 +25,7 @@
 #include <common/array.h>
 #include <common/bit_depth.hpp>
 
+#include <chrono>
 #include <functional>
 #include <future>
 
@@ -46,12 +47,28 @@ class device final
 
     device& operator=(const device&) = delete;
 
-    std::shared_ptr<class texture> create_texture(int width, int height, int stride, common::bit_depth depth);
+    std::shared_ptr<class texture>
+    create_texture(int width, int height, int stride, common::bit_depth depth, bool clear = true);
     array<uint8_t>                 create_array(int size);
 
+    // The number of arrays create_array has allocated in host memory, as the pool had no upload buffer ready.
+    std::size_t host_array_count() const;
+
     std::future<std::shared_ptr<class texture>>
     copy_async(const array<const uint8_t>& source, int width, int height, int stride, common::bit_depth depth);
     std::future<array<const uint8_t>> copy_async(const std::shared_ptr<class texture>& source);
+
+    // Reads back size bytes, which write puts into a host buffer with OpenGL commands. write is called on the device
+    // thread, and the result is ready once the GPU has completed those commands.
+    std::future<array<const uint8_t>> read_async(int size, std::function<void(class buffer&)> write);
+
+    // Accounting for textures which are kept with a frame and reused for as long as the frame is drawn. The returned
+    // handle counts size bytes as resident until it is released.
+    std::shared_ptr<void> retain_frame_textures(std::size_t size);
+    void                  count_frame_textures_lookup(bool hit);
+
+    void count_shader_compile(std::chrono::steady_clock::duration duration);
+
     template <typename Func>
     auto dispatch_async(Func&& func)
     {
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace caspar { namespace accelerator { namespace ogl {
+
+/**
+ * A pool of idle GL resources, grouped by key.
+ *
+ * The most recently returned resource of a key is handed out first. When the pooled size exceeds the budget, or when
+ * trim() is called, the least recently returned resources are evicted. Evicted resources must be destroyed with the
+ * context bound, so they are either returned to the caller or passed to the dispose function.
+ */
+template <typename Key, typename T>
+class resource_pool final
+{
+    using clock = std::chrono::steady_clock;
+
+    struct entry
+    {
+        std::shared_ptr<T> resource;
+        std::size_t        size;
+        clock::time_point  returned;
+    };
+
+  public:
+    using resources_t = std::vector<std::shared_ptr<T>>;
+    using dispose_t   = std::function<void(resources_t)>;
+
+    resource_pool(std::size_t budget, dispose_t dispose)
+        : budget_(budget)
+        , dispose_(std::move(dispose))
+    {
+    }
+
+    resource_pool(const resource_pool&)            = delete;
+    resource_pool& operator=(const resource_pool&) = delete;
+
+    std::shared_ptr<T> try_pop(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = entries_.find(key);
+        if (it == entries_.end() || it->second.empty()) {
+            misses_++;
+            return nullptr;
+        }
+
+        auto entry = std::move(it->second.back());
+        it->second.pop_back();
+        pooled_size_ -= entry.size;
+        hits_++;
+
+        return std::move(entry.resource);
+    }
+
+    void push(const Key& key, std::shared_ptr<T> resource, std::size_t size)
+    {
+        resources_t evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            entries_[key].push_back(entry{std::move(resource), size, clock::now()});
+            pooled_size_ += size;
+
+            while (budget_ > 0 && pooled_size_ > budget_) {
+                evicted.push_back(evict_oldest());
+            }
+        }
+
+        if (!evicted.empty()) {
+            dispose_(std::move(evicted));
+        }
+    }
+
+    // Evicts every resource which has been idle for longer than max_idle.
+    resources_t trim(clock::duration max_idle)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        resources_t evicted;
+        auto        deadline = clock::now() - max_idle;
+        for (auto& p : entries_) {
+            while (!p.second.empty() && p.second.front().returned < deadline) {
+                pooled_size_ -= p.second.front().size;
+                evicted.push_back(std::move(p.second.front().resource));
+                p.second.pop_front();
+                evictions_++;
+            }
+        }
+
+        return evicted;
+    }
+
+    resources_t clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        resources_t evicted;
+        for (auto& p : entries_) {
+            for (auto& e : p.second) {
+                evicted.push_back(std::move(e.resource));
+            }
+        }
+        entries_.clear();
+        pooled_size_ = 0;
+
+        return evicted;
+    }
+
+    // Calls func(key, count, size) for every key which currently has pooled resources.
+    template <typename Func>
+    void for_each(Func&& func) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto& p : entries_) {
+            if (p.second.empty())
+                continue;
+
+            std::size_t size = 0;
+            for (auto& e : p.second) {
+                size += e.size;
+            }
+            func(p.first, p.second.size(), size);
+        }
+    }
+
+    boost::property_tree::wptree info() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        boost::property_tree::wptree info;
+        info.add(L"hits", hits_);
+        info.add(L"misses", misses_);
+        info.add(L"evictions", evictions_);
+        info.add(L"pooled_size", pooled_size_);
+        info.add(L"budget", budget_);
+        return info;
+    }
+
+  private:
+    std::shared_ptr<T> evict_oldest()
+    {
+        auto oldest = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (!it->second.empty() &&
+                (oldest == entries_.end() || it->second.front().returned < oldest->second.front().returned)) {
+                oldest = it;
+            }
+        }
+
+        auto entry = std::move(oldest->second.front());
+        oldest->second.pop_front();
+        pooled_size_ -= entry.size;
+        evictions_++;
+
+        return std::move(entry.resource);
+    }
+
+    const std::size_t                budget_;
+    const dispose_t                  dispose_;
+    mutable std::mutex               mutex_;
+    std::map<Key, std::deque<entry>> entries_;
+    std::size_t                      pooled_size_ = 0;
+    std::uint64_t                    hits_        = 0;
+    std::uint64_t                    misses_      = 0;
+    std::uint64_t                    evictions_   = 0;
+};
+
+}}} // namespace caspar::accelerator::ogl
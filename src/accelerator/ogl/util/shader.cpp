@@ -24,7 +24,12 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <iterator>
 #include <unordered_map>
+#include <vector>
 
 namespace caspar { namespace accelerator { namespace ogl {
 
@@ -34,6 +39,14 @@ struct shader::impl
     std::unordered_map<std::string, GLint> uniform_locations_;
     std::unordered_map<std::string, GLint> attrib_locations_;
 
+    // Last value set for every uniform, so that setting an unchanged value doesn't reach the driver.
+    struct uniform_value
+    {
+        std::array<float, 9> values;
+        std::size_t          count = 0;
+    };
+    std::unordered_map<GLint, uniform_value> uniform_values_;
+
     impl(const impl&)            = delete;
     impl& operator=(const impl&) = delete;
 
@@ -99,6 +112,48 @@ struct shader::impl
         GL(glUseProgramObjectARB(program_));
     }
 
+    explicit impl(const std::string& compute_source_str)
+        : program_(0)
+    {
+        GLint success;
+
+        const char* compute_source = compute_source_str.c_str();
+
+        auto compute_shader = glCreateShaderObjectARB(GL_COMPUTE_SHADER);
+
+        GL(glShaderSourceARB(compute_shader, 1, &compute_source, NULL));
+        GL(glCompileShaderARB(compute_shader));
+
+        GL(glGetObjectParameterivARB(compute_shader, GL_OBJECT_COMPILE_STATUS_ARB, &success));
+        if (success == GL_FALSE) {
+            char info[2048];
+            GL(glGetInfoLogARB(compute_shader, sizeof(info), 0, info));
+            GL(glDeleteObjectARB(compute_shader));
+            std::stringstream str;
+            str << "Failed to compile compute shader:" << std::endl << info << std::endl;
+            CASPAR_THROW_EXCEPTION(caspar_exception() << msg_info(str.str()));
+        }
+
+        program_ = glCreateProgramObjectARB();
+
+        GL(glAttachObjectARB(program_, compute_shader));
+
+        GL(glLinkProgramARB(program_));
+
+        GL(glDeleteObjectARB(compute_shader));
+
+        GL(glGetObjectParameterivARB(program_, GL_OBJECT_LINK_STATUS_ARB, &success));
+        if (success == GL_FALSE) {
+            char info[2048];
+            GL(glGetInfoLogARB(program_, sizeof(info), 0, info));
+            GL(glDeleteObjectARB(program_));
+            std::stringstream str;
+            str << "Failed to link shader program:" << std::endl << info << std::endl;
+            CASPAR_THROW_EXCEPTION(caspar_exception() << msg_info(str.str()));
+        }
+        GL(glUseProgramObjectARB(program_));
+    }
+
     ~impl() { glDeleteProgram(program_); }
 
     GLint get_uniform_location(const char* name)
@@ -117,31 +172,72 @@ struct shader::impl
         return it->second;
     }
 
+    // Returns false if the uniform at location already holds values.
+    template <typename It>
+    bool update(GLint location, It begin, It end)
+    {
+        auto& cached = uniform_values_[location];
+        auto  count  = static_cast<std::size_t>(std::distance(begin, end));
+        if (cached.count == count && std::equal(begin, end, cached.values.begin())) {
+            return false;
+        }
+        std::copy(begin, end, cached.values.begin());
+        cached.count = count;
+        return true;
+    }
+
+    bool update(GLint location, std::initializer_list<float> values)
+    {
+        return update(location, values.begin(), values.end());
+    }
+
     void set(const std::string& name, bool value) { set(name, value ? 1 : 0); }
 
-    void set(const std::string& name, int value) { GL(glUniform1i(get_uniform_location(name.c_str()), value)); }
+    void set(const std::string& name, int value)
+    {
+        auto location = get_uniform_location(name.c_str());
+        if (update(location, {static_cast<float>(value)}))
+            GL(glUniform1i(location, value));
+    }
 
-    void set(const std::string& name, float value) { GL(glUniform1f(get_uniform_location(name.c_str()), value)); }
+    void set(const std::string& name, float value)
+    {
+        auto location = get_uniform_location(name.c_str());
+        if (update(location, {value}))
+            GL(glUniform1f(location, value));
+    }
 
     void set(const std::string& name, double value0, double value1)
     {
-        GL(glUniform2f(get_uniform_location(name.c_str()), static_cast<float>(value0), static_cast<float>(value1)));
+        auto location = get_uniform_location(name.c_str());
+        auto v0       = static_cast<float>(value0);
+        auto v1       = static_cast<float>(value1);
+        if (update(location, {v0, v1}))
+            GL(glUniform2f(location, v0, v1));
     }
     void set(const std::string& name, double value0, double value1, double value2)
     {
-        GL(glUniform3f(get_uniform_location(name.c_str()),
-                       static_cast<float>(value0),
-                       static_cast<float>(value1),
-                       static_cast<float>(value1)));
+        auto location = get_uniform_location(name.c_str());
+        auto v0       = static_cast<float>(value0);
+        auto v1       = static_cast<float>(value1);
+        if (update(location, {v0, v1, v1}))
+            GL(glUniform3f(location, v0, v1, v1));
     }
 
-    void set(const std::string& name, double value)
+    void set(const std::string& name, double value) { set(name, static_cast<float>(value)); }
+    void set_array(const std::string& name, const std::vector<int>& values)
     {
-        GL(glUniform1f(get_uniform_location(name.c_str()), static_cast<float>(value)));
+        auto location = get_uniform_location(name.c_str());
+        if (update(location, values.begin(), values.end()))
+            GL(glUniform1iv(location, static_cast<GLsizei>(values.size()), values.data()));
     }
     void set_matrix3(const std::string& name, const float* value)
     {
-        GL(glUniformMatrix3fv(get_uniform_location(name.c_str()), 1, GL_TRUE, value));
+        auto location = get_uniform_location(name.c_str());
+        if (update(location,
+                   {value[0], value[1], value[2], value[3], value[4], value[5], value[6], value[7], value[8]})) {
+            GL(glUniformMatrix3fv(location, 1, GL_TRUE, value));
+        }
     }
 
     void use() { GL(glUseProgramObjectARB(program_)); }
@@ -151,6 +247,10 @@ shader::shader(const std::string& vertex_source_str, const std::string& fragment
     : impl_(new impl(vertex_source_str, fragment_source_str))
 {
 }
+shader::shader(const std::string& compute_source_str)
+    : impl_(new impl(compute_source_str))
+{
+}
 shader::~shader() {}
 void shader::set(const std::string& name, bool value) { impl_->set(name, value); }
 void shader::set(const std::string& name, int value) { impl_->set(name, value); }
@@ -161,6 +261,7 @@ void shader::set(const std::string& name, double value0, double value1, double v
     impl_->set(name, value0, value1, value2);
 }
 void  shader::set(const std::string& name, double value) { impl_->set(name, value); }
+void  shader::set_array(const std::string& name, const std::vector<int>& values) { impl_->set_array(name, values); }
 void  shader::set_matrix3(const std::string& name, const float* value) { impl_->set_matrix3(name, value); }
 GLint shader::get_attrib_location(const char* name) { return impl_->get_attrib_location(name); }
 int   shader::id() const { return impl_->program_; }
@@ -25,6 +25,7 @@
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 namespace caspar { namespace accelerator { namespace ogl {
 
@@ -35,6 +36,7 @@ class shader final
 
   public:
     shader(const std::string& vertex_source_str, const std::string& fragment_source_str);
+    explicit shader(const std::string& compute_source_str);
     ~shader();
 
     void set(const std::string& name, bool value);
@@ -45,6 +47,9 @@ class shader final
     void set(const std::string& name, double value);
     void set_matrix3(const std::string& name, const float* value);
 
+    // Sets an int array of at most 9 elements.
+    void set_array(const std::string& name, const std::vector<int>& values);
+
     GLint get_attrib_location(const char* name);
 
     template <typename E>
@@ -82,6 +82,21 @@ struct texture::impl
         GL(glClearTexImage(id_, 0, FORMAT[stride_], TYPE[depth_ == common::bit_depth::bit8 ? 0 : 1][stride_], nullptr));
     }
 
+    void clear(int x, int y, int width, int height)
+    {
+        GL(glClearTexSubImage(id_,
+                              0,
+                              x,
+                              y,
+                              0,
+                              width,
+                              height,
+                              1,
+                              FORMAT[stride_],
+                              TYPE[depth_ == common::bit_depth::bit8 ? 0 : 1][stride_],
+                              nullptr));
+    }
+
 #ifdef WIN32
     void copy_from(int texture_id)
     {
@@ -93,7 +108,19 @@ struct texture::impl
     void copy_from(buffer& src)
     {
         src.bind();
+        copy_from_unpack(nullptr);
+        src.unbind();
+    }
 
+    void copy_from(const void* data)
+    {
+        GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        copy_from_unpack(data);
+    }
+
+    // Uploads from the bound unpack buffer at offset data, or from host memory at data if none is bound.
+    void copy_from_unpack(const void* data)
+    {
         if (width_ % 16 > 0) {
             glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         } else {
@@ -108,9 +135,7 @@ struct texture::impl
                                height_,
                                FORMAT[stride_],
                                TYPE[depth_ == common::bit_depth::bit8 ? 0 : 1][stride_],
-                               nullptr));
-
-        src.unbind();
+                               data));
     }
 
     void copy_to(buffer& dst)
@@ -140,10 +165,12 @@ void texture::bind(int index) { impl_->bind(index); }
 void texture::unbind() { impl_->unbind(); }
 void texture::attach() { impl_->attach(); }
 void texture::clear() { impl_->clear(); }
+void texture::clear(int x, int y, int width, int height) { impl_->clear(x, y, width, height); }
 #ifdef WIN32
 void texture::copy_from(int source) { impl_->copy_from(source); }
 #endif
 void              texture::copy_from(buffer& source) { impl_->copy_from(source); }
+void              texture::copy_from(const void* source) { impl_->copy_from(source); }
 void              texture::copy_to(buffer& dest) { impl_->copy_to(dest); }
 int               texture::width() const { return impl_->width_; }
 int               texture::height() const { return impl_->height_; }
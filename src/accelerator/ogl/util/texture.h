@@ -41,10 +41,12 @@ class texture final
     void copy_from(int source);
 #endif
     void copy_from(class buffer& source);
+    void copy_from(const void* source);
     void copy_to(class buffer& dest);
 
     void attach();
     void clear();
+    void clear(int x, int y, int width, int height);
     void bind(int index);
     void unbind();
 
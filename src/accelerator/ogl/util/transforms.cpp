@@ -117,6 +117,54 @@ draw_transforms draw_transforms::combine_transform(const core::image_transform&
     return std::move(new_transform);
 }
 
+draw_transforms draw_transforms::combine_scale_mode(core::frame_geometry::scale_mode      mode,
+                                                    const core::pixel_format_desc::plane& first_plane,
+                                                    int                                   target_width,
+                                                    int                                   target_height,
+                                                    double                                aspect_ratio) const
+{
+    if (mode == core::frame_geometry::scale_mode::stretch || first_plane.width <= 0 || first_plane.height <= 0) {
+        return *this;
+    }
+
+    auto width_scale  = static_cast<double>(target_width) / static_cast<double>(first_plane.width);
+    auto height_scale = static_cast<double>(target_height) / static_cast<double>(first_plane.height);
+
+    core::image_transform transform;
+    double                target_scale;
+    switch (mode) {
+        case core::frame_geometry::scale_mode::fit:
+            target_scale = std::min(width_scale, height_scale);
+
+            transform.fill_scale[0] *= target_scale / width_scale;
+            transform.fill_scale[1] *= target_scale / height_scale;
+            break;
+
+        case core::frame_geometry::scale_mode::fill:
+            target_scale = std::max(width_scale, height_scale);
+            transform.fill_scale[0] *= target_scale / width_scale;
+            transform.fill_scale[1] *= target_scale / height_scale;
+            break;
+
+        case core::frame_geometry::scale_mode::original:
+            transform.fill_scale[0] /= width_scale;
+            transform.fill_scale[1] /= height_scale;
+            break;
+
+        case core::frame_geometry::scale_mode::hfill:
+            transform.fill_scale[1] *= width_scale / height_scale;
+            break;
+
+        case core::frame_geometry::scale_mode::vfill:
+            transform.fill_scale[0] *= height_scale / width_scale;
+            break;
+
+        default:;
+    }
+
+    return combine_transform(transform, aspect_ratio);
+}
+
 void apply_perspective_to_vertex(t_point& vertex, const core::corners& perspective)
 {
     const double x = vertex(0);
@@ -65,6 +65,13 @@ struct draw_transforms
 
     [[nodiscard]] draw_transforms combine_transform(const core::image_transform& transform, double aspect_ratio) const;
 
+    // Scales a frame whose first plane is first_plane into a target_width x target_height target, as mode says.
+    [[nodiscard]] draw_transforms combine_scale_mode(core::frame_geometry::scale_mode      mode,
+                                                     const core::pixel_format_desc::plane& first_plane,
+                                                     int                                   target_width,
+                                                     int                                   target_height,
+                                                     double                                aspect_ratio) const;
+
     [[nodiscard]] std::vector<core::frame_geometry::coord>
     transform_coords(const std::vector<core::frame_geometry::coord>& coords) const;
 };
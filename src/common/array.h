@@ -75,6 +75,17 @@ class array final
     T*          end() const { return ptr_ + size_; }
     std::size_t size() const { return size_; }
 
+    // Returns a second array over the same memory, which keeps the storage alive as well. For memory which is written
+    // by one party and then handed on, such as a frame which ffmpeg decoded into a frame factory's buffer.
+    array share() const
+    {
+        array result;
+        result.ptr_     = ptr_;
+        result.size_    = size_;
+        result.storage_ = storage_;
+        return result;
+    }
+
     explicit operator bool() const { return size_ > 0; };
 
     template <typename S>
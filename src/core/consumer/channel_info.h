@@ -28,15 +28,17 @@ namespace caspar::core {
 
 struct channel_info
 {
-    channel_info(int channel_index, common::bit_depth depth, color_space color_space)
+    channel_info(int channel_index, common::bit_depth depth, color_space color_space, int latency = 0)
     : index(channel_index)
     , depth(depth)
     , default_color_space(color_space)
+    , latency(latency)
     {}
 
     int               index;
     common::bit_depth depth;
     color_space       default_color_space;
+    int               latency; // Ticks from a frame being produced until it is sent to consumers.
 };
 
 } // namespace caspar::core
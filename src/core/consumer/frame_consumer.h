@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include "../frame/output_format.h"
 #include "../fwd.h"
 #include "../monitor/monitor.h"
 
@@ -55,6 +56,10 @@ class frame_consumer
     initialize(const video_format_desc& format_desc, const core::channel_info& channel_info, int port_index) = 0;
     virtual std::future<bool> call(const std::vector<std::wstring>& params) { return caspar::make_ready_future(false); }
 
+    // The image formats the consumer reads from the frames it is sent. It is asked after every initialize, and the
+    // channel converts its frames to each format asked for by a consumer. See const_frame::converted_image_data.
+    virtual std::vector<output_format> output_formats() const { return {output_format::bgra}; }
+
     virtual core::monitor::state state() const = 0;
 
     virtual std::wstring print() const = 0;
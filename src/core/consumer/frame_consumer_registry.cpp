@@ -101,6 +101,8 @@ class destroy_consumer_proxy : public frame_consumer
     bool                 has_synchronization_clock() const override { return consumer_->has_synchronization_clock(); }
     int                  index() const override { return consumer_->index(); }
     core::monitor::state state() const override { return consumer_->state(); }
+
+    std::vector<output_format> output_formats() const override { return consumer_->output_formats(); }
 };
 
 class print_consumer_proxy : public frame_consumer
@@ -137,6 +139,8 @@ class print_consumer_proxy : public frame_consumer
     bool                 has_synchronization_clock() const override { return consumer_->has_synchronization_clock(); }
     int                  index() const override { return consumer_->index(); }
     core::monitor::state state() const override { return consumer_->state(); }
+
+    std::vector<output_format> output_formats() const override { return consumer_->output_formats(); }
 };
 
 frame_consumer_registry::frame_consumer_registry() {}
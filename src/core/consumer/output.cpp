@@ -33,7 +33,9 @@
 
 #include <chrono>
 #include <map>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <thread>
 #include <utility>
 
@@ -44,6 +46,7 @@ using time_point_t = decltype(std::chrono::high_resolution_clock::now());
 struct output::impl
 {
     monitor::state                      state_;
+    mutable std::mutex                  state_mutex_;
     spl::shared_ptr<diagnostics::graph> graph_;
     const channel_info                  channel_info_;
     video_format_desc                   format_desc_;
@@ -104,6 +107,18 @@ struct output::impl
         return consumers_.size();
     }
 
+    std::vector<output_format> output_formats()
+    {
+        std::set<output_format>     formats;
+        std::lock_guard<std::mutex> lock(consumers_mutex_);
+        for (auto& p : consumers_) {
+            for (auto format : p.second->output_formats()) {
+                formats.insert(format);
+            }
+        }
+        return std::vector<output_format>(formats.begin(), formats.end());
+    }
+
     void operator()(const const_frame&             input_frame1,
                     const const_frame&             input_frame2,
                     const core::video_format_desc& format_desc)
@@ -208,7 +223,10 @@ struct output::impl
             state["port"][p.first]             = p.second->state();
             state["port"][p.first]["consumer"] = p.second->name();
         }
-        state_ = std::move(state);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            state_ = std::move(state);
+        }
 
         const auto needs_sync = std::all_of(
             consumers.begin(), consumers.end(), [](auto& p) { return !p.second->has_synchronization_clock(); });
@@ -244,9 +262,14 @@ std::future<bool> output::call(int index, const std::vector<std::wstring>& param
     return impl_->call(index, params);
 }
 size_t output::consumer_count() const { return impl_->consumer_count(); }
+std::vector<output_format> output::output_formats() const { return impl_->output_formats(); }
 void   output::operator()(const const_frame& frame, const const_frame& frame2, const video_format_desc& format_desc)
 {
     return (*impl_)(frame, frame2, format_desc);
 }
-core::monitor::state output::state() const { return impl_->state_; }
+core::monitor::state output::state() const
+{
+    std::lock_guard<std::mutex> lock(impl_->state_mutex_);
+    return impl_->state_;
+}
 }} // namespace caspar::core
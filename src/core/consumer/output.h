@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include "../frame/output_format.h"
 #include "../fwd.h"
 #include "../monitor/monitor.h"
 
@@ -28,6 +29,7 @@
 #include <core/video_format.h>
 
 #include <memory>
+#include <vector>
 
 namespace caspar::diagnostics {
 class graph;
@@ -58,6 +60,9 @@ class output final
 
     size_t consumer_count() const;
 
+    // The image formats asked for by any of the consumers, see frame_consumer::output_formats.
+    std::vector<output_format> output_formats() const;
+
     core::monitor::state state() const;
 
   private:
@@ -28,6 +28,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <vector>
 
 namespace caspar { namespace core {
@@ -36,6 +37,7 @@ struct mutable_frame::impl
 {
     std::vector<array<std::uint8_t>> image_data_;
     array<std::int32_t>              audio_data_;
+    int                              audio_channels_ = 0;
     const core::pixel_format_desc    desc_;
     const void*                      tag_;
     frame_geometry                   geometry_ = frame_geometry::get_default();
@@ -82,6 +84,8 @@ const array<std::uint8_t>& mutable_frame::image_data(std::size_t index) const {
 const array<std::int32_t>& mutable_frame::audio_data() const { return impl_->audio_data_; }
 array<std::uint8_t>&       mutable_frame::image_data(std::size_t index) { return impl_->image_data_.at(index); }
 array<std::int32_t>&       mutable_frame::audio_data() { return impl_->audio_data_; }
+int&                       mutable_frame::audio_channels() { return impl_->audio_channels_; }
+int                        mutable_frame::audio_channels() const { return impl_->audio_channels_; }
 std::size_t                mutable_frame::width() const { return impl_->desc_.planes.at(0).width; }
 std::size_t                mutable_frame::height() const { return impl_->desc_.planes.at(0).height; }
 const void*                mutable_frame::stream_tag() const { return impl_->tag_; }
@@ -92,19 +96,26 @@ struct const_frame::impl
 {
     std::vector<array<const std::uint8_t>> image_data_;
     array<const std::int32_t>              audio_data_;
-    core::pixel_format_desc                desc_     = core::pixel_format_desc(pixel_format::invalid);
+    int                                    audio_channels_ = 0;
+    core::pixel_format_desc                desc_           = core::pixel_format_desc(pixel_format::invalid);
     const void*                            tag_;
     frame_geometry                         geometry_ = frame_geometry::get_default();
     std::any                               opaque_;
+    std::mutex                             opaque_mutex_;
+    converted_images                       converted_;
 
     impl(const void*                            tag,
          std::vector<array<const std::uint8_t>> image_data,
          array<const std::int32_t>              audio_data,
-         const core::pixel_format_desc&         desc)
+         const core::pixel_format_desc&         desc,
+         converted_images                       converted,
+         int                                    audio_channels)
         : image_data_(std::move(image_data))
         , audio_data_(std::move(audio_data))
+        , audio_channels_(audio_channels)
         , desc_(desc)
         , tag_(tag)
+        , converted_(std::move(converted))
     {
         if (desc_.planes.size() != image_data_.size()) {
             CASPAR_THROW_EXCEPTION(invalid_argument());
@@ -116,6 +127,7 @@ struct const_frame::impl
         : image_data_(std::make_move_iterator(other.impl_->image_data_.begin()),
                       std::make_move_iterator(other.impl_->image_data_.end()))
         , audio_data_(std::move(other.impl_->audio_data_))
+        , audio_channels_(other.impl_->audio_channels_)
         , desc_(std::move(other.impl_->desc_))
         , tag_(other.stream_tag())
         , geometry_(std::move(other.impl_->geometry_))
@@ -141,8 +153,10 @@ const_frame::const_frame() {}
 const_frame::const_frame(const void*                            tag,
                          std::vector<array<const std::uint8_t>> image_data,
                          array<const std::int32_t>              audio_data,
-                         const core::pixel_format_desc&         desc)
-    : impl_(new impl(tag, std::move(image_data), std::move(audio_data), desc))
+                         const core::pixel_format_desc&         desc,
+                         converted_images                       converted,
+                         int                                    audio_channels)
+    : impl_(new impl(tag, std::move(image_data), std::move(audio_data), desc, std::move(converted), audio_channels))
 {
 }
 const_frame::const_frame(mutable_frame&& other)
@@ -165,7 +179,39 @@ bool                     const_frame::operator<(const const_frame& other) const
 bool                     const_frame::operator>(const const_frame& other) const { return impl_ > other.impl_; }
 const pixel_format_desc& const_frame::pixel_format_desc() const { return impl_->desc_; }
 const array<const std::uint8_t>& const_frame::image_data(std::size_t index) const { return impl_->image_data(index); }
+std::shared_ptr<const std::uint8_t> const_frame::share_image_data(std::size_t index) const
+{
+    auto storage = std::make_shared<array<const std::uint8_t>>(impl_->image_data(index));
+    auto ptr     = storage->data();
+    return std::shared_ptr<const std::uint8_t>(std::move(storage), ptr);
+}
+const array<const std::uint8_t>& const_frame::converted_image_data(output_format format) const
+{
+    static const array<const std::uint8_t> empty;
+
+    if (format == output_format::bgra) {
+        return impl_->image_data(0);
+    }
+    auto it = impl_->converted_.find(format);
+    return it != impl_->converted_.end() ? it->second : empty;
+}
+const_frame const_frame::rendition(output_format format) const
+{
+    auto& image = converted_image_data(format);
+    if (!image || output_format_scale(format) == 1) {
+        return const_frame{};
+    }
+
+    auto scale = output_format_scale(format);
+    auto depth = impl_->desc_.planes.at(0).depth;
+    auto desc  = core::pixel_format_desc(pixel_format::bgra, impl_->desc_.color_space);
+    desc.planes.push_back(pixel_format_desc::plane(
+        static_cast<int>(impl_->width()) / scale, static_cast<int>(impl_->height()) / scale, 4, depth));
+
+    return const_frame(impl_->tag_, {image}, impl_->audio_data_, desc, {}, impl_->audio_channels_);
+}
 const array<const std::int32_t>& const_frame::audio_data() const { return impl_->audio_data_; }
+int                              const_frame::audio_channels() const { return impl_->audio_channels_; }
 std::size_t                      const_frame::width() const { return impl_->width(); }
 std::size_t                      const_frame::height() const { return impl_->height(); }
 std::size_t                      const_frame::size() const { return impl_->size(); }
@@ -176,16 +222,31 @@ const_frame                      const_frame::with_tag(const void* new_tag) cons
     }
     
     std::vector<array<const std::uint8_t>> image_data_copy = impl_->image_data_;
-    auto new_frame = const_frame(new_tag, std::move(image_data_copy), impl_->audio_data_, impl_->desc_);
+    auto new_frame = const_frame(new_tag,
+                                 std::move(image_data_copy),
+                                 impl_->audio_data_,
+                                 impl_->desc_,
+                                 impl_->converted_,
+                                 impl_->audio_channels_);
     
     new_frame.impl_->geometry_ = impl_->geometry_;
-    if (impl_->opaque_.has_value()) {
-        new_frame.impl_->opaque_ = impl_->opaque_;
-    }
+    new_frame.impl_->opaque_   = opaque();
     
     return new_frame;
 }
 const frame_geometry&            const_frame::geometry() const { return impl_->geometry_; }
-const std::any&                  const_frame::opaque() const { return impl_->opaque_; }
+std::any                         const_frame::opaque() const
+{
+    std::lock_guard<std::mutex> lock(impl_->opaque_mutex_);
+    return impl_->opaque_;
+}
+std::any                         const_frame::opaque(const std::function<std::any()>& init) const
+{
+    std::lock_guard<std::mutex> lock(impl_->opaque_mutex_);
+    if (!impl_->opaque_.has_value()) {
+        impl_->opaque_ = init();
+    }
+    return impl_->opaque_;
+}
 const_frame::operator bool() const { return impl_ != nullptr && impl_->desc_.format != core::pixel_format::invalid; }
 }} // namespace caspar::core
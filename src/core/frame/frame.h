@@ -1,5 +1,7 @@
 #pragma once
 
+#include "output_format.h"
+
 #include <common/array.h>
 
 #include <any>
@@ -41,6 +43,11 @@ class mutable_frame final
     array<std::int32_t>&       audio_data();
     const array<std::int32_t>& audio_data() const;
 
+    // The number of channels interleaved in audio_data(), or 0 if the audio has the channel's channel count. The audio
+    // mixer maps other channel counts onto the channel's.
+    int& audio_channels();
+    int  audio_channels() const;
+
     std::size_t width() const;
 
     std::size_t height() const;
@@ -62,7 +69,9 @@ class const_frame final
     explicit const_frame(const void*                            tag,
                          std::vector<array<const std::uint8_t>> image_data,
                          array<const std::int32_t>              audio_data,
-                         const struct pixel_format_desc&        desc);
+                         const struct pixel_format_desc&        desc,
+                         converted_images                       converted      = {},
+                         int                                    audio_channels = 0);
     const_frame(const const_frame& other);
     const_frame(mutable_frame&& other);
 
@@ -74,8 +83,23 @@ class const_frame final
 
     const array<const std::uint8_t>& image_data(std::size_t index) const;
 
+    // Returns a pointer to an image plane which keeps the plane's storage alive, so that it can be handed on without
+    // copying. Rows are pixel_format_desc().planes[index].linesize bytes apart.
+    std::shared_ptr<const std::uint8_t> share_image_data(std::size_t index) const;
+
+    // Returns the image converted to format by the channel, or an empty array if no consumer asked for it. See
+    // frame_consumer::output_formats.
+    const array<const std::uint8_t>& converted_image_data(output_format format) const;
+
+    // Returns the downscaled rendition of the image in format, e.g. output_format::bgra_half, as a frame with the same
+    // audio, or an empty frame if no consumer asked for it.
+    const_frame rendition(output_format format) const;
+
     const array<const std::int32_t>& audio_data() const;
 
+    // See mutable_frame::audio_channels.
+    int audio_channels() const;
+
     std::size_t width() const;
 
     std::size_t height() const;
@@ -85,7 +109,12 @@ class const_frame final
     const void* stream_tag() const;
     const_frame with_tag(const void* new_tag) const;
 
-    const std::any& opaque() const;
+    // Returns a copy, as opaque(init) may store the value concurrently.
+    std::any opaque() const;
+
+    // Returns the opaque value, first storing init() if the frame has none. This lets a frame factory attach data,
+    // such as uploaded textures, to frames it didn't create. The value lives as long as the frame.
+    std::any opaque(const std::function<std::any()>& init) const;
 
     const class frame_geometry& geometry() const;
 
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "output_format.h"
+
+#include <common/except.h>
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace caspar { namespace core {
+
+namespace {
+
+struct ycbcr
+{
+    float y;
+    float cb;
+    float cr;
+};
+
+// Reads the pixels of a bgra row as y, cb, cr, with y in [0, 1] and cb, cr in [-0.5, 0.5].
+class row_reader
+{
+    const std::uint8_t* data_;
+    int                 width_;
+    common::bit_depth   depth_;
+    float               kr_;
+    float               kb_;
+
+  public:
+    row_reader(const std::uint8_t* data, int width, common::bit_depth depth, color_space color_space)
+        : data_(data)
+        , width_(width)
+        , depth_(depth)
+    {
+        switch (color_space) {
+            case color_space::bt601:
+                kr_ = 0.299f;
+                kb_ = 0.114f;
+                break;
+            case color_space::bt2020:
+                kr_ = 0.2627f;
+                kb_ = 0.0593f;
+                break;
+            default:
+                kr_ = 0.2126f;
+                kb_ = 0.0722f;
+                break;
+        }
+    }
+
+    // Pixels beyond the row are black.
+    ycbcr operator()(int x) const
+    {
+        if (x >= width_) {
+            return {0.0f, 0.0f, 0.0f};
+        }
+
+        float b, g, r;
+        if (depth_ == common::bit_depth::bit8) {
+            auto pixel = data_ + static_cast<std::size_t>(x) * 4;
+            b          = pixel[0] / 255.0f;
+            g          = pixel[1] / 255.0f;
+            r          = pixel[2] / 255.0f;
+        } else {
+            auto pixel = reinterpret_cast<const std::uint16_t*>(data_) + static_cast<std::size_t>(x) * 4;
+            b          = pixel[0] / 65535.0f;
+            g          = pixel[1] / 65535.0f;
+            r          = pixel[2] / 65535.0f;
+        }
+
+        auto y = kr_ * r + (1.0f - kr_ - kb_) * g + kb_ * b;
+        return {y, (b - y) / (2.0f * (1.0f - kb_)), (r - y) / (2.0f * (1.0f - kr_))};
+    }
+};
+
+ycbcr average(const ycbcr& a, const ycbcr& b)
+{
+    return {(a.y + b.y) / 2.0f, (a.cb + b.cb) / 2.0f, (a.cr + b.cr) / 2.0f};
+}
+
+// scale is 1 for 8 bit and 4 for 10 bit samples.
+std::uint32_t luma(float y, float scale)
+{
+    return static_cast<std::uint32_t>(std::lround(std::clamp((16.0f + 219.0f * y) * scale, 0.0f, 255.0f * scale)));
+}
+
+std::uint32_t chroma(float c, float scale)
+{
+    return static_cast<std::uint32_t>(std::lround(std::clamp((128.0f + 224.0f * c) * scale, 0.0f, 255.0f * scale)));
+}
+
+// Packs 6 pixels of a bgra row as 4 words of v210, the way the DeckLink consumer's HDR packer does: samples are
+// truncated to 10 bits, each pixel's first three words are weighed by the rows of v210_matrix in memory order, and
+// chroma is taken from the even pixels, rows 6-8 at the cb positions and rows 3-5 at the cr positions. Pixels beyond
+// the row are zero.
+void pack_v210(const std::uint8_t*              data,
+               int                              x,
+               int                              width,
+               common::bit_depth                depth,
+               const std::vector<std::int32_t>& m,
+               std::uint32_t*                   dst)
+{
+    std::int32_t w[6][3] = {};
+    for (int n = 0; n < 6 && x + n < width; ++n) {
+        for (int c = 0; c < 3; ++c) {
+            auto index = static_cast<std::size_t>(x + n) * 4 + c;
+            w[n][c]    = depth == common::bit_depth::bit8 ? data[index] << 2
+                                                          : reinterpret_cast<const std::uint16_t*>(data)[index] >> 6;
+        }
+    }
+
+    auto y = [&](int n) {
+        return static_cast<std::uint32_t>((64 << 20) + m[0] * w[n][0] + m[1] * w[n][1] + m[2] * w[n][2]) >> 20;
+    };
+    auto c = [&](int n, int row) {
+        return static_cast<std::uint32_t>((1025 << 19) + m[row] * w[n][0] + m[row + 1] * w[n][1] +
+                                          m[row + 2] * w[n][2]) >>
+               20;
+    };
+
+    dst[0] = c(0, 6) | y(0) << 10 | c(0, 3) << 20;
+    dst[1] = y(1) | c(2, 6) << 10 | y(2) << 20;
+    dst[2] = c(2, 3) | y(3) << 10 | c(4, 6) << 20;
+    dst[3] = y(4) | c(4, 3) << 10 | y(5) << 20;
+}
+
+// Averages scale x scale pixels of a bgra image into each pixel of dest, rounding to nearest.
+template <typename T>
+void downscale(const std::uint8_t* source, int width, int height, int scale, std::uint8_t* dest)
+{
+    auto src_pixels = reinterpret_cast<const T*>(source);
+    auto dst_pixels = reinterpret_cast<T*>(dest);
+    auto dst_width  = width / scale;
+    auto count      = static_cast<std::uint32_t>(scale * scale);
+
+    tbb::parallel_for(0, height / scale, [&](int y) {
+        for (int x = 0; x < dst_width; ++x) {
+            std::uint32_t sum[4] = {0, 0, 0, 0};
+            for (int sy = 0; sy < scale; ++sy) {
+                auto src = src_pixels + (static_cast<std::size_t>(y * scale + sy) * width + x * scale) * 4;
+                for (int n = 0; n < scale * 4; ++n) {
+                    sum[n % 4] += src[n];
+                }
+            }
+
+            auto dst = dst_pixels + (static_cast<std::size_t>(y) * dst_width + x) * 4;
+            for (int n = 0; n < 4; ++n) {
+                dst[n] = static_cast<T>((sum[n] + count / 2) / count);
+            }
+        }
+    });
+}
+
+} // namespace
+
+std::wstring to_wstring(output_format format)
+{
+    switch (format) {
+        case output_format::bgra:
+            return L"bgra";
+        case output_format::uyvy:
+            return L"uyvy";
+        case output_format::v210:
+            return L"v210";
+        case output_format::nv12:
+            return L"nv12";
+        case output_format::yuv422p10:
+            return L"yuv422p10";
+        case output_format::bgra_half:
+            return L"bgra_half";
+        case output_format::bgra_quarter:
+            return L"bgra_quarter";
+        case output_format::bgra_eighth:
+            return L"bgra_eighth";
+    }
+    return L"invalid";
+}
+
+int output_format_scale(output_format format)
+{
+    switch (format) {
+        case output_format::bgra_half:
+            return 2;
+        case output_format::bgra_quarter:
+            return 4;
+        case output_format::bgra_eighth:
+            return 8;
+        default:
+            return 1;
+    }
+}
+
+std::size_t output_format_linesize(output_format format, int width, common::bit_depth depth)
+{
+    switch (format) {
+        case output_format::bgra:
+            return static_cast<std::size_t>(width) * 4 * (depth == common::bit_depth::bit8 ? 1 : 2);
+        case output_format::uyvy:
+            return static_cast<std::size_t>(width) * 2;
+        case output_format::v210:
+            return static_cast<std::size_t>((width + 47) / 48) * 128;
+        case output_format::nv12:
+            return static_cast<std::size_t>(width);
+        case output_format::yuv422p10:
+            return static_cast<std::size_t>(width) * 2;
+        case output_format::bgra_half:
+        case output_format::bgra_quarter:
+        case output_format::bgra_eighth:
+            return output_format_linesize(output_format::bgra, width / output_format_scale(format), depth);
+    }
+    return 0;
+}
+
+std::size_t output_format_size(output_format format, int width, int height, common::bit_depth depth)
+{
+    auto linesize = output_format_linesize(format, width, depth);
+    switch (format) {
+        case output_format::bgra:
+        case output_format::v210:
+            return linesize * height;
+        case output_format::uyvy:
+            return width % 2 == 0 ? linesize * height : 0;
+        case output_format::nv12:
+            return width % 4 == 0 && height % 2 == 0 ? linesize * height * 3 / 2 : 0;
+        case output_format::yuv422p10:
+            return width % 4 == 0 ? linesize * height * 2 : 0;
+        case output_format::bgra_half:
+        case output_format::bgra_quarter:
+        case output_format::bgra_eighth:
+            return linesize * (height / output_format_scale(format));
+    }
+    return 0;
+}
+
+std::vector<std::int32_t> v210_matrix(color_space color_space)
+{
+    static const float bt601[] = {0.299f, 0.587f, 0.114f, -0.168736f, -0.331264f, 0.5f, 0.5f, -0.418688f, -0.081312f};
+    static const float bt709[] = {0.212639005871510f,
+                                  0.715168678767756f,
+                                  0.072192315360734f,
+                                  -0.114592177555732f,
+                                  -0.385407822444268f,
+                                  0.5f,
+                                  0.5f,
+                                  -0.454155517037873f,
+                                  -0.045844482962127f};
+    static const float bt2020[] = {0.262700212011267f,
+                                   0.677998071518871f,
+                                   0.059301716469862f,
+                                   -0.139630430187157f,
+                                   -0.360369569812843f,
+                                   0.5f,
+                                   0.5f,
+                                   -0.459784529009814f,
+                                   -0.040215470990186f};
+
+    const auto* matrix = color_space == color_space::bt601    ? bt601
+                         : color_space == color_space::bt2020 ? bt2020
+                                                              : bt709;
+
+    const float luma_range   = 876.f * (1024.f / 1023.f);
+    const float chroma_range = 896.f * (1024.f / 1023.f);
+
+    std::vector<std::int32_t> result(9);
+    for (int n = 0; n < 9; ++n) {
+        result[n] = static_cast<std::int32_t>(std::round(matrix[n] * (n < 3 ? luma_range : chroma_range) * 1024.f));
+    }
+    return result;
+}
+
+array<const std::uint8_t> convert_image(const array<const std::uint8_t>& bgra,
+                                        int                              width,
+                                        int                              height,
+                                        common::bit_depth                depth,
+                                        output_format                    format,
+                                        color_space                      color_space)
+{
+    if (format == output_format::bgra) {
+        return bgra;
+    }
+
+    auto size = output_format_size(format, width, height, depth);
+    if (size == 0 || bgra.size() < output_format_size(output_format::bgra, width, height, depth)) {
+        CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info(L"Can't convert a " + std::to_wstring(width) + L"x" +
+                                                              std::to_wstring(height) + L" image to " +
+                                                              to_wstring(format)));
+    }
+
+    auto source_linesize = output_format_linesize(output_format::bgra, width, depth);
+    auto linesize        = output_format_linesize(format, width, depth);
+    auto row             = [&](int y) {
+        return row_reader(bgra.data() + y * source_linesize, width, depth, color_space);
+    };
+
+    std::vector<std::uint8_t> result(size);
+    auto                      dest = result.data();
+
+    switch (format) {
+        case output_format::uyvy:
+            tbb::parallel_for(0, height, [&](int y) {
+                auto src = row(y);
+                auto dst = dest + y * linesize;
+                for (int x = 0; x < width; x += 2) {
+                    auto p0 = src(x);
+                    auto p1 = src(x + 1);
+                    auto c  = average(p0, p1);
+                    dst[0]  = static_cast<std::uint8_t>(chroma(c.cb, 1.0f));
+                    dst[1]  = static_cast<std::uint8_t>(luma(p0.y, 1.0f));
+                    dst[2]  = static_cast<std::uint8_t>(chroma(c.cr, 1.0f));
+                    dst[3]  = static_cast<std::uint8_t>(luma(p1.y, 1.0f));
+                    dst += 4;
+                }
+            });
+            break;
+        case output_format::v210: {
+            auto matrix = v210_matrix(color_space);
+            tbb::parallel_for(0, height, [&](int y) {
+                auto src = bgra.data() + y * source_linesize;
+                auto dst = reinterpret_cast<std::uint32_t*>(dest + y * linesize);
+                for (int x = 0; x < static_cast<int>(linesize / 16) * 6; x += 6) {
+                    pack_v210(src, x, width, depth, matrix, dst);
+                    dst += 4;
+                }
+            });
+            break;
+        }
+        case output_format::nv12:
+            tbb::parallel_for(0, height / 2, [&](int y) {
+                auto src0 = row(y * 2);
+                auto src1 = row(y * 2 + 1);
+                auto dst0 = dest + (y * 2) * linesize;
+                auto dst1 = dest + (y * 2 + 1) * linesize;
+                auto dstc = dest + (height + y) * linesize;
+                for (int x = 0; x < width; x += 2) {
+                    ycbcr p[4]  = {src0(x), src0(x + 1), src1(x), src1(x + 1)};
+                    auto  c     = average(average(p[0], p[1]), average(p[2], p[3]));
+                    dst0[x]     = static_cast<std::uint8_t>(luma(p[0].y, 1.0f));
+                    dst0[x + 1] = static_cast<std::uint8_t>(luma(p[1].y, 1.0f));
+                    dst1[x]     = static_cast<std::uint8_t>(luma(p[2].y, 1.0f));
+                    dst1[x + 1] = static_cast<std::uint8_t>(luma(p[3].y, 1.0f));
+                    dstc[x]     = static_cast<std::uint8_t>(chroma(c.cb, 1.0f));
+                    dstc[x + 1] = static_cast<std::uint8_t>(chroma(c.cr, 1.0f));
+                }
+            });
+            break;
+        case output_format::yuv422p10:
+            tbb::parallel_for(0, height, [&](int y) {
+                auto src    = row(y);
+                auto dst_y  = reinterpret_cast<std::uint16_t*>(dest + y * linesize);
+                auto dst_cb = reinterpret_cast<std::uint16_t*>(dest + height * linesize + y * linesize / 2);
+                auto dst_cr = reinterpret_cast<std::uint16_t*>(dest + height * linesize * 3 / 2 + y * linesize / 2);
+                for (int x = 0; x < width; x += 2) {
+                    auto p0       = src(x);
+                    auto p1       = src(x + 1);
+                    auto c        = average(p0, p1);
+                    dst_y[x]      = static_cast<std::uint16_t>(luma(p0.y, 4.0f));
+                    dst_y[x + 1]  = static_cast<std::uint16_t>(luma(p1.y, 4.0f));
+                    dst_cb[x / 2] = static_cast<std::uint16_t>(chroma(c.cb, 4.0f));
+                    dst_cr[x / 2] = static_cast<std::uint16_t>(chroma(c.cr, 4.0f));
+                }
+            });
+            break;
+        case output_format::bgra_half:
+        case output_format::bgra_quarter:
+        case output_format::bgra_eighth:
+            if (depth == common::bit_depth::bit8) {
+                downscale<std::uint8_t>(bgra.data(), width, height, output_format_scale(format), dest);
+            } else {
+                downscale<std::uint16_t>(bgra.data(), width, height, output_format_scale(format), dest);
+            }
+            break;
+        default:
+            break;
+    }
+
+    return array<const std::uint8_t>(array<std::uint8_t>(std::move(result)));
+}
+
+}} // namespace caspar::core
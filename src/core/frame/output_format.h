@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "pixel_format.h"
+
+#include <common/array.h>
+#include <common/bit_depth.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace caspar { namespace core {
+
+// Image formats a channel can hand its consumers. Anything but bgra is converted from the mixed image, in the
+// channel's color space, with video range levels. Rows are not padded unless stated.
+enum class output_format
+{
+    bgra,      // The mixed image, 8 or 16 bit depending on the channel depth.
+    uyvy,      // 8 bit 4:2:2, packed as cb, y, cr, y.
+    v210,      // 10 bit 4:2:2, 6 pixels in four little endian 32 bit words. Rows are padded to 128 bytes.
+    nv12,      // 8 bit 4:2:0, a y plane followed by an interleaved cb, cr plane.
+    yuv422p10, // 10 bit 4:2:2, y, cb and cr planes of little endian 16 bit samples.
+
+    // The mixed image box filtered to 1/2, 1/4 or 1/8 of its width and height, for previews. Pixels beyond the last
+    // whole box are dropped. See const_frame::rendition.
+    bgra_half,
+    bgra_quarter,
+    bgra_eighth,
+};
+
+using converted_images = std::map<output_format, array<const std::uint8_t>>;
+
+std::wstring to_wstring(output_format format);
+
+// Returns how many times narrower and shorter than the mixed image format is.
+int output_format_scale(output_format format);
+
+// Returns the number of bytes between rows of the first plane.
+std::size_t output_format_linesize(output_format format, int width, common::bit_depth depth);
+
+// Returns the number of bytes of an image, or 0 if format can't hold an image of that size, e.g. 4:2:0 needs an even
+// height.
+std::size_t output_format_size(output_format format, int width, int height, common::bit_depth depth);
+
+// Returns the fixed point matrix v210 is converted with: rows of y, cb and cr coefficients scaled to 10 bit video range
+// and by 2^20. The DeckLink consumer packs its HDR ports with the same matrix.
+std::vector<std::int32_t> v210_matrix(color_space color_space);
+
+// Converts a bgra image on the CPU. This is the fallback when the image mixer can't convert on its own, and the
+// reference for those which can.
+array<const std::uint8_t> convert_image(const array<const std::uint8_t>& bgra,
+                                        int                              width,
+                                        int                              height,
+                                        common::bit_depth                depth,
+                                        output_format                    format,
+                                        color_space                      color_space);
+
+}} // namespace caspar::core
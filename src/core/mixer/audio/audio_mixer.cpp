@@ -21,6 +21,16 @@
 
 #include "../../StdAfx.h"
 
+#if defined(USE_SIMDE)
+#define SIMDE_ENABLE_NATIVE_ALIASES
+#include <simde/x86/avx2.h>
+#define CASPAR_AUDIO_MIXER_AVX2
+#elif defined(__AVX2__) || defined(_MSC_VER)
+// MSVC doesn't define __AVX2__ without /arch:AVX2, but always provides the intrinsics, see hdr_v210_strategy.cpp.
+#include <immintrin.h>
+#define CASPAR_AUDIO_MIXER_AVX2
+#endif
+
 #include "audio_mixer.h"
 
 #include <core/frame/frame.h>
@@ -33,9 +43,11 @@
 #include <boost/range/algorithm.hpp>
 
 #include <atomic>
+#include <cmath>
+#include <map>
+#include <numeric>
 #include <stack>
 #include <vector>
-#include <map>
 
 namespace caspar { namespace core {
 
@@ -46,16 +58,290 @@ struct audio_item
     const void*          tag = nullptr;
     audio_transform      transform;
     array<const int32_t> samples;
+    int                  channels = 0; // 0 if the samples have the channel's channel count
+};
+
+// Largest float which converts to int32_t without overflowing.
+static const float max_sample = 2147483520.0f;
+static const float min_sample = -2147483648.0f;
+
+// Gain which moves from one value to another over a block of samples.
+struct gain_ramp
+{
+    float           from       = 1.0f;
+    float           to         = 1.0f;
+    float           inv_length = 0.0f; // 1 / number of samples in the block
+    audio_gain_ramp curve      = audio_gain_ramp::linear;
+
+    gain_ramp() = default;
+    gain_ramp(float from, float to, size_t length, audio_gain_ramp curve)
+        : from(from)
+        , to(to)
+        , inv_length(length > 0 ? 1.0f / static_cast<float>(length) : 0.0f)
+        , curve(curve)
+    {
+    }
+
+    bool constant() const { return from == to; }
+
+    float at(size_t position) const
+    {
+        if (constant()) {
+            return to;
+        }
+        auto t = static_cast<float>(position) * inv_length;
+        if (curve == audio_gain_ramp::equal_power) {
+            // Interpolate the power rather than the amplitude.
+            return std::sqrt(from * from + (to * to - from * from) * t);
+        }
+        return from + (to - from) * t;
+    }
+
+#ifdef CASPAR_AUDIO_MIXER_AVX2
+    // Gains of the 8 samples starting at position.
+    __m256 at8(size_t position) const
+    {
+        if (constant()) {
+            return _mm256_set1_ps(to);
+        }
+        auto t = _mm256_mul_ps(
+            _mm256_add_ps(_mm256_set1_ps(static_cast<float>(position)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)),
+            _mm256_set1_ps(inv_length));
+        if (curve == audio_gain_ramp::equal_power) {
+            auto from2 = _mm256_set1_ps(from * from);
+            auto delta = _mm256_set1_ps(to * to - from * from);
+            return _mm256_sqrt_ps(_mm256_max_ps(_mm256_add_ps(from2, _mm256_mul_ps(delta, t)), _mm256_setzero_ps()));
+        }
+        return _mm256_add_ps(_mm256_set1_ps(from), _mm256_mul_ps(_mm256_set1_ps(to - from), t));
+    }
+#endif
 };
 
-using audio_buffer_ps = std::vector<double>;
+// dst[n] += src[n] * ramp.at(position + n)
+static void mix_samples(float* dst, const int32_t* src, size_t count, const gain_ramp& ramp, size_t position)
+{
+    size_t n = 0;
+#ifdef CASPAR_AUDIO_MIXER_AVX2
+    for (; n + 8 <= count; n += 8) {
+        auto s = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + n)));
+        auto d = _mm256_loadu_ps(dst + n);
+        _mm256_storeu_ps(dst + n, _mm256_add_ps(d, _mm256_mul_ps(s, ramp.at8(position + n))));
+    }
+#endif
+    for (; n < count; ++n) {
+        dst[n] += static_cast<float>(src[n]) * ramp.at(position + n);
+    }
+}
+
+// Maps frames of interleaved samples with src_channels channels onto dst_channels channels. Channel n goes to channel
+// n, the channels the source lacks are silent and the ones the destination lacks are dropped.
+static void remix_samples(int32_t* dst, int dst_channels, const int32_t* src, int src_channels, size_t frames)
+{
+    const auto common = std::min(src_channels, dst_channels);
+
+    size_t n = 0;
+#ifdef CASPAR_AUDIO_MIXER_AVX2
+    if (dst_channels % 8 == 0) {
+        // A masked load of every 8 destination channels, which reads 0 for the channels the source lacks.
+        const auto lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        for (; n < frames; ++n) {
+            auto s = src + n * src_channels;
+            auto d = dst + n * dst_channels;
+            for (int c = 0; c < dst_channels; c += 8) {
+                auto v = _mm256_setzero_si256();
+                if (c < common) {
+                    v = _mm256_maskload_epi32(s + c, _mm256_cmpgt_epi32(_mm256_set1_epi32(common - c), lanes));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + c), v);
+            }
+        }
+    }
+#endif
+    for (; n < frames; ++n) {
+        auto d = std::copy_n(src + n * src_channels, common, dst + n * dst_channels);
+        std::fill_n(d, dst_channels - common, 0);
+    }
+}
+
+// Applies the master gain, clamps and converts src into dst, and keeps the running absolute peak of every sample
+// position in peaks. peaks.size() must be a multiple of 8 and of the channel count, so that every position always
+// belongs to the same channel.
+static void
+write_samples(int32_t* dst, const float* src, size_t count, const gain_ramp& ramp, std::vector<float>& peaks)
+{
+    const auto period = peaks.size();
+    auto       peak   = peaks.data();
+
+    size_t n = 0;
+#ifdef CASPAR_AUDIO_MIXER_AVX2
+    const auto max_value = _mm256_set1_ps(max_sample);
+    const auto min_value = _mm256_set1_ps(min_sample);
+    const auto sign_mask = _mm256_set1_ps(-0.0f);
+    for (; n + period <= count; n += period) {
+        for (size_t p = 0; p < period; p += 8) {
+            auto v = _mm256_mul_ps(_mm256_loadu_ps(src + n + p), ramp.at8(n + p));
+            v      = _mm256_min_ps(_mm256_max_ps(v, min_value), max_value);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + n + p), _mm256_cvttps_epi32(v));
+            _mm256_storeu_ps(peak + p, _mm256_max_ps(_mm256_loadu_ps(peak + p), _mm256_andnot_ps(sign_mask, v)));
+        }
+    }
+#endif
+    for (; n < count; ++n) {
+        auto v = src[n] * ramp.at(n);
+        v      = std::min(std::max(v, min_sample), max_sample);
+        dst[n] = static_cast<int32_t>(v);
+
+        auto& p = peak[n % period];
+        p       = std::max(p, std::abs(v));
+    }
+}
+
+// State which is kept for a stream between frames.
+struct audio_stream
+{
+    const void*   tag        = nullptr;
+    std::uint64_t last_seen  = 0; // Number of the last frame the stream was mixed in
+    bool          continuing = false; // Whether the stream was also mixed in the frame before last_seen
+    float         gain       = 0.0f;
+
+    // Cadence samples left over from the previous frame, and the ones left over from this frame. Both keep their
+    // capacity for as long as the stream lives, and are swapped at the end of every frame.
+    std::vector<int32_t> carry;
+    std::vector<int32_t> next_carry;
+};
+
+// Open-addressing hash table of audio streams, keyed by stream tag. Removed slots keep their buffers, so that new
+// streams can reuse them without allocating.
+class audio_stream_table
+{
+  public:
+    audio_stream_table()
+        : slots_(16)
+    {
+    }
+
+    audio_stream* find(const void* tag)
+    {
+        for (auto n = home(tag);; n = (n + 1) & mask()) {
+            if (slots_[n].tag == tag) {
+                return &slots_[n];
+            }
+            if (!slots_[n].tag) {
+                return nullptr;
+            }
+        }
+    }
+
+    audio_stream& insert(const void* tag)
+    {
+        if ((count_ + 1) * 2 > slots_.size()) {
+            grow();
+        }
+
+        auto n = home(tag);
+        while (slots_[n].tag) {
+            n = (n + 1) & mask();
+        }
+
+        auto& stream      = slots_[n];
+        stream.tag        = tag;
+        stream.last_seen  = 0;
+        stream.continuing = false;
+        stream.gain       = 0.0f;
+        stream.carry.clear();
+        stream.next_carry.clear();
+        count_++;
+        return stream;
+    }
+
+    template <typename Func>
+    void for_each(Func&& func)
+    {
+        for (auto& stream : slots_) {
+            if (stream.tag) {
+                func(stream);
+            }
+        }
+    }
+
+    // Removes every stream for which pred returns true.
+    template <typename Pred>
+    void erase_if(Pred&& pred)
+    {
+        for (size_t n = 0; n < slots_.size();) {
+            if (slots_[n].tag && pred(slots_[n])) {
+                erase(n);
+            } else {
+                ++n;
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (auto& stream : slots_) {
+            stream.tag = nullptr;
+        }
+        count_ = 0;
+    }
+
+    size_t size() const { return count_; }
+
+  private:
+    size_t mask() const { return slots_.size() - 1; }
+
+    // Fibonacci hashing, since the low bits of a pointer are mostly zero.
+    size_t home(const void* tag) const
+    {
+        auto hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(tag)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(hash >> 32) & mask();
+    }
+
+    // Backward shift deletion, which keeps every probe sequence intact without tombstones.
+    void erase(size_t n)
+    {
+        slots_[n].tag = nullptr;
+        count_--;
+
+        for (auto next = (n + 1) & mask(); slots_[next].tag; next = (next + 1) & mask()) {
+            auto h = home(slots_[next].tag);
+            // Move the entry back if its home slot is not cyclically in (n, next].
+            if (n <= next ? (h <= n || h > next) : (h <= n && h > next)) {
+                std::swap(slots_[n], slots_[next]);
+                n = next;
+            }
+        }
+    }
+
+    void grow()
+    {
+        std::vector<audio_stream> slots(slots_.size() * 2);
+        std::swap(slots, slots_);
+        for (auto& stream : slots) {
+            if (stream.tag) {
+                auto n = home(stream.tag);
+                while (slots_[n].tag) {
+                    n = (n + 1) & mask();
+                }
+                slots_[n] = std::move(stream);
+            }
+        }
+    }
+
+    std::vector<audio_stream> slots_;
+    size_t                    count_ = 0;
+};
+
+// Number of frames a stream's buffers are kept after it was last mixed.
+static const std::uint64_t stream_timeout_frames = 50;
 
 struct audio_mixer::impl
 {
     monitor::state                              state_;
     std::stack<core::audio_transform>           transform_stack_;
     std::vector<audio_item>                     items_;
-    std::map<const void*, std::vector<int32_t>> audio_streams_;
+    audio_stream_table                          audio_streams_;
+    std::uint64_t                               frame_number_{0};
     video_format_desc                           format_desc_;
     std::atomic<float>                          master_volume_{1.0f};
     spl::shared_ptr<diagnostics::graph>         graph_;
@@ -64,6 +350,11 @@ struct audio_mixer::impl
     bool                                        has_variable_cadence_{false};
     std::vector<int32_t>                        silence_buffer_;
     int                                         channels_{0};
+    std::vector<float>                          mixed_;
+    std::vector<int32_t>                        remixed_;
+    std::vector<float>                          peaks_;
+    float                                       last_master_volume_{1.0f};
+    std::atomic<audio_gain_ramp>                gain_ramp_{audio_gain_ramp::linear};
 
     impl(spl::shared_ptr<diagnostics::graph> graph)
         : graph_(std::move(graph))
@@ -87,7 +378,8 @@ struct audio_mixer::impl
         if (transform_stack_.top().volume < 0.002 || !frame.audio_data())
             return;
 
-        items_.push_back(std::move(audio_item{frame.stream_tag(), transform_stack_.top(), frame.audio_data()}));
+        items_.push_back(std::move(
+            audio_item{frame.stream_tag(), transform_stack_.top(), frame.audio_data(), frame.audio_channels()}));
     }
 
     void pop() { transform_stack_.pop(); }
@@ -96,6 +388,8 @@ struct audio_mixer::impl
 
     float get_master_volume() { return master_volume_; }
 
+    void set_gain_ramp(audio_gain_ramp ramp) { gain_ramp_ = ramp; }
+
     array<const int32_t> mix(const video_format_desc& format_desc, int nb_samples)
     {
         if (format_desc_ != format_desc) {
@@ -126,101 +420,143 @@ struct audio_mixer::impl
             }
         }
 
-        auto items    = std::move(items_);
-        auto result   = std::vector<int32_t>(size_t(nb_samples) * channels_, 0);
+        auto dst_size = size_t(nb_samples) * channels_;
+        auto result   = std::vector<int32_t>(dst_size);
+
+        // The accumulator is kept between frames, so that it is only reallocated when it has to grow.
+        mixed_.assign(dst_size, 0.0f);
 
-        auto mixed = std::vector<double>(size_t(nb_samples) * channels_, 0.0f);
+        auto curve = gain_ramp_.load();
+        frame_number_++;
 
-        std::map<const void*, std::vector<int32_t>> next_audio_streams;
-        
-        for (auto& item : items) {
+        for (auto& item : items_) {
             auto ptr       = item.samples.data();
             auto item_size = item.samples.size();
-            auto dst_size  = result.size();
 
-            size_t last_size = 0;
-            const int32_t* last_ptr = nullptr;
-            
+            // Streams with another channel count, such as a stereo clip, are remixed onto the channel's channels. The
+            // buffer keeps its capacity between items and frames.
+            if (item.channels > 0 && item.channels != channels_) {
+                auto frames = item_size / item.channels;
+                remixed_.resize(frames * channels_);
+                remix_samples(remixed_.data(), channels_, ptr, item.channels, frames);
+                ptr       = remixed_.data();
+                item_size = remixed_.size();
+            }
+
+            audio_stream* stream    = nullptr;
+            bool          duplicate = false;
+            if (item.tag) {
+                stream        = audio_streams_.find(item.tag);
+                auto inserted = !stream;
+                if (inserted) {
+                    stream = &audio_streams_.insert(item.tag);
+                    stream->carry.reserve(max_buffer_size_);
+                    stream->next_carry.reserve(max_buffer_size_);
+                }
+                // A tag can show up more than once in a frame when a layer is routed.
+                duplicate = stream->last_seen == frame_number_;
+                if (!duplicate) {
+                    stream->continuing = !inserted && stream->last_seen + 1 == frame_number_;
+                    stream->last_seen  = frame_number_;
+                }
+            }
+
+            size_t         last_size = 0;
+            const int32_t* last_ptr  = nullptr;
+
             if (has_variable_cadence_) {
-                auto audio_stream = audio_streams_.find(item.tag);
-                if (audio_stream != audio_streams_.end()) {
-                    last_size = audio_stream->second.size();
-                    last_ptr = audio_stream->second.data();
-                } else if (nullptr != item.tag) {
+                if (stream && stream->continuing) {
+                    last_size = stream->carry.size();
+                    last_ptr  = stream->carry.data();
+                } else if (stream) {
                     // Insert a sample of silence at startup
                     // Covers the startup case where there may be a cadence mismatch
                     // The sample of silence will be output before any valid audio data from the source
                     last_size = channels_;
-                    last_ptr = silence_buffer_.data();
+                    last_ptr  = silence_buffer_.data();
                 }
             }
 
-            for (auto n = 0; n < dst_size; ++n) {
-                if (last_ptr && n < last_size) {
-                    mixed[n] = static_cast<double>(last_ptr[n]) * item.transform.volume + mixed[n];
-                } else if (n < last_size + item_size) {
-                    mixed[n] = static_cast<double>(ptr[n - last_size]) * item.transform.volume + mixed[n];
-                } else {
-                    // If we run out of samples, hold the last sample value per channel
+            // Ramp from the gain the stream had in the previous frame, so that volume changes don't step at the
+            // frame boundary. Repeated tags keep a constant gain.
+            auto gain = static_cast<float>(item.transform.volume);
+            auto ramp = gain_ramp(gain, gain, dst_size, curve);
+            if (stream && !duplicate) {
+                if (stream->continuing) {
+                    ramp = gain_ramp(stream->gain, gain, dst_size, curve);
+                }
+                stream->gain = gain;
+            }
+
+            // Samples carried over from the previous frame go first, then the new samples.
+            auto carried_end = std::min(last_size, dst_size);
+            auto item_end    = std::min(last_size + item_size, dst_size);
+            if (last_ptr) {
+                mix_samples(mixed_.data(), last_ptr, carried_end, ramp, 0);
+            }
+            mix_samples(mixed_.data() + carried_end, ptr, item_end - carried_end, ramp, carried_end);
+
+            // If we run out of samples, hold the last sample value per channel
+            if (item_end < dst_size && item_size > 0) {
+                for (auto n = item_end; n < dst_size; ++n) {
                     int channel_pos = n % channels_;
-                    int offset = int(item_size) - (channels_ - channel_pos);
+                    int offset      = int(item_size) - (channels_ - channel_pos);
                     if (offset < 0) {
-                        offset = channel_pos;
+                        offset = channel_pos < int(item_size) ? channel_pos : int(item_size) - 1;
                     }
-                    mixed[n] = static_cast<double>(ptr[offset]) * item.transform.volume + mixed[n];
+                    mixed_[n] += static_cast<float>(ptr[offset]) * ramp.at(n);
                 }
             }
 
-            if (has_variable_cadence_ && item.tag) {
+            if (has_variable_cadence_ && stream) {
+                stream->next_carry.clear();
+
                 if (item_size + last_size > dst_size) {
                     // Calculate remaining samples after mixing the current frame
                     auto remaining_samples = item_size + last_size - dst_size;
-                    
+
                     // Apply the most restrictive limit and log if needed
                     if (remaining_samples > max_buffer_size_ || remaining_samples > item_size) {
                         graph_->set_tag(diagnostics::tag_severity::WARNING, "audio-buffer-overflow");
-                        
+
                         // Apply the most restrictive limit
                         remaining_samples = (max_buffer_size_ < item_size) ? max_buffer_size_ : item_size;
                     }
-                    
-                    std::vector<int32_t> buf(remaining_samples);
+
                     // Calculate the correct offset in the source buffer
                     size_t offset = (dst_size > last_size) ? (dst_size - last_size) : 0;
                     if (offset < item_size) {
-                        std::memcpy(buf.data(), ptr + offset, remaining_samples * sizeof(int32_t));
-                        next_audio_streams[item.tag] = std::move(buf);
-                    } else {
-                        next_audio_streams[item.tag] = std::vector<int32_t>();
+                        remaining_samples = std::min(remaining_samples, item_size - offset);
+                        stream->next_carry.assign(ptr + offset, ptr + offset + remaining_samples);
                     }
-                } else {
-                    next_audio_streams[item.tag] = std::vector<int32_t>();
                 }
             }
         }
+        items_.clear();
 
-        audio_streams_ = std::move(next_audio_streams);
+        audio_streams_.for_each([&](audio_stream& stream) {
+            if (stream.last_seen == frame_number_) {
+                std::swap(stream.carry, stream.next_carry);
+            }
+        });
+        audio_streams_.erase_if(
+            [&](const audio_stream& stream) { return stream.last_seen + stream_timeout_frames < frame_number_; });
 
+        // Ramp from the previous master volume, rather than stepping at the frame boundary.
         auto master_volume = master_volume_.load();
-        for (auto n = 0; n < mixed.size(); ++n) {
-            auto sample = mixed[n] * master_volume;
-            if (sample > std::numeric_limits<int32_t>::max()) {
-                result[n] = std::numeric_limits<int32_t>::max();
-            } else if (sample < std::numeric_limits<int32_t>::min()) {
-                result[n] = std::numeric_limits<int32_t>::min();
-            } else {
-                result[n] = static_cast<int32_t>(sample);
-            }
-        }
+        auto master_ramp   = gain_ramp(last_master_volume_, master_volume, dst_size, audio_gain_ramp::linear);
 
-        auto max = std::vector<int32_t>(channels_, std::numeric_limits<int32_t>::min());
-        for (size_t n = 0; n < result.size(); n += channels_) {
-            for (int ch = 0; ch < channels_; ++ch) {
-                max[ch] = std::max(max[ch], std::abs(result[n + ch]));
-            }
+        peaks_.assign(std::lcm(8, std::max(channels_, 1)), 0.0f);
+        write_samples(result.data(), mixed_.data(), dst_size, master_ramp, peaks_);
+        last_master_volume_ = master_volume;
+
+        auto max = std::vector<int32_t>(channels_, 0);
+        for (size_t n = 0; n < peaks_.size(); ++n) {
+            auto& ch = max[n % channels_];
+            ch       = std::max(ch, static_cast<int32_t>(std::min(peaks_[n], max_sample)));
         }
 
-        if (boost::range::count_if(max, [](auto val) { return val >= std::numeric_limits<int32_t>::max(); }) > 0) {
+        if (boost::range::count_if(peaks_, [](auto val) { return val >= max_sample; }) > 0) {
             graph_->set_tag(diagnostics::tag_severity::WARNING, "audio-clipping");
         }
 
@@ -242,6 +578,7 @@ void                 audio_mixer::visit(const const_frame& frame) { impl_->visit
 void                 audio_mixer::pop() { impl_->pop(); }
 void                 audio_mixer::set_master_volume(float volume) { impl_->set_master_volume(volume); }
 float                audio_mixer::get_master_volume() { return impl_->get_master_volume(); }
+void                 audio_mixer::set_gain_ramp(audio_gain_ramp ramp) { impl_->set_gain_ramp(ramp); }
 array<const int32_t> audio_mixer::operator()(const video_format_desc& format_desc, int nb_samples)
 {
     return impl_->mix(format_desc, nb_samples);
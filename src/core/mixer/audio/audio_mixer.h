@@ -36,6 +36,13 @@ class graph;
 
 namespace caspar { namespace core {
 
+// How the gain of a stream moves from one frame to the next.
+enum class audio_gain_ramp
+{
+    linear,
+    equal_power,
+};
+
 class audio_mixer final : public frame_visitor
 {
     audio_mixer(const audio_mixer&);
@@ -47,6 +54,7 @@ class audio_mixer final : public frame_visitor
     array<const int32_t> operator()(const struct video_format_desc& format_desc, int nb_samples);
     void                 set_master_volume(float volume);
     float                get_master_volume();
+    void                 set_gain_ramp(audio_gain_ramp ramp);
     core::monitor::state state() const;
 
     void push(const struct frame_transform& transform) override;
@@ -28,6 +28,7 @@
 
 #include <cstdint>
 #include <future>
+#include <vector>
 
 namespace caspar { namespace core {
 
@@ -50,12 +51,43 @@ class image_mixer
 
     virtual std::future<array<const uint8_t>> render(const struct video_format_desc& format_desc) = 0;
 
+    // Renders like render(format_desc), and converts the image to formats in the given color space. The bgra image
+    // may be left out when formats doesn't hold it. Formats missing from the result are converted from the bgra image
+    // on the CPU by the caller, which is what this default leaves to it.
+    virtual std::future<converted_images>
+    render(const struct video_format_desc& format_desc, const std::vector<output_format>& formats, color_space)
+    {
+        return std::async(std::launch::deferred, [image = render(format_desc)]() mutable {
+            converted_images images;
+            images.emplace(output_format::bgra, image.get());
+            return images;
+        });
+    }
+
     class mutable_frame create_frame(const void* tag, const struct pixel_format_desc& desc) override = 0;
     class mutable_frame create_frame(const void*                     video_stream_tag,
                                      const struct pixel_format_desc& desc,
                                      common::bit_depth               depth) override                               = 0;
 
     virtual common::bit_depth depth() const = 0;
+
+    // The number of frames, per field, which are rendered before the first of them is waited for. See core::mixer.
+    virtual void set_readback_depth(int frames) {}
+
+    // Returns the number of image planes create_frame has allocated in host memory since the last call, as the device
+    // had no upload buffers ready. They are copied when uploaded.
+    virtual std::size_t take_host_array_count() { return 0; }
+
+    struct render_stats
+    {
+        int           draw_calls       = 0;
+        int           draw_items       = 0; // Items drawn, which may be batched into fewer draw calls.
+        int           texture_barriers = 0;
+        std::uint64_t reused_frames    = 0; // Frames which reused the previous image since the mixer was created.
+    };
+
+    // Returns what it took to render the most recently completed frame.
+    virtual render_stats last_render_stats() const { return {}; }
 };
 
 }} // namespace caspar::core
@@ -48,19 +48,36 @@ struct mixer::impl
     spl::shared_ptr<diagnostics::graph>  graph_;
     audio_mixer                          audio_mixer_{graph_};
     spl::shared_ptr<image_mixer>         image_mixer_;
+    const color_space                    color_space_;
+    const int                            readback_depth_;
     std::queue<std::future<const_frame>> buffer_;
+    array<const std::uint8_t>            blank_image_;
 
     impl(const impl&)            = delete;
     impl& operator=(const impl&) = delete;
 
-    impl(int channel_index, spl::shared_ptr<diagnostics::graph> graph, spl::shared_ptr<image_mixer> image_mixer)
+    impl(int                                 channel_index,
+         spl::shared_ptr<diagnostics::graph> graph,
+         spl::shared_ptr<image_mixer>        image_mixer,
+         core::color_space                   color_space,
+         int                                 readback_depth)
         : channel_index_(channel_index)
         , graph_(std::move(graph))
         , image_mixer_(std::move(image_mixer))
+        , color_space_(color_space)
+        , readback_depth_(readback_depth)
     {
+        image_mixer_->set_readback_depth(readback_depth_);
+
+        graph_->set_color("host-arrays", diagnostics::color(0.9f, 0.9f, 0.3f, 0.8f));
+        graph_->set_color("texture-barriers", diagnostics::color(0.3f, 0.6f, 0.9f, 0.8f));
+        graph_->set_color("mix-queue", diagnostics::color(0.9f, 0.6f, 0.9f, 0.8f));
     }
 
-    const_frame operator()(std::vector<draw_frame> frames, const video_format_desc& format_desc, int nb_samples)
+    const_frame operator()(std::vector<draw_frame>           frames,
+                           const video_format_desc&          format_desc,
+                           int                               nb_samples,
+                           const std::vector<output_format>& formats)
     {
         image_mixer_->update_aspect_ratio(static_cast<double>(format_desc.square_width) /
                                           static_cast<double>(format_desc.square_height));
@@ -71,51 +88,118 @@ struct mixer::impl
             frame.accept(*image_mixer_);
         }
 
-        auto image = image_mixer_->render(format_desc);
+        graph_->set_value("host-arrays", static_cast<double>(image_mixer_->take_host_array_count()) / 8);
+
+        auto images = image_mixer_->render(format_desc, formats, color_space_);
         auto audio = audio_mixer_(format_desc, nb_samples);
 
         state_["audio"] = audio_mixer_.state();
 
+        auto render_stats                = image_mixer_->last_render_stats();
+        state_["image/draw_calls"]       = render_stats.draw_calls;
+        state_["image/draw_items"]       = render_stats.draw_items;
+        state_["image/texture_barriers"] = render_stats.texture_barriers;
+        state_["image/reused_frames"]    = render_stats.reused_frames;
+        graph_->set_value("texture-barriers",
+                          render_stats.draw_calls > 0
+                              ? static_cast<double>(render_stats.texture_barriers) / render_stats.draw_calls
+                              : 0.0);
+
         auto depth = image_mixer_->depth();
 
+        // Consumers still expect a bgra image of the right size when the image mixer didn't read it back.
+        auto image_size = output_format_size(output_format::bgra, format_desc.width, format_desc.height, depth);
+        if (blank_image_.size() != image_size) {
+            blank_image_ = array<std::uint8_t>(image_size);
+        }
+
         buffer_.push(std::async(std::launch::deferred,
-                                [image = std::move(image),
-                                 audio = std::move(audio),
-                                 graph = graph_,
+                                [images = std::move(images),
+                                 audio  = std::move(audio),
+                                 graph  = graph_,
+                                 blank  = blank_image_,
                                  depth,
                                  format_desc,
-                                 tag = this]() mutable {
-                                    auto desc = pixel_format_desc(pixel_format::bgra);
+                                 formats,
+                                 color_space = color_space_,
+                                 tag         = this]() mutable {
+                                    auto converted = images.get();
+
+                                    auto image = blank;
+                                    auto it    = converted.find(output_format::bgra);
+                                    if (it != converted.end()) {
+                                        image = std::move(it->second);
+                                        converted.erase(it);
+                                    }
+
+                                    for (auto format : formats) {
+                                        if (format == output_format::bgra || converted.count(format) > 0 ||
+                                            output_format_size(format, format_desc.width, format_desc.height, depth) ==
+                                                0) {
+                                            continue;
+                                        }
+                                        converted.emplace(format,
+                                                          convert_image(image,
+                                                                        format_desc.width,
+                                                                        format_desc.height,
+                                                                        depth,
+                                                                        format,
+                                                                        color_space));
+                                    }
+
+                                    auto desc = pixel_format_desc(pixel_format::bgra, color_space);
                                     desc.planes.push_back(
                                         pixel_format_desc::plane(format_desc.width, format_desc.height, 4, depth));
                                     std::vector<array<const uint8_t>> image_data;
-                                    image_data.emplace_back(std::move(image.get()));
-                                    return const_frame(tag, std::move(image_data), std::move(audio), desc);
+                                    image_data.emplace_back(std::move(image));
+                                    return const_frame(tag,
+                                                       std::move(image_data),
+                                                       std::move(audio),
+                                                       desc,
+                                                       std::move(converted),
+                                                       format_desc.audio_channels);
                                 }));
 
-        if (buffer_.size() <= format_desc.field_count) {
-            return const_frame{};
+        const auto queue_capacity = static_cast<std::size_t>(format_desc.field_count * (readback_depth_ - 1));
+
+        const_frame frame;
+        if (buffer_.size() > queue_capacity) {
+            frame = std::move(buffer_.front().get());
+            buffer_.pop();
         }
 
-        auto frame = std::move(buffer_.front().get());
-        buffer_.pop();
+        // The frames which are still being rendered and read back, ahead of the one which is handed to the consumers.
+        graph_->set_value("mix-queue",
+                          queue_capacity > 0 ? static_cast<double>(buffer_.size()) / static_cast<double>(queue_capacity)
+                                             : 0.0);
+
         return frame;
     }
 
     void set_master_volume(float volume) { audio_mixer_.set_master_volume(volume); }
 
     float get_master_volume() { return audio_mixer_.get_master_volume(); }
+
+    void set_audio_gain_ramp(audio_gain_ramp ramp) { audio_mixer_.set_gain_ramp(ramp); }
 };
 
-mixer::mixer(int channel_index, spl::shared_ptr<diagnostics::graph> graph, spl::shared_ptr<image_mixer> image_mixer)
-    : impl_(new impl(channel_index, std::move(graph), std::move(image_mixer)))
+mixer::mixer(int                                 channel_index,
+             spl::shared_ptr<diagnostics::graph> graph,
+             spl::shared_ptr<image_mixer>        image_mixer,
+             core::color_space                   color_space,
+             int                                 readback_depth)
+    : impl_(new impl(channel_index, std::move(graph), std::move(image_mixer), color_space, readback_depth))
 {
 }
 void        mixer::set_master_volume(float volume) { impl_->set_master_volume(volume); }
 float       mixer::get_master_volume() { return impl_->get_master_volume(); }
-const_frame mixer::operator()(std::vector<draw_frame> frames, const video_format_desc& format_desc, int nb_samples)
+void        mixer::set_audio_gain_ramp(audio_gain_ramp ramp) { impl_->set_audio_gain_ramp(ramp); }
+const_frame mixer::operator()(std::vector<draw_frame>           frames,
+                              const video_format_desc&          format_desc,
+                              int                               nb_samples,
+                              const std::vector<output_format>& formats)
 {
-    return (*impl_)(std::move(frames), format_desc, nb_samples);
+    return (*impl_)(std::move(frames), format_desc, nb_samples, formats);
 }
 mutable_frame mixer::create_frame(const void* tag, const pixel_format_desc& desc)
 {
@@ -24,7 +24,9 @@
 #include <common/bit_depth.hpp>
 #include <common/memory.h>
 
+#include <core/frame/output_format.h>
 #include <core/fwd.h>
+#include <core/mixer/audio/audio_mixer.h>
 #include <core/monitor/monitor.h>
 
 namespace caspar::diagnostics {
@@ -41,12 +43,20 @@ class mixer final
   public:
     explicit mixer(int                                         channel_index,
                    spl::shared_ptr<caspar::diagnostics::graph> graph,
-                   spl::shared_ptr<image_mixer>                image_mixer);
+                   spl::shared_ptr<image_mixer>                image_mixer,
+                   color_space                                 color_space    = color_space::bt709,
+                   int                                         readback_depth = 2);
 
-    const_frame operator()(std::vector<draw_frame> frames, const video_format_desc& format_desc, int nb_samples);
+    // Mixes frames, converting the image to each of formats. See const_frame::converted_image_data. The frame mixed
+    // readback_depth - 1 ticks ago is returned, so that the GPU has that long to read it back.
+    const_frame operator()(std::vector<draw_frame>           frames,
+                           const video_format_desc&          format_desc,
+                           int                               nb_samples,
+                           const std::vector<output_format>& formats = {output_format::bgra});
 
     void  set_master_volume(float volume);
     float get_master_volume();
+    void  set_audio_gain_ramp(audio_gain_ramp ramp);
 
     mutable_frame create_frame(const void* tag, const pixel_format_desc& desc);
 
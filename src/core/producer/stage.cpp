@@ -30,12 +30,15 @@
 #include <common/diagnostics/graph.h>
 #include <common/executor.h>
 #include <common/future.h>
+#include <common/timer.h>
 
 #include <core/frame/frame_transform.h>
 #include <core/producer/route/route_producer.h>
 
 #include <boost/range/adaptors.hpp>
 
+#include <tbb/parallel_for.h>
+
 #include <functional>
 #include <future>
 #include <map>
@@ -58,7 +61,50 @@ struct stage::impl : public std::enable_shared_from_this<impl>
     executor   executor_{L"stage " + std::to_wstring(channel_index_)};
     std::mutex lock_;
 
+    const bool parallel_produce_;
+
   private:
+    struct pending_layer
+    {
+        int             index;
+        bool            produce;
+        bool            fetch_background;
+        layer*          source_layer;
+        frame_transform transform;
+        layer_frame     frame;
+        double          produce_time;
+    };
+
+    static void produce_layer(pending_layer& pending, video_field field1, bool is_interlaced, int nb_samples)
+    {
+        caspar::timer produce_timer;
+
+        auto& layer = *pending.source_layer;
+
+        layer_frame res = {};
+        if (pending.produce) {
+            res.foreground1 = draw_frame::push(layer.receive(field1, nb_samples), pending.transform);
+            res.foreground1.transform().image_transform.enable_geometry_modifiers = true;
+        }
+
+        res.has_background = layer.has_background();
+        if (pending.fetch_background)
+            res.background1 = layer.receive_background(field1, nb_samples);
+
+        if (is_interlaced) {
+            res.is_interlaced = true;
+            if (pending.produce) {
+                res.foreground2 = draw_frame::push(layer.receive(video_field::b, nb_samples), pending.transform);
+                res.foreground2.transform().image_transform.enable_geometry_modifiers = true;
+            }
+            if (pending.fetch_background)
+                res.background2 = layer.receive_background(video_field::b, nb_samples);
+        }
+
+        pending.frame        = std::move(res);
+        pending.produce_time = produce_timer.elapsed();
+    }
+
     void orderSourceLayers(std::vector<std::pair<int, bool>>&        layerVec,
                            const std::map<int, std::pair<int, int>>& routed_layers,
                            int                                       l,
@@ -109,11 +155,16 @@ struct stage::impl : public std::enable_shared_from_this<impl>
     }
 
   public:
-    impl(int channel_index, spl::shared_ptr<diagnostics::graph> graph, const core::video_format_desc& format_desc)
+    impl(int                                 channel_index,
+         spl::shared_ptr<diagnostics::graph> graph,
+         const core::video_format_desc&      format_desc,
+         bool                                parallel_produce)
         : channel_index_(channel_index)
         , graph_(std::move(graph))
         , format_desc_(format_desc)
+        , parallel_produce_(parallel_produce)
     {
+        graph_->set_color("layer-produce-time", caspar::diagnostics::color(0.0f, 0.6f, 0.3f, 0.8f));
     }
 
     const stage_frames operator()(uint64_t                                     frame_number,
@@ -161,42 +212,61 @@ struct stage::impl : public std::enable_shared_from_this<impl>
                 // This will risk some stutter for freshly created producers, but it lets us tick at 25hz and avoids
                 // amcp changes starting on the second field
 
+                // Group the layers into waves, where a same-channel route is placed after the wave of its source.
+                // Layers within a wave do not depend on each other and can be produced concurrently.
+                std::vector<std::vector<pending_layer>> waves;
+                std::map<int, size_t>                   layer_waves;
                 for (auto& l : layerVec) {
                     auto p = layers_.find(l.first);
                     if (p == layers_.end())
                         continue;
 
-                    auto& layer = p->second;
-                    auto& tween = tweens_[p->first];
+                    size_t wave = 0;
+                    if (parallel_produce_) {
+                        auto routeIt = routed_layers.find(l.first);
+                        if (routeIt != routed_layers.end() && routeIt->second.first == channel_index_) {
+                            auto src = layer_waves.find(routeIt->second.second);
+                            if (src != layer_waves.end())
+                                wave = src->second + 1;
+                        }
+                    } else {
+                        wave = waves.size();
+                    }
+                    layer_waves[l.first] = wave;
 
                     auto has_background_route =
                         std::find(fetch_background.begin(), fetch_background.end(), p->first) != fetch_background.end();
 
-                    layer_frame res = {};
-                    if (l.second) {
-                        res.foreground1 = draw_frame::push(layer.receive(field1, result.nb_samples), tween.fetch());
-                        res.foreground1.transform().image_transform.enable_geometry_modifiers = true;
-                    }
+                    pending_layer pending    = {};
+                    pending.index            = p->first;
+                    pending.produce          = l.second;
+                    pending.fetch_background = has_background_route;
+                    pending.source_layer     = &p->second;
+                    pending.transform        = tweens_[p->first].fetch();
 
-                    res.has_background = layer.has_background();
-                    if (has_background_route)
-                        res.background1 = layer.receive_background(field1, result.nb_samples);
+                    if (waves.size() <= wave)
+                        waves.resize(wave + 1);
+                    waves[wave].push_back(std::move(pending));
+                }
 
-                    if (is_interlaced) {
-                        res.is_interlaced = true;
-                        if (l.second) {
-                            res.foreground2 =
-                                draw_frame::push(layer.receive(video_field::b, result.nb_samples), tween.fetch());
-                            res.foreground2.transform().image_transform.enable_geometry_modifiers = true;
-                        }
-                        if (has_background_route)
-                            res.background2 = layer.receive_background(video_field::b, result.nb_samples);
+                std::map<int, double> produce_times;
+                for (auto& wave : waves) {
+                    if (wave.size() > 1) {
+                        tbb::parallel_for(std::size_t(0), wave.size(), [&](std::size_t n) {
+                            produce_layer(wave[n], field1, is_interlaced, result.nb_samples);
+                        });
+                    } else {
+                        for (auto& pending : wave)
+                            produce_layer(pending, field1, is_interlaced, result.nb_samples);
                     }
 
-                    frames[p->first] = res;
+                    for (auto& pending : wave) {
+                        frames[pending.index]        = pending.frame;
+                        produce_times[pending.index] = pending.produce_time;
 
-                    // push received foreground frame to any configured route producer
-                    routesCb(p->first, res);
+                        // push received foreground frame to any configured route producer
+                        routesCb(pending.index, pending.frame);
+                    }
                 }
 
                 for (auto& p : frames) {
@@ -216,9 +286,18 @@ struct stage::impl : public std::enable_shared_from_this<impl>
                     routesCb(-1, chan_lf);
                 }
 
+                double max_produce_time = 0.0;
+                for (auto& p : produce_times)
+                    max_produce_time = std::max(max_produce_time, p.second);
+                graph_->set_value("layer-produce-time", max_produce_time * result.format_desc.hz * 0.5);
+
                 monitor::state state;
                 for (auto& p : layers_) {
                     state["layer"][p.first] = p.second.state();
+
+                    auto produce_time = produce_times.find(p.first);
+                    if (produce_time != produce_times.end())
+                        state["layer"][p.first]["produce_time"] = produce_time->second;
                 }
                 state_ = std::move(state);
             } catch (...) {
@@ -427,8 +506,11 @@ struct stage::impl : public std::enable_shared_from_this<impl>
     }
 };
 
-stage::stage(int channel_index, spl::shared_ptr<diagnostics::graph> graph, const core::video_format_desc& format_desc)
-    : impl_(new impl(channel_index, std::move(graph), format_desc))
+stage::stage(int                                 channel_index,
+             spl::shared_ptr<diagnostics::graph> graph,
+             const core::video_format_desc&      format_desc,
+             bool                                parallel_produce)
+    : impl_(new impl(channel_index, std::move(graph), format_desc, parallel_produce))
 {
 }
 std::future<std::wstring> stage::call(int index, const std::vector<std::wstring>& params)
@@ -114,7 +114,8 @@ class stage final : public stage_base
   public:
     explicit stage(int                                         channel_index,
                    spl::shared_ptr<caspar::diagnostics::graph> graph,
-                   const core::video_format_desc&              format_desc);
+                   const core::video_format_desc&              format_desc,
+                   bool                                        parallel_produce = false);
 
     const stage_frames operator()(uint64_t                                     frame_number,
                                   std::vector<int>&                            fetch_background,
@@ -41,6 +41,8 @@
 #include <core/diagnostics/call_context.h>
 #include <core/mixer/image/image_mixer.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -77,6 +79,10 @@ struct video_channel::impl final
     std::atomic<bool> abort_request_{false};
     std::thread       thread_;
 
+    // Runs the consume stage when the channel is pipelined, so that the next frame can be produced and mixed while the
+    // consumers are still busy with the previous one.
+    std::unique_ptr<executor> consume_executor_;
+
     std::function<void(int, const layer_frame&)> routesCb = [&](int layer, const layer_frame& layer_frame) {
         std::lock_guard<std::mutex> lock(routes_mutex_);
         for (auto& r : routes_) {
@@ -102,13 +108,16 @@ struct video_channel::impl final
     impl(int                                       index,
          const core::video_format_desc&            format_desc,
          color_space                               default_color_space,
+         bool                                      parallel_produce,
+         int                                       pipeline_depth,
+         int                                       readback_depth,
          std::unique_ptr<image_mixer>              image_mixer,
          std::function<void(core::monitor::state)> tick)
-        : channel_info_(index, image_mixer->depth(), default_color_space)
+        : channel_info_(index, image_mixer->depth(), default_color_space, readback_depth - 1 + pipeline_depth - 1)
         , output_(graph_, format_desc, channel_info_)
         , image_mixer_(std::move(image_mixer))
-        , mixer_(index, graph_, image_mixer_)
-        , stage_(std::make_shared<core::stage>(index, graph_, format_desc))
+        , mixer_(index, graph_, image_mixer_, default_color_space, readback_depth)
+        , stage_(std::make_shared<core::stage>(index, graph_, format_desc, parallel_produce))
         , tick_(std::move(tick))
     {
         graph_->set_color("produce-time", caspar::diagnostics::color(0.0f, 1.0f, 0.0f));
@@ -119,6 +128,13 @@ struct video_channel::impl final
         graph_->set_text(print());
         caspar::diagnostics::register_graph(graph_);
 
+        if (pipeline_depth > 1) {
+            consume_executor_ =
+                std::make_unique<executor>(L"channel-consume-" + std::to_wstring(channel_info_.index));
+            consume_executor_->set_capacity(pipeline_depth - 1);
+            graph_->set_color("consume-queue", caspar::diagnostics::color(0.6f, 0.6f, 0.9f, 0.8f));
+        }
+
         CASPAR_LOG(info) << print() << " Successfully Initialized.";
 
         thread_ = std::thread([&] {
@@ -155,23 +171,39 @@ struct video_channel::impl final
                     graph_->set_value("produce-time", produce_timer.elapsed() * format_desc.hz * 0.5);
 
                     // This is a little race prone, but at worst a new consumer will start with a frame of black
-                    bool has_consumers = output_.consumer_count() > 0;
+                    bool has_consumers  = output_.consumer_count() > 0;
+                    auto output_formats = output_.output_formats();
+                    auto mix            = [&](const std::vector<draw_frame>& frames) {
+                        return mixer_(frames, stage_frames.format_desc, stage_frames.nb_samples, output_formats);
+                    };
 
                     // Mix
                     caspar::timer mix_timer;
-                    auto          mixed_frame =
-                        has_consumers ? mixer_(stage_frames.frames, stage_frames.format_desc, stage_frames.nb_samples)
-                                               : const_frame{};
-                    auto mixed_frame2 =
-                        has_consumers && stage_frames.format_desc.field_count == 2
-                            ? mixer_(stage_frames.frames2, stage_frames.format_desc, stage_frames.nb_samples)
-                            : const_frame{};
+                    auto          mixed_frame = has_consumers ? mix(stage_frames.frames) : const_frame{};
+                    auto          mixed_frame2 =
+                        has_consumers && stage_frames.format_desc.field_count == 2 ? mix(stage_frames.frames2)
+                                                                                   : const_frame{};
                     graph_->set_value("mix-time", mix_timer.elapsed() * format_desc.hz * 0.5);
 
                     // Consume
-                    caspar::timer consume_timer;
-                    output_(mixed_frame, mixed_frame2, stage_frames.format_desc);
-                    graph_->set_value("consume-time", consume_timer.elapsed() * stage_frames.format_desc.hz * 0.5);
+                    if (consume_executor_) {
+                        // Blocks once pipeline_depth frames are in flight, which paces the channel to the consumers
+                        consume_executor_->begin_invoke(
+                            [this, mixed_frame, mixed_frame2, format_desc = stage_frames.format_desc] {
+                                try {
+                                    consume(mixed_frame, mixed_frame2, format_desc);
+                                } catch (...) {
+                                    CASPAR_LOG_CURRENT_EXCEPTION();
+                                }
+                            });
+                        // The queue reports a negative size while the consume thread is waiting for a frame.
+                        const auto queued = std::max<std::ptrdiff_t>(consume_executor_->size(), 0);
+                        graph_->set_value("consume-queue",
+                                          static_cast<double>(queued) /
+                                              static_cast<double>(consume_executor_->capacity()));
+                    } else {
+                        consume(mixed_frame, mixed_frame2, stage_frames.format_desc);
+                    }
 
                     graph_->set_value("frame-time", frame_timer.elapsed() * stage_frames.format_desc.hz * 0.5);
 
@@ -200,6 +232,16 @@ struct video_channel::impl final
         CASPAR_LOG(info) << print() << " Uninitializing.";
         abort_request_ = true;
         thread_.join();
+
+        if (consume_executor_)
+            consume_executor_->stop_and_wait();
+    }
+
+    void consume(const const_frame& frame1, const const_frame& frame2, const core::video_format_desc& format_desc)
+    {
+        caspar::timer consume_timer;
+        output_(frame1, frame2, format_desc);
+        graph_->set_value("consume-time", consume_timer.elapsed() * format_desc.hz * 0.5);
     }
 
     std::shared_ptr<core::route> route(int index = -1, route_mode mode = route_mode::foreground)
@@ -242,9 +284,19 @@ struct video_channel::impl final
 video_channel::video_channel(int                                       index,
                              const core::video_format_desc&            format_desc,
                              color_space                               default_color_space,
+                             bool                                      parallel_produce,
+                             int                                       pipeline_depth,
+                             int                                       readback_depth,
                              std::unique_ptr<image_mixer>              image_mixer,
                              std::function<void(core::monitor::state)> tick)
-    : impl_(new impl(index, format_desc, default_color_space, std::move(image_mixer), std::move(tick)))
+    : impl_(new impl(index,
+                     format_desc,
+                     default_color_space,
+                     parallel_produce,
+                     pipeline_depth,
+                     readback_depth,
+                     std::move(image_mixer),
+                     std::move(tick)))
 {
 }
 video_channel::~video_channel() {}
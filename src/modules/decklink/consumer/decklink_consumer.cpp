@@ -45,6 +45,7 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <algorithm>
 #include <atomic>
 #include <common/prec_timer.h>
 #include <condition_variable>
@@ -1068,6 +1069,7 @@ struct decklink_consumer_proxy : public core::frame_consumer
     const configuration                config_;
     std::unique_ptr<decklink_consumer> consumer_;
     core::video_format_desc            format_desc_;
+    core::color_space                  color_space_ = core::color_space::bt709;
     executor                           executor_;
 
   public:
@@ -1092,6 +1094,7 @@ struct decklink_consumer_proxy : public core::frame_consumer
                     int                            port_index) override
     {
         format_desc_ = format_desc;
+        color_space_ = channel_info.default_color_space;
         executor_.invoke([&] {
             consumer_.reset();
             consumer_ = std::make_unique<decklink_consumer>(config_, format_desc, channel_info.index);
@@ -1115,6 +1118,27 @@ struct decklink_consumer_proxy : public core::frame_consumer
     [[nodiscard]] bool has_synchronization_clock() const override { return true; }
 
     [[nodiscard]] core::monitor::state state() const override { return get_state_for_config(config_, format_desc_); }
+
+    // HDR ports which show the whole channel, in its format and color space, take the v210 image the channel
+    // converts on the GPU. Any other port packs the channel image itself.
+    [[nodiscard]] std::vector<core::output_format> output_formats() const override
+    {
+        if (!config_.hdr) {
+            return {core::output_format::bgra};
+        }
+
+        auto is_direct = [&](const port_configuration& port) {
+            return !port.has_subregion_geometry() && !port.key_only &&
+                   (port.format.format == core::video_format::invalid || port.format.format == format_desc_.format);
+        };
+
+        bool direct = config_.color_space == color_space_ && is_direct(config_.primary) &&
+                      std::all_of(config_.secondaries.begin(), config_.secondaries.end(), is_direct);
+        if (direct) {
+            return {core::output_format::v210};
+        }
+        return {core::output_format::v210, core::output_format::bgra};
+    }
 };
 
 spl::shared_ptr<core::frame_consumer> create_consumer(const std::vector<std::wstring>&     params,
@@ -30,37 +30,14 @@
 
 #include <common/memshfl.h>
 
+#include <core/frame/output_format.h>
+
 #include <tbb/parallel_for.h>
 #include <tbb/scalable_allocator.h>
 
-namespace caspar { namespace decklink {
-
-std::vector<int32_t> create_int_matrix(const std::vector<float>& matrix)
-{
-    static const float LumaRangeWidth   = 876.f * (1024.f / 1023.f);
-    static const float ChromaRangeWidth = 896.f * (1024.f / 1023.f);
-
-    std::vector<float> color_matrix_f(matrix);
-
-    color_matrix_f[0] *= LumaRangeWidth;
-    color_matrix_f[1] *= LumaRangeWidth;
-    color_matrix_f[2] *= LumaRangeWidth;
-
-    color_matrix_f[3] *= ChromaRangeWidth;
-    color_matrix_f[4] *= ChromaRangeWidth;
-    color_matrix_f[5] *= ChromaRangeWidth;
-    color_matrix_f[6] *= ChromaRangeWidth;
-    color_matrix_f[7] *= ChromaRangeWidth;
-    color_matrix_f[8] *= ChromaRangeWidth;
-
-    std::vector<int32_t> int_matrix(color_matrix_f.size());
+#include <cstring>
 
-    transform(color_matrix_f.cbegin(), color_matrix_f.cend(), int_matrix.begin(), [](const float& f) {
-        return (int32_t)round(f * 1024.f);
-    });
-
-    return int_matrix;
-};
+namespace caspar { namespace decklink {
 
 inline void rgb_to_yuv_avx2(__m256i                     pixel_pairs[4],
                             const std::vector<int32_t>& color_matrix,
@@ -206,31 +183,14 @@ class hdr_v210_strategy
     : public format_strategy
     , std::enable_shared_from_this<hdr_v210_strategy>
 {
-    std::vector<float> bt709{0.212639005871510,
-                             0.715168678767756,
-                             0.072192315360734,
-                             -0.114592177555732,
-                             -0.385407822444268,
-                             0.5,
-                             0.5,
-                             -0.454155517037873,
-                             -0.045844482962127};
-    std::vector<float> bt2020{0.262700212011267,
-                              0.677998071518871,
-                              0.059301716469862,
-                              -0.139630430187157,
-                              -0.360369569812843,
-                              0.5,
-                              0.5,
-                              -0.459784529009814,
-                              -0.040215470990186};
-
+    core::color_space    color_space_;
     std::vector<int32_t> color_matrix;
     __m128i              black_batch;
 
   public:
     explicit hdr_v210_strategy(core::color_space color_space)
-        : color_matrix(create_int_matrix(color_space == core::color_space::bt2020 ? bt2020 : bt709))
+        : color_space_(color_space)
+        , color_matrix(core::v210_matrix(color_space))
     {
         // setup black batch (6 pixels of black, encoded as v210)
         ARGBPixel black[6];
@@ -298,6 +258,22 @@ class hdr_v210_strategy
 
         int firstLine = topField ? 0 : 1;
 
+        // The channel converts to v210 on the GPU when asked to, see decklink_consumer_proxy::output_formats. Its rows
+        // are laid out as ours when the port shows the whole channel.
+        const auto& converted       = frame.converted_image_data(core::output_format::v210);
+        size_t      dest_line_bytes = get_row_bytes(decklink_format_desc.width);
+        if (converted && !config.has_subregion_geometry() && channel_format_desc.width == decklink_format_desc.width &&
+            channel_format_desc.height == decklink_format_desc.height &&
+            frame.pixel_format_desc().color_space == color_space_ &&
+            converted.size() >= dest_line_bytes * decklink_format_desc.height) {
+            for (int y = firstLine; y < decklink_format_desc.height; y += decklink_format_desc.field_count) {
+                std::memcpy(reinterpret_cast<uint8_t*>(image_data.get()) + y * dest_line_bytes,
+                            converted.data() + y * dest_line_bytes,
+                            dest_line_bytes);
+            }
+            return;
+        }
+
         if (config.region_w == 0 && config.region_h == 0 && config.dest_x == 0) {
             // Fast path
 
@@ -305,7 +281,6 @@ class hdr_v210_strategy
             int       pixels_to_copy  = std::min(decklink_format_desc.width, channel_format_desc.width - config.src_x);
             const int NUM_THREADS     = 6;
             auto      rows_per_thread = decklink_format_desc.height / NUM_THREADS;
-            size_t    dest_line_bytes = get_row_bytes(decklink_format_desc.width);
             int       fullspeed_x_batches = pixels_to_copy / 48;
             int       rest_x_pixels       = pixels_to_copy - fullspeed_x_batches * 48;
             tbb::parallel_for(0, NUM_THREADS, [&](int thread_index) {
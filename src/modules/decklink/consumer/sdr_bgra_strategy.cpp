@@ -31,6 +31,14 @@
 
 namespace caspar { namespace decklink {
 
+bool is_full_frame(const core::video_format_desc& channel_format_desc,
+                   const core::video_format_desc& decklink_format_desc,
+                   const port_configuration&      config)
+{
+    return channel_format_desc.format == decklink_format_desc.format && config.src_x == 0 && config.src_y == 0 &&
+           config.region_w == 0 && config.region_h == 0 && config.dest_x == 0 && config.dest_y == 0;
+}
+
 std::shared_ptr<void> convert_to_key_only(const std::shared_ptr<void>& image_data, std::size_t byte_count)
 {
     auto key_data = create_aligned_buffer(byte_count);
@@ -62,6 +70,20 @@ class sdr_bgra_strategy
                                                  const core::const_frame&       frame2,
                                                  BMDFieldDominance              field_dominance) override
     {
+        // A progressive frame which covers the whole output can be scheduled straight from the mixer's readback
+        // buffer.
+        if (field_dominance == bmdProgressiveFrame && frame1 &&
+            is_full_frame(channel_format_desc, decklink_format_desc, config)) {
+            auto& data = frame1.image_data(0);
+            if (data.size() >= decklink_format_desc.size && reinterpret_cast<std::uintptr_t>(data.data()) % 64 == 0) {
+                auto shared = std::const_pointer_cast<std::uint8_t>(frame1.share_image_data(0));
+                if (config.key_only) {
+                    return convert_to_key_only(shared, decklink_format_desc.size);
+                }
+                return shared;
+            }
+        }
+
         std::shared_ptr<void> image_data = allocate_frame_data(decklink_format_desc);
 
         if (field_dominance != bmdProgressiveFrame) {
@@ -104,8 +126,7 @@ class sdr_bgra_strategy
 
         int firstLine = topField ? 0 : 1;
 
-        if (channel_format_desc.format == decklink_format_desc.format && config.src_x == 0 && config.src_y == 0 &&
-            config.region_w == 0 && config.region_h == 0 && config.dest_x == 0 && config.dest_y == 0) {
+        if (is_full_frame(channel_format_desc, decklink_format_desc, config)) {
             // Fast path
 
             size_t byte_count_line = (size_t)decklink_format_desc.width * 4;
@@ -0,0 +1,313 @@
+#include "av_cue_cache.h"
+
+#include <common/env.h>
+#include <common/log.h>
+#include <common/param.h>
+#include <common/utf.h>
+
+#include <core/frame/geometry.h>
+#include <core/frame/pixel_format.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <functional>
+#include <iomanip>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+
+namespace caspar { namespace ffmpeg {
+
+namespace {
+
+const std::uint32_t index_magic   = 0x494b4343; // "CCKI"
+const std::uint32_t index_version = 1;
+
+boost::filesystem::path index_folder()
+{
+    static const auto folder = [] {
+        auto path = env::properties().get(L"configuration.ffmpeg.producer.cue-cache.index-path", L"");
+        return path.empty() ? boost::filesystem::temp_directory_path() / L"casparcg-cue-cache"
+                            : boost::filesystem::path(path);
+    }();
+    return folder;
+}
+
+boost::filesystem::path index_file(const std::string& path)
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>()(path) << ".idx";
+    return index_folder() / name.str();
+}
+
+template <typename T>
+void write(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read(std::istream& stream, T& value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+std::size_t frame_size(const core::const_frame& frame)
+{
+    std::size_t size = frame.audio_data().size() * sizeof(std::int32_t);
+    for (std::size_t n = 0; n < frame.pixel_format_desc().planes.size(); ++n) {
+        size += frame.image_data(n).size();
+    }
+    return size;
+}
+
+// Copies a frame's image and audio into host memory. Frames made by a frame factory may be held in its upload buffers
+// and carry uploaded textures, which a cached frame would keep from the factory's pools.
+core::const_frame host_frame(const core::const_frame& frame)
+{
+    std::vector<array<std::uint8_t>> image_data;
+    for (std::size_t n = 0; n < frame.pixel_format_desc().planes.size(); ++n) {
+        auto& plane = frame.image_data(n);
+        image_data.emplace_back(std::vector<std::uint8_t>(plane.begin(), plane.end()));
+    }
+
+    auto& audio = frame.audio_data();
+    auto  host  = core::mutable_frame(frame.stream_tag(),
+                                     std::move(image_data),
+                                     array<std::int32_t>(std::vector<std::int32_t>(audio.begin(), audio.end())),
+                                     frame.pixel_format_desc());
+    host.audio_channels() = frame.audio_channels();
+    host.geometry()       = frame.geometry();
+    return core::const_frame(std::move(host));
+}
+
+struct cue_cache
+{
+    struct entry
+    {
+        CueKey                                        key;
+        std::shared_ptr<const std::vector<CuedFrame>> frames;
+        std::size_t                                   size;
+    };
+
+    std::mutex                                   mutex;
+    std::list<entry>                             entries; // Most recently used first.
+    std::map<CueKey, std::list<entry>::iterator> index;
+    std::size_t                                  size = 0;
+    const std::size_t                            max_size =
+        env::properties().get<std::size_t>(L"configuration.ffmpeg.producer.cue-cache.max-size", 512) << 20;
+
+    void erase(std::list<entry>::iterator it)
+    {
+        size -= it->size;
+        index.erase(it->key);
+        entries.erase(it);
+    }
+};
+
+cue_cache& get_cue_cache()
+{
+    static cue_cache cache;
+    return cache;
+}
+
+} // namespace
+
+std::optional<std::time_t> file_write_time(const std::string& path)
+{
+    if (!caspar::protocol_split(u16(path)).first.empty()) {
+        return {};
+    }
+
+    boost::system::error_code ec;
+    auto                      time = boost::filesystem::last_write_time(boost::filesystem::path(u16(path)), ec);
+    if (ec) {
+        return {};
+    }
+    return time;
+}
+
+KeyframeIndex::KeyframeIndex(std::string path)
+    : path_(std::move(path))
+    , write_time_(file_write_time(path_))
+{
+    if (!write_time_) {
+        return;
+    }
+
+    boost::filesystem::ifstream stream(index_file(path_), std::ios::binary);
+    if (!stream) {
+        return;
+    }
+
+    std::uint32_t magic   = 0;
+    std::uint32_t version = 0;
+    std::uint64_t length  = 0;
+    if (!read(stream, magic) || magic != index_magic || !read(stream, version) || version != index_version ||
+        !read(stream, length) || length > 4096) {
+        return;
+    }
+
+    std::string   stored_path(length, '\0');
+    std::int64_t  write_time = 0;
+    std::uint64_t count      = 0;
+    if (!stream.read(&stored_path[0], length) || stored_path != path_ || !read(stream, write_time) ||
+        write_time != static_cast<std::int64_t>(*write_time_) || !read(stream, count)) {
+        return;
+    }
+
+    std::map<int64_t, int64_t> entries;
+    for (std::uint64_t n = 0; n < count; ++n) {
+        int64_t time = 0;
+        int64_t pos  = 0;
+        if (!read(stream, time) || !read(stream, pos)) {
+            return;
+        }
+        entries.emplace(time, pos);
+    }
+
+    entries_  = std::move(entries);
+    complete_ = true;
+}
+
+std::optional<int64_t> KeyframeIndex::find(int64_t time) const
+{
+    if (!complete_) {
+        return {};
+    }
+
+    auto it = entries_.upper_bound(time);
+    if (it == entries_.begin()) {
+        return {};
+    }
+    return std::prev(it)->second;
+}
+
+std::optional<int64_t> KeyframeIndex::next(int64_t time) const
+{
+    if (!complete_) {
+        return {};
+    }
+
+    auto it = entries_.lower_bound(time);
+    if (it == entries_.end()) {
+        return {};
+    }
+    return it->first;
+}
+
+std::optional<int64_t> KeyframeIndex::prev(int64_t time) const
+{
+    if (!complete_) {
+        return {};
+    }
+
+    auto it = entries_.upper_bound(time);
+    if (it == entries_.begin()) {
+        return {};
+    }
+    return std::prev(it)->first;
+}
+
+void KeyframeIndex::add(int64_t time, int64_t pos) { entries_.emplace(time, pos); }
+
+void KeyframeIndex::store()
+{
+    if (complete_ || !write_time_ || entries_.empty()) {
+        return;
+    }
+    complete_ = true;
+
+    try {
+        boost::filesystem::create_directories(index_folder());
+
+        boost::filesystem::ofstream stream(index_file(path_), std::ios::binary | std::ios::trunc);
+        write(stream, index_magic);
+        write(stream, index_version);
+        write(stream, static_cast<std::uint64_t>(path_.size()));
+        stream.write(path_.data(), path_.size());
+        write(stream, static_cast<std::int64_t>(*write_time_));
+        write(stream, static_cast<std::uint64_t>(entries_.size()));
+        for (auto& entry : entries_) {
+            write(stream, entry.first);
+            write(stream, entry.second);
+        }
+    } catch (...) {
+        CASPAR_LOG_CURRENT_EXCEPTION();
+    }
+}
+
+bool CueKey::operator<(const CueKey& other) const
+{
+    return std::tie(path, write_time, vfilter, afilter, format, scale_mode, time) <
+           std::tie(other.path,
+                    other.write_time,
+                    other.vfilter,
+                    other.afilter,
+                    other.format,
+                    other.scale_mode,
+                    other.time);
+}
+
+std::size_t cue_frame_count()
+{
+    static const auto count =
+        get_cue_cache().max_size > 0
+            ? env::properties().get<std::size_t>(L"configuration.ffmpeg.producer.cue-cache.frames", 8)
+            : 0;
+    return count;
+}
+
+std::shared_ptr<const std::vector<CuedFrame>> find_cue(const CueKey& key)
+{
+    auto&                       cache = get_cue_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto it = cache.index.find(key);
+    if (it == cache.index.end()) {
+        return nullptr;
+    }
+
+    cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+    return it->second->frames;
+}
+
+void store_cue(const CueKey& key, std::vector<CuedFrame> frames)
+{
+    auto& cache = get_cue_cache();
+
+    std::size_t size = 0;
+    for (auto& frame : frames) {
+        size += frame_size(frame.frame);
+    }
+
+    if (frames.empty() || size > cache.max_size) {
+        return;
+    }
+
+    for (auto& frame : frames) {
+        frame.frame = host_frame(frame.frame);
+    }
+
+    auto value = std::make_shared<const std::vector<CuedFrame>>(std::move(frames));
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+        cache.erase(it->second);
+    }
+
+    while (!cache.entries.empty() && cache.size + size > cache.max_size) {
+        cache.erase(std::prev(cache.entries.end()));
+    }
+
+    cache.entries.push_front(cue_cache::entry{key, std::move(value), size});
+    cache.index[key] = cache.entries.begin();
+    cache.size += size;
+}
+
+}} // namespace caspar::ffmpeg
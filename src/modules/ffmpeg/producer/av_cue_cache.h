@@ -0,0 +1,84 @@
+#pragma once
+
+#include <core/frame/frame.h>
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace caspar { namespace ffmpeg {
+
+// Returns the modification time of a local file, or nothing for anything else, such as a stream or a device.
+std::optional<std::time_t> file_write_time(const std::string& path);
+
+// Keyframe positions of a local file's video stream. They are persisted in the cue cache folder, keyed by the file's
+// path and modification time, once the file has been read from start to end. Seeking can then go straight to the byte
+// position of the keyframe before the target, rather than having the demuxer search for it.
+class KeyframeIndex
+{
+  public:
+    explicit KeyframeIndex(std::string path);
+
+    // Whether the index holds every keyframe of the file.
+    bool complete() const { return complete_; }
+
+    // Returns the byte position of the last keyframe at or before time, in AV_TIME_BASE units.
+    std::optional<int64_t> find(int64_t time) const;
+
+    // Returns the time of the first keyframe at or after time, in AV_TIME_BASE units.
+    std::optional<int64_t> next(int64_t time) const;
+
+    // Returns the time of the last keyframe at or before time, in AV_TIME_BASE units.
+    std::optional<int64_t> prev(int64_t time) const;
+
+    void add(int64_t time, int64_t pos);
+
+    // Persists the index, which now holds every keyframe of the file.
+    void store();
+
+  private:
+    std::string                path_;
+    std::optional<std::time_t> write_time_;
+    std::map<int64_t, int64_t> entries_;
+    bool                       complete_ = false;
+};
+
+// A frame decoded from a cue point, with its timing, see AVProducer.
+struct CuedFrame
+{
+    core::const_frame frame;
+    int64_t           start_time;
+    int64_t           pts;
+    int64_t           duration;
+};
+
+// Identifies the frames decoded from a position of a clip. Frames differ with the filters, the channel format and the
+// scale mode they were decoded for.
+struct CueKey
+{
+    std::string  path;
+    std::time_t  write_time;
+    std::string  vfilter;
+    std::string  afilter;
+    std::wstring format;
+    int          scale_mode;
+    int64_t      time;
+
+    bool operator<(const CueKey& other) const;
+};
+
+// The number of frames kept from each cue point, see <ffmpeg><producer><cue-cache>. 0 disables the cue cache.
+std::size_t cue_frame_count();
+
+// Returns the first frames decoded from a cue point of a recently loaded clip, or nullptr.
+std::shared_ptr<const std::vector<CuedFrame>> find_cue(const CueKey& key);
+
+// Keeps copies of frames in host memory for find_cue, evicting the least recently used cue points beyond the memory
+// limit.
+void store_cue(const CueKey& key, std::vector<CuedFrame> frames);
+
+}} // namespace caspar::ffmpeg
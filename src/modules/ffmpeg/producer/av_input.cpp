@@ -11,6 +11,8 @@
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <set>
 
 #ifdef _MSC_VER
@@ -35,6 +37,14 @@ Input::Input(const std::string& filename, std::shared_ptr<diagnostics::graph> gr
     graph_->set_color("input", diagnostics::color(0.7f, 0.4f, 0.4f));
 
     buffer_.set_capacity(256);
+
+    auto protocol = caspar::protocol_split(u16(filename_)).first;
+    if (protocol.empty() || protocol == L"file") {
+        index_.emplace(filename_);
+        task_.emplace([this] { read(); }, priority_);
+        return;
+    }
+
     thread_ = boost::thread([&] {
         try {
             set_thread_name(L"[ffmpeg::av_producer::Input]");
@@ -76,15 +86,68 @@ Input::Input(const std::string& filename, std::shared_ptr<diagnostics::graph> gr
 
 Input::~Input()
 {
-    graph_         = spl::shared_ptr<diagnostics::graph>();
     abort_request_ = true;
+    task_.reset();
+
+    graph_ = spl::shared_ptr<diagnostics::graph>();
     ic_cond_.notify_all();
 
     std::shared_ptr<AVPacket> packet;
     while (buffer_.try_pop(packet))
         ;
 
-    thread_.join();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Input::read()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Stop at a full buffer, and resume once try_pop has made room for a batch of packets.
+    while (!abort_request_ && buffer_.size() < buffer_.capacity()) {
+        auto packet = alloc_packet();
+
+        {
+            std::unique_lock<std::mutex> lock(ic_mutex_);
+
+            if (!ic_ || eof_) {
+                break;
+            }
+
+            auto ret = av_read_frame(ic_.get(), packet.get());
+
+            if (ret == AVERROR_EXIT) {
+                break;
+            } else if (ret == AVERROR(EAGAIN)) {
+                task_->schedule();
+                break;
+            } else if (ret == AVERROR_EOF) {
+                eof_   = true;
+                packet = nullptr;
+
+                if (indexing_) {
+                    index_->store();
+                    indexing_ = false;
+                }
+            } else {
+                FF_RET(ret, "av_read_frame");
+
+                if (indexing_ && packet->stream_index == index_stream_ && (packet->flags & AV_PKT_FLAG_KEY) &&
+                    packet->pts != AV_NOPTS_VALUE && packet->pos >= 0) {
+                    auto time_base = ic_->streams[packet->stream_index]->time_base;
+                    index_->add(av_rescale_q(packet->pts, time_base, {1, AV_TIME_BASE}), packet->pos);
+                }
+            }
+        }
+
+        buffer_.push(std::move(packet));
+        graph_->set_value("input", (static_cast<double>(buffer_.size()) / buffer_.capacity()));
+    }
+
+    read_time_us_ +=
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
 }
 
 int Input::interrupt_cb(void* ctx)
@@ -97,9 +160,19 @@ bool Input::try_pop(std::shared_ptr<AVPacket>& packet)
 {
     auto result = buffer_.try_pop(packet);
     graph_->set_value("input", (static_cast<double>(buffer_.size()) / buffer_.capacity()));
+    if (result && task_ && buffer_.size() < buffer_.capacity() / 2) {
+        task_->schedule();
+    }
     return result;
 }
 
+void                         Input::priority(Priority priority) { priority_ = priority; }
+const std::atomic<Priority>& Input::priority() const { return priority_; }
+
+std::size_t Input::size() const { return static_cast<std::size_t>(std::max<std::ptrdiff_t>(buffer_.size(), 0)); }
+
+double Input::take_read_time() { return static_cast<double>(read_time_us_.exchange(0)) / 1000000.0; }
+
 AVFormatContext*       Input::operator->() { return ic_.get(); }
 AVFormatContext* const Input::operator->() const { return ic_.get(); }
 
@@ -115,8 +188,14 @@ void Input::abort()
 
 void Input::reset()
 {
-    std::unique_lock<std::mutex> lock(ic_mutex_);
-    internal_reset();
+    {
+        std::unique_lock<std::mutex> lock(ic_mutex_);
+        internal_reset();
+    }
+
+    if (task_) {
+        task_->schedule();
+    }
 }
 
 void Input::internal_reset()
@@ -169,6 +248,10 @@ void Input::internal_reset()
     FF(avformat_find_stream_info(ic2.get(), nullptr));
     ic_ = std::move(ic2);
     ic_cond_.notify_all();
+
+    // Reading starts from the beginning of the file, so its keyframes can be indexed until it is seeked.
+    index_stream_ = av_find_best_stream(ic_.get(), AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    indexing_     = index_ && !index_->complete() && index_stream_ >= 0;
 }
 
 bool Input::eof() const { return eof_; }
@@ -178,7 +261,15 @@ void Input::seek(int64_t ts, bool flush)
     std::unique_lock<std::mutex> lock(ic_mutex_);
 
     if (ic_ && ts != ic_->start_time && ts != AV_NOPTS_VALUE) {
-        FF(avformat_seek_file(ic_.get(), -1, INT64_MIN, ts, ts, 0));
+        // Go straight to the keyframe before ts, when the file has been indexed, rather than having the demuxer search
+        // for it. The frames before ts are dropped by the filters, as after any seek.
+        auto pos = index_ && !(ic_->iformat->flags & AVFMT_NO_BYTE_SEEK) ? index_->find(ts) : std::nullopt;
+        if (pos) {
+            FF(avformat_seek_file(ic_.get(), -1, INT64_MIN, *pos, *pos, AVSEEK_FLAG_BYTE));
+        } else {
+            FF(avformat_seek_file(ic_.get(), -1, INT64_MIN, ts, ts, 0));
+        }
+        indexing_ = false;
     } else {
         internal_reset();
     }
@@ -191,6 +282,22 @@ void Input::seek(int64_t ts, bool flush)
     eof_ = false;
 
     graph_->set_tag(diagnostics::tag_severity::INFO, "seek");
+
+    if (task_) {
+        task_->schedule();
+    }
+}
+
+std::optional<int64_t> Input::next_keyframe(int64_t ts) const
+{
+    std::unique_lock<std::mutex> lock(ic_mutex_);
+    return index_ ? index_->next(ts) : std::nullopt;
+}
+
+std::optional<int64_t> Input::prev_keyframe(int64_t ts) const
+{
+    std::unique_lock<std::mutex> lock(ic_mutex_);
+    return index_ ? index_->prev(ts) : std::nullopt;
 }
 
 }} // namespace caspar::ffmpeg
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "av_cue_cache.h"
+#include "av_worker_pool.h"
+
 #include <common/diagnostics/graph.h>
 
 #include <atomic>
@@ -31,6 +34,15 @@ class Input
 
     bool try_pop(std::shared_ptr<AVPacket>& packet);
 
+    // The priority of the producer's work on the shared worker pool, see ffmpeg::Priority.
+    void                         priority(Priority priority);
+    const std::atomic<Priority>& priority() const;
+
+    std::size_t size() const;
+
+    // Returns the time, in seconds, spent reading packets since the last call.
+    double take_read_time();
+
     AVFormatContext* operator->();
 
     AVFormatContext* const operator->() const;
@@ -40,8 +52,15 @@ class Input
     bool eof() const;
     void seek(int64_t ts, bool flush = true);
 
+    // Returns the time of the first keyframe at or after ts, once the file has been indexed, see KeyframeIndex.
+    std::optional<int64_t> next_keyframe(int64_t ts) const;
+
+    // Returns the time of the last keyframe at or before ts, once the file has been indexed, see KeyframeIndex.
+    std::optional<int64_t> prev_keyframe(int64_t ts) const;
+
   private:
     void internal_reset();
+    void read();
 
     std::optional<bool> seekable_;
 
@@ -56,8 +75,19 @@ class Input
 
     std::atomic<bool> eof_{false};
 
-    std::atomic<bool> abort_request_{false};
-    boost::thread     thread_;
+    // Built while a local file is read from its start, see KeyframeIndex. Guarded by ic_mutex_.
+    std::optional<KeyframeIndex> index_;
+    bool                         indexing_     = false;
+    int                          index_stream_ = -1;
+
+    std::atomic<bool>         abort_request_{false};
+    std::atomic<Priority>     priority_{Priority::background};
+    std::atomic<std::int64_t> read_time_us_{0};
+
+    // Local files are read on the shared worker pool. Other inputs, such as network streams and capture devices, block
+    // until data arrives and keep a thread of their own.
+    std::optional<Task> task_;
+    boost::thread       thread_;
 };
 
 }} // namespace caspar::ffmpeg
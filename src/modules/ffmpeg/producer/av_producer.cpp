@@ -1,6 +1,8 @@
 #include "av_producer.h"
 
+#include "av_cue_cache.h"
 #include "av_input.h"
+#include "av_worker_pool.h"
 
 #include "../util/av_assert.h"
 #include "../util/av_util.h"
@@ -17,7 +19,6 @@
 #include <common/diagnostics/graph.h>
 #include <common/env.h>
 #include <common/except.h>
-#include <common/executor.h>
 #include <common/os/thread.h>
 #include <common/scope_exit.h>
 #include <common/timer.h>
@@ -47,11 +48,16 @@ extern "C" {
 #pragma warning(pop)
 #endif
 
+#include <tbb/parallel_invoke.h>
+
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <deque>
 #include <iomanip>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <sstream>
 #include <string>
@@ -107,22 +113,20 @@ class Decoder
 
     std::queue<std::shared_ptr<AVPacket>> input;
     mutable boost::mutex                  input_mutex;
-    boost::condition_variable             input_cond;
     int                                   input_capacity = 2;
 
     std::queue<std::shared_ptr<AVFrame>> output;
     mutable boost::mutex                 output_mutex;
-    boost::condition_variable            output_cond;
     int                                  output_capacity = 8;
 
-    boost::thread thread;
+    std::atomic<std::int64_t> decode_time_us{0};
 
   public:
     std::shared_ptr<AVCodecContext> ctx;
 
     Decoder() = default;
 
-    explicit Decoder(AVStream* stream)
+    Decoder(AVStream* stream, const std::atomic<Priority>& priority, core::frame_factory& frame_factory)
         : st(stream)
     {
         const auto codec = avcodec_find_decoder(stream->codecpar->codec_id);
@@ -147,6 +151,9 @@ class Decoder
         if (ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
             ctx->framerate           = av_guess_frame_rate(nullptr, stream, nullptr);
             ctx->sample_aspect_ratio = av_guess_sample_aspect_ratio(nullptr, stream, nullptr);
+
+            // Decode intra only codecs into the buffers frames are uploaded from, rather than copying frames into them.
+            set_frame_buffers(ctx.get(), frame_factory);
         } else if (ctx->codec_type == AVMEDIA_TYPE_AUDIO) {
 #if !(FFMPEG_NEW_CHANNEL_LAYOUT)
             if (!ctx->channel_layout && ctx->channels) {
@@ -164,109 +171,7 @@ class Decoder
 
         FF(avcodec_open2(ctx.get(), codec, nullptr));
 
-        thread = boost::thread([&]() {
-            try {
-                while (!thread.interruption_requested()) {
-                    auto av_frame = alloc_frame();
-                    auto ret      = avcodec_receive_frame(ctx.get(), av_frame.get());
-
-                    if (ret == AVERROR(EAGAIN)) {
-                        std::shared_ptr<AVPacket> packet;
-                        {
-                            boost::unique_lock<boost::mutex> lock(input_mutex);
-                            input_cond.wait(lock, [&]() { return !input.empty(); });
-                            packet = std::move(input.front());
-                            input.pop();
-                        }
-                        FF(avcodec_send_packet(ctx.get(), packet.get()));
-                    } else if (ret == AVERROR_EOF) {
-                        avcodec_flush_buffers(ctx.get());
-                        av_frame->pts = next_pts;
-                        next_pts      = AV_NOPTS_VALUE;
-                        eof           = true;
-
-                        {
-                            boost::unique_lock<boost::mutex> lock(output_mutex);
-                            output_cond.wait(lock, [&]() { return output.size() < output_capacity; });
-                            output.push(std::move(av_frame));
-                        }
-                    } else {
-                        FF_RET(ret, "avcodec_receive_frame");
-
-                        // TODO: Maybe Fixed in:
-                        // https://github.com/FFmpeg/FFmpeg/commit/33203a08e0a26598cb103508327a1dc184b27bc6
-                        // NOTE This is a workaround for DVCPRO HD.
-#if LIBAVCODEC_VERSION_MAJOR < 61
-                        if (av_frame->width > 1024 && av_frame->interlaced_frame) {
-                            av_frame->top_field_first = 1;
-                        }
-#else
-                        if (av_frame->width > 1024 && (av_frame->flags & AV_FRAME_FLAG_INTERLACED)) {
-                            av_frame->flags |= AV_FRAME_FLAG_TOP_FIELD_FIRST;
-                        }
-#endif
-
-                        // TODO (fix) is this always best?
-                        av_frame->pts = av_frame->best_effort_timestamp;
-
-#if LIBAVUTIL_VERSION_MAJOR < 58
-                        auto duration_pts = av_frame->pkt_duration;
-#else
-                        auto duration_pts = av_frame->duration;
-#endif
-                        if (duration_pts <= 0) {
-                            if (ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
-#if LIBAVCODEC_VERSION_MAJOR < 62
-                                const int ticks_per_frame = ctx->ticks_per_frame;
-#else
-                                // https://github.com/FFmpeg/FFmpeg/commit/e930b834a928546f9cbc937f6633709053448232#diff-115616f8a2b59cab3aac4e7f4c8c31e69e94e7fcfa339b9f65b0bf34308aa80fR682
-                                const int ticks_per_frame =
-                                    (ctx->codec_descriptor && (ctx->codec_descriptor->props & AV_CODEC_PROP_FIELDS))
-                                        ? 2
-                                        : 1;
-#endif
-                                const auto ticks = av_stream_get_parser(st) ? av_stream_get_parser(st)->repeat_pict + 1
-                                                                            : ticks_per_frame;
-                                duration_pts     = static_cast<int64_t>(AV_TIME_BASE) * ctx->framerate.den * ticks /
-                                               ctx->framerate.num / ticks_per_frame;
-                                duration_pts = av_rescale_q(duration_pts, {1, AV_TIME_BASE}, st->time_base);
-                            } else if (ctx->codec_type == AVMEDIA_TYPE_AUDIO) {
-                                duration_pts = av_rescale_q(av_frame->nb_samples, {1, ctx->sample_rate}, st->time_base);
-                            }
-                        }
-
-                        if (duration_pts > 0) {
-                            next_pts = av_frame->pts + duration_pts;
-                        } else {
-                            next_pts = AV_NOPTS_VALUE;
-                        }
-
-                        {
-                            boost::unique_lock<boost::mutex> lock(output_mutex);
-                            output_cond.wait(lock, [&]() { return output.size() < output_capacity; });
-                            output.push(std::move(av_frame));
-                        }
-                    }
-                }
-            } catch (boost::thread_interrupted&) {
-                // Do nothing...
-            } catch (...) {
-                eof = true;
-                CASPAR_LOG_CURRENT_EXCEPTION();
-            }
-        });
-    }
-
-    ~Decoder()
-    {
-        try {
-            if (thread.joinable()) {
-                thread.interrupt();
-                thread.join();
-            }
-        } catch (boost::thread_interrupted&) {
-            // Do nothing...
-        }
+        task.emplace([this] { decode(); }, priority);
     }
 
     bool want_packet() const
@@ -292,7 +197,7 @@ class Decoder
             input.push(std::move(packet));
         }
 
-        input_cond.notify_all();
+        task->schedule();
     }
 
     std::shared_ptr<AVFrame> pop()
@@ -309,13 +214,139 @@ class Decoder
         }
 
         if (frame) {
-            output_cond.notify_all();
+            task->schedule();
         } else if (eof) {
             frame = alloc_frame();
         }
 
         return frame;
     }
+
+    std::size_t input_size() const
+    {
+        boost::lock_guard<boost::mutex> lock(input_mutex);
+        return input.size();
+    }
+
+    std::size_t output_size() const
+    {
+        boost::lock_guard<boost::mutex> lock(output_mutex);
+        return output.size();
+    }
+
+    // Returns the time, in seconds, spent decoding since the last call.
+    double take_decode_time() { return static_cast<double>(decode_time_us.exchange(0)) / 1000000.0; }
+
+  private:
+    // Decodes until the decoder needs a packet which hasn't been pushed yet, or the output is full. push and pop
+    // schedule it again.
+    void decode()
+    {
+        auto start = std::chrono::steady_clock::now();
+        CASPAR_SCOPE_EXIT
+        {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            decode_time_us += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        };
+
+        try {
+            while (!eof) {
+                {
+                    boost::lock_guard<boost::mutex> lock(output_mutex);
+                    if (output.size() >= output_capacity) {
+                        return;
+                    }
+                }
+
+                auto av_frame = alloc_frame();
+                auto ret      = avcodec_receive_frame(ctx.get(), av_frame.get());
+
+                if (ret == AVERROR(EAGAIN)) {
+                    std::shared_ptr<AVPacket> packet;
+                    {
+                        boost::lock_guard<boost::mutex> lock(input_mutex);
+                        if (input.empty()) {
+                            return;
+                        }
+                        packet = std::move(input.front());
+                        input.pop();
+                    }
+                    FF(avcodec_send_packet(ctx.get(), packet.get()));
+                } else if (ret == AVERROR_EOF) {
+                    avcodec_flush_buffers(ctx.get());
+                    av_frame->pts = next_pts;
+                    next_pts      = AV_NOPTS_VALUE;
+                    eof           = true;
+
+                    {
+                        boost::lock_guard<boost::mutex> lock(output_mutex);
+                        output.push(std::move(av_frame));
+                    }
+                } else {
+                    FF_RET(ret, "avcodec_receive_frame");
+
+                    // TODO: Maybe Fixed in:
+                    // https://github.com/FFmpeg/FFmpeg/commit/33203a08e0a26598cb103508327a1dc184b27bc6
+                    // NOTE This is a workaround for DVCPRO HD.
+#if LIBAVCODEC_VERSION_MAJOR < 61
+                    if (av_frame->width > 1024 && av_frame->interlaced_frame) {
+                        av_frame->top_field_first = 1;
+                    }
+#else
+                    if (av_frame->width > 1024 && (av_frame->flags & AV_FRAME_FLAG_INTERLACED)) {
+                        av_frame->flags |= AV_FRAME_FLAG_TOP_FIELD_FIRST;
+                    }
+#endif
+
+                    // TODO (fix) is this always best?
+                    av_frame->pts = av_frame->best_effort_timestamp;
+
+#if LIBAVUTIL_VERSION_MAJOR < 58
+                    auto duration_pts = av_frame->pkt_duration;
+#else
+                    auto duration_pts = av_frame->duration;
+#endif
+                    if (duration_pts <= 0) {
+                        if (ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+#if LIBAVCODEC_VERSION_MAJOR < 62
+                            const int ticks_per_frame = ctx->ticks_per_frame;
+#else
+                            // https://github.com/FFmpeg/FFmpeg/commit/e930b834a928546f9cbc937f6633709053448232#diff-115616f8a2b59cab3aac4e7f4c8c31e69e94e7fcfa339b9f65b0bf34308aa80fR682
+                            const int ticks_per_frame =
+                                (ctx->codec_descriptor && (ctx->codec_descriptor->props & AV_CODEC_PROP_FIELDS))
+                                    ? 2
+                                    : 1;
+#endif
+                            const auto ticks = av_stream_get_parser(st) ? av_stream_get_parser(st)->repeat_pict + 1
+                                                                        : ticks_per_frame;
+                            duration_pts     = static_cast<int64_t>(AV_TIME_BASE) * ctx->framerate.den * ticks /
+                                           ctx->framerate.num / ticks_per_frame;
+                            duration_pts = av_rescale_q(duration_pts, {1, AV_TIME_BASE}, st->time_base);
+                        } else if (ctx->codec_type == AVMEDIA_TYPE_AUDIO) {
+                            duration_pts = av_rescale_q(av_frame->nb_samples, {1, ctx->sample_rate}, st->time_base);
+                        }
+                    }
+
+                    if (duration_pts > 0) {
+                        next_pts = av_frame->pts + duration_pts;
+                    } else {
+                        next_pts = AV_NOPTS_VALUE;
+                    }
+
+                    {
+                        boost::lock_guard<boost::mutex> lock(output_mutex);
+                        output.push(std::move(av_frame));
+                    }
+                }
+            }
+        } catch (...) {
+            eof = true;
+            CASPAR_LOG_CURRENT_EXCEPTION();
+        }
+    }
+
+    // Declared last, so that decoding has stopped before the rest, such as ctx, is destroyed.
+    std::optional<Task> task;
 };
 
 struct Filter
@@ -331,6 +362,7 @@ struct Filter
     Filter(std::string                    filter_spec,
            const Input&                   input,
            std::map<int, Decoder>&        streams,
+           core::frame_factory&           frame_factory,
            int64_t                        start_time,
            AVMediaType                    media_type,
            const core::video_format_desc& format_desc)
@@ -498,7 +530,7 @@ struct Filter
 
                 auto it = streams.find(index);
                 if (it == streams.end()) {
-                    it = streams.emplace(index, input->streams[index]).first;
+                    it = streams.try_emplace(index, input->streams[index], input.priority(), frame_factory).first;
                 }
 
                 auto st = it->second.ctx;
@@ -707,11 +739,34 @@ struct AVProducer::Impl
     std::atomic<bool>         buffer_eof_{false};
     int                       buffer_capacity_ = static_cast<int>(format_desc_.fps) / 4;
 
-    std::optional<caspar::executor> video_executor_;
-    std::optional<caspar::executor> audio_executor_;
-
     int latency_ = 0;
 
+    // Playback speed, see speed. next_frame shows frames for more than one tick, or skips them, to play at it.
+    std::atomic<double> speed_{1.0};
+    double              speed_phase_ = 0.0;
+
+    // Reverse playback decodes the stretch of the clip before the frames it has queued and queues the stretch's frames
+    // newest first. The stretch before that is decoded while they are being shown. A stretch is reverse_capacity_
+    // frames. When the file has been indexed it is extended back to the keyframe decoding starts at, up to
+    // reverse_max_frames_, and starts at a keyframe, so that frames are rarely decoded only to be dropped. Only the run
+    // thread touches these.
+    bool              reverse_          = false;
+    const std::size_t reverse_capacity_ =
+        std::max(env::properties().get(L"configuration.ffmpeg.producer.reverse-cache", 25), 1);
+    const std::size_t reverse_max_frames_ = std::max(
+        reverse_capacity_,
+        (env::properties().get<std::size_t>(L"configuration.ffmpeg.producer.reverse-max-size", 512) << 20) /
+            std::max<std::size_t>(format_desc_.size, 1));
+    int64_t           reverse_from_     = AV_NOPTS_VALUE;
+    int64_t           reverse_to_       = AV_NOPTS_VALUE;
+    bool              reverse_decoding_ = false;
+    std::deque<Frame> reverse_decoded_; // The stretch being decoded, oldest first.
+    std::deque<Frame> reverse_queue_;   // Frames of the last stretch which are yet to be queued, oldest first.
+
+    // The frames decoded since the last cue point, which are stored in the cue cache once there are enough of them.
+    std::optional<CueKey>  cue_key_;
+    std::vector<CuedFrame> cue_frames_;
+
     boost::thread thread_;
 
     Impl(std::shared_ptr<core::frame_factory> frame_factory,
@@ -739,8 +794,6 @@ struct AVProducer::Impl
         , vfilter_(vfilter)
         , seekable_(seekable)
         , scale_mode_(scale_mode)
-        , video_executor_(L"video-executor")
-        , audio_executor_(L"audio-executor")
     {
         diagnostics::register_graph(graph_);
         graph_->set_color("underflow", diagnostics::color(0.6f, 0.3f, 0.9f));
@@ -786,9 +839,6 @@ struct AVProducer::Impl
             // Do nothing...
         }
 
-        video_executor_.reset();
-        audio_executor_.reset();
-
         CASPAR_LOG(debug) << print() << " Joined";
     }
 
@@ -824,10 +874,12 @@ struct AVProducer::Impl
             }
 
             const auto firstStart = firstSeek ? av_rescale_q(*firstSeek, format_tb_, TIME_BASE_Q) : start;
-            if (firstStart != AV_NOPTS_VALUE) {
-                seek_internal(firstStart);
-            } else {
-                reset(input_->start_time != AV_NOPTS_VALUE ? input_->start_time : 0);
+            if (!cue(firstStart != AV_NOPTS_VALUE ? firstStart : 0, audio_cadence)) {
+                if (firstStart != AV_NOPTS_VALUE) {
+                    seek_internal(firstStart);
+                } else {
+                    reset(input_->start_time != AV_NOPTS_VALUE ? input_->start_time : 0);
+                }
             }
         }
 
@@ -839,6 +891,8 @@ struct AVProducer::Impl
         timer frame_timer;
         timer decode_timer;
 
+        std::chrono::steady_clock::duration filter_time{};
+
         int warning_debounce = 0;
 
         while (!thread_.interruption_requested()) {
@@ -846,13 +900,36 @@ struct AVProducer::Impl
                 const auto seek = seek_.exchange(AV_NOPTS_VALUE);
 
                 if (seek != AV_NOPTS_VALUE) {
-                    seek_internal(seek);
+                    reverse_decoded_.clear();
+                    reverse_queue_.clear();
+                    reverse_decoding_ = false;
+
+                    reverse_ = speed_ < 0.0;
+                    if (reverse_) {
+                        // The frame at seek is the first one shown.
+                        reverse_to_  = seek + av_rescale_q(1, format_tb_, TIME_BASE_Q);
+                        frame_flush_ = true;
+                        frame_count_ = 0;
+                        buffer_eof_  = false;
+                        cue_key_.reset();
+                        cue_frames_.clear();
+                    } else if (!cue(seek, audio_cadence)) {
+                        seek_internal(seek);
+                    }
                     frame = Frame{};
                     continue;
                 }
             }
 
-            {
+            if (reverse_ && !reverse_schedule()) {
+                // Wait for the buffer to make room for the last stretch, or at the start of the clip for a seek or
+                // for it to loop or be trimmed.
+                boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
+                buffer_cond_.wait(buffer_lock, [&] { return !reverse_blocked(); });
+                continue;
+            }
+
+            if (!reverse_) {
                 // TODO (perf) seek as soon as input is past duration or eof.
 
                 auto start    = start_.load();
@@ -867,7 +944,9 @@ struct AVProducer::Impl
                 if (buffer_eof_) {
                     if (loop_ && frame_count_ > 2) {
                         frame = Frame{};
-                        seek_internal(start);
+                        if (!cue(start, audio_cadence)) {
+                            seek_internal(start);
+                        }
                     } else {
                         std::this_thread::sleep_for(std::chrono::milliseconds(10));
                     }
@@ -880,19 +959,26 @@ struct AVProducer::Impl
             {
                 progress |= schedule();
 
-                std::vector<std::future<bool>> futures;
-
-                if (!video_filter_.frame) {
-                    futures.push_back(video_executor_->begin_invoke([&]() { return video_filter_(); }));
-                }
+                auto filter_start = std::chrono::steady_clock::now();
 
-                if (!audio_filter_.frame) {
-                    futures.push_back(audio_executor_->begin_invoke([&]() { return audio_filter_(audio_cadence[0]); }));
-                }
+                bool video_progress = false;
+                bool audio_progress = false;
+                execute(input_.priority(), [&] {
+                    tbb::parallel_invoke(
+                        [&] {
+                            if (!video_filter_.frame) {
+                                video_progress = video_filter_();
+                            }
+                        },
+                        [&] {
+                            if (!audio_filter_.frame) {
+                                audio_progress = audio_filter_(audio_cadence[0]);
+                            }
+                        });
+                });
+                progress |= video_progress || audio_progress;
 
-                for (auto& future : futures) {
-                    progress |= future.get();
-                }
+                filter_time += std::chrono::steady_clock::now() - filter_start;
             }
 
             if ((!video_filter_.frame && !video_filter_.eof) || (!audio_filter_.frame && !audio_filter_.eof)) {
@@ -941,13 +1027,43 @@ struct AVProducer::Impl
                 frame.duration   = av_rescale_q(frame.audio->nb_samples, {1, sr}, TIME_BASE_Q);
             }
 
-            frame.frame = core::draw_frame(
+            // Frames outside the stretch being decoded in reverse would be dropped, so they are not made.
+            if (reverse_ && (frame.pts < reverse_from_ || frame.pts >= reverse_to_)) {
+                if (frame.pts >= reverse_to_) {
+                    reverse_complete();
+                }
+                boost::range::rotate(audio_cadence, std::end(audio_cadence) - 1);
+                continue;
+            }
+
+            auto frame_start = std::chrono::steady_clock::now();
+
+            auto const_frame = core::const_frame(
                 make_frame(this, *frame_factory_, frame.video, frame.audio, get_color_space(frame.video), scale_mode_));
-            frame.frame_count = frame_count_++;
+            frame.frame = core::draw_frame(const_frame);
+
+            if (cue_key_) {
+                cue_frames_.push_back(CuedFrame{const_frame, frame.start_time, frame.pts, frame.duration});
+                if (cue_frames_.size() >= cue_frame_count()) {
+                    store_cue(*cue_key_, std::move(cue_frames_));
+                    cue_key_.reset();
+                    cue_frames_.clear();
+                }
+            }
+
+            update_performance_state(filter_time, std::chrono::steady_clock::now() - frame_start);
+            filter_time = {};
 
             graph_->set_value("decode-time", decode_timer.elapsed() * format_desc_.fps * 0.5);
 
-            {
+            if (reverse_) {
+                reverse_decoded_.push_back(frame);
+                if (reverse_decoded_.size() > reverse_max_frames_) {
+                    reverse_decoded_.pop_front();
+                }
+            } else {
+                frame.frame_count = frame_count_++;
+
                 boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
                 buffer_cond_.wait(buffer_lock, [&] { return buffer_.size() < buffer_capacity_; });
                 if (seek_ == AV_NOPTS_VALUE) {
@@ -969,6 +1085,33 @@ struct AVProducer::Impl
         }
     }
 
+    // Reports where the time of the last frame went and how full each queue is, from the input to the frame buffer.
+    void update_performance_state(std::chrono::steady_clock::duration filter_time,
+                                  std::chrono::steady_clock::duration frame_time)
+    {
+        auto to_ms = [](auto duration) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000.0;
+        };
+
+        core::monitor::state state;
+        state["queue/input"] = input_.size();
+        state["time/demux"]  = input_.take_read_time() * 1000.0;
+        state["time/filter"] = to_ms(filter_time);
+        state["time/frame"]  = to_ms(frame_time);
+        for (auto& p : decoders_) {
+            auto index                      = std::to_string(p.first);
+            state["queue/decoder/" + index] = {p.second.input_size(), p.second.output_size()};
+            state["time/decode/" + index]   = p.second.take_decode_time() * 1000.0;
+        }
+        {
+            boost::lock_guard<boost::mutex> lock(buffer_mutex_);
+            state["queue/buffer"] = {buffer_.size(), buffer_capacity_};
+        }
+
+        boost::lock_guard<boost::mutex> lock(state_mutex_);
+        state_["performance"] = std::move(state);
+    }
+
     void update_state()
     {
         graph_->set_text(u16(print()));
@@ -976,6 +1119,7 @@ struct AVProducer::Impl
         state_["file/clip"] = {start().value_or(0) / format_desc_.fps, duration().value_or(0) / format_desc_.fps};
         state_["file/time"] = {time() / format_desc_.fps, file_duration().value_or(0) / format_desc_.fps};
         state_["loop"]      = loop_;
+        state_["speed"]     = speed_.load();
     }
 
     core::draw_frame prev_frame(const core::video_field field)
@@ -1009,8 +1153,16 @@ struct AVProducer::Impl
     {
         CASPAR_SCOPE_EXIT { update_state(); };
 
+        // Frames are only pulled from a producer which is being played.
+        input_.priority(Priority::foreground);
+
         boost::lock_guard<boost::mutex> lock(buffer_mutex_);
 
+        const auto speed = speed_.load();
+        if (speed != 1.0) {
+            return retime(speed);
+        }
+
         if (buffer_.empty() || (frame_flush_ && buffer_.size() < 4)) {
             auto start    = start_.load();
             auto duration = duration_.load();
@@ -1046,19 +1198,32 @@ struct AVProducer::Impl
             latency_ = -1;
         }
 
-        frame_          = buffer_[0].frame;
-        frame_time_     = buffer_[0].pts;
-        frame_duration_ = buffer_[0].duration;
-        frame_flush_    = false;
-
-        buffer_.pop_front();
-        buffer_cond_.notify_all();
+        show_frame();
 
         graph_->set_value("buffer", static_cast<double>(buffer_.size()) / static_cast<double>(buffer_capacity_));
 
         return frame_;
     }
 
+    void speed(double speed)
+    {
+        CASPAR_SCOPE_EXIT { update_state(); };
+
+        if (!std::isfinite(speed)) {
+            CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info(L"Invalid speed."));
+        }
+        if (speed < 0.0 && !seekable_) {
+            CASPAR_THROW_EXCEPTION(not_supported() << msg_info(L"Reverse playback requires a seekable input."));
+        }
+
+        // Decoding changes direction at the frame which is shown.
+        if ((speed_.exchange(speed) < 0.0) != (speed < 0.0)) {
+            seek(time());
+        }
+    }
+
+    double speed() const { return speed_; }
+
     void seek(int64_t time)
     {
         CASPAR_SCOPE_EXIT { update_state(); };
@@ -1088,6 +1253,7 @@ struct AVProducer::Impl
         CASPAR_SCOPE_EXIT { update_state(); };
 
         loop_ = loop;
+        wake();
     }
 
     bool loop() const { return loop_; }
@@ -1096,6 +1262,7 @@ struct AVProducer::Impl
     {
         CASPAR_SCOPE_EXIT { update_state(); };
         start_ = av_rescale_q(start, format_tb_, TIME_BASE_Q);
+        wake();
     }
 
     std::optional<int64_t> start() const
@@ -1109,6 +1276,7 @@ struct AVProducer::Impl
         CASPAR_SCOPE_EXIT { update_state(); };
 
         duration_ = av_rescale_q(duration, format_tb_, TIME_BASE_Q);
+        wake();
     }
 
     std::optional<int64_t> duration() const
@@ -1130,6 +1298,138 @@ struct AVProducer::Impl
     }
 
   private:
+    // Wakes the decoding thread, so that it rechecks what it waits for.
+    void wake()
+    {
+        boost::lock_guard<boost::mutex> lock(buffer_mutex_);
+        buffer_cond_.notify_all();
+    }
+
+    // Shows the first buffered frame. Called with buffer_mutex_ held.
+    void show_frame()
+    {
+        frame_          = buffer_[0].frame;
+        frame_time_     = buffer_[0].pts;
+        frame_duration_ = buffer_[0].duration;
+        frame_flush_    = false;
+
+        buffer_.pop_front();
+        buffer_cond_.notify_all();
+    }
+
+    // Shows the buffered frames at a speed other than 1, for more than one tick or skipping some, with their audio
+    // muted. A speed of 0 holds the frame which is shown, other than to show the first frame after a seek, such as from
+    // STEP. Called with buffer_mutex_ held.
+    core::draw_frame retime(double speed)
+    {
+        speed_phase_ = frame_flush_ ? 1.0 : speed_phase_ + std::abs(speed);
+
+        while (speed_phase_ >= 1.0 && !buffer_.empty()) {
+            show_frame();
+            speed_phase_ -= 1.0;
+        }
+
+        if (speed_phase_ >= 1.0) {
+            if (!buffer_eof_) {
+                graph_->set_tag(diagnostics::tag_severity::WARNING, "underflow");
+            }
+            // Catch up by no more than a frame once decoding does.
+            speed_phase_ = 1.0;
+        }
+
+        graph_->set_value("buffer", static_cast<double>(buffer_.size()) / static_cast<double>(buffer_capacity_));
+
+        return core::draw_frame::still(frame_);
+    }
+
+    // Queues the frames of the last stretch for reverse playback as the buffer makes room for them, and starts
+    // decoding the stretch before it. Returns whether a stretch is being decoded.
+    bool reverse_schedule()
+    {
+        auto start = start_.load();
+        start      = start != AV_NOPTS_VALUE ? start : 0;
+
+        if (reverse_decoding_ && video_filter_.eof && audio_filter_.eof) {
+            reverse_complete();
+        }
+
+        if (!reverse_decoding_ && reverse_queue_.empty()) {
+            std::swap(reverse_queue_, reverse_decoded_);
+        }
+
+        {
+            boost::lock_guard<boost::mutex> lock(buffer_mutex_);
+            while (!reverse_queue_.empty() && buffer_.size() < buffer_capacity_ && seek_ == AV_NOPTS_VALUE) {
+                auto frame = std::move(reverse_queue_.back());
+                reverse_queue_.pop_back();
+                frame.frame_count = frame_count_++;
+                buffer_.push_back(std::move(frame));
+            }
+            buffer_eof_ = reverse_to_ <= start && !reverse_decoding_ && reverse_decoded_.empty() &&
+                          reverse_queue_.empty();
+        }
+
+        if (reverse_decoding_ || !reverse_decoded_.empty()) {
+            return reverse_decoding_;
+        }
+
+        if (reverse_to_ <= start) {
+            const auto duration = duration_.load();
+            if (!buffer_eof_ || !loop_ || duration == AV_NOPTS_VALUE) {
+                return false;
+            }
+            reverse_to_ = start + duration;
+        }
+
+        const auto frame_duration = av_rescale_q(1, format_tb_, TIME_BASE_Q);
+        const auto start_time     = input_->start_time != AV_NOPTS_VALUE ? input_->start_time : 0;
+
+        reverse_from_ = std::max(start, reverse_to_ - static_cast<int64_t>(reverse_capacity_) * frame_duration);
+
+        // The demuxer starts at the keyframe before the stretch, and the frames before the stretch are dropped. With
+        // long GOPs most of the decoded frames would be dropped, so extend the stretch back to that keyframe, as far as
+        // memory allows.
+        auto gop_start = input_.prev_keyframe(reverse_from_ + start_time);
+        if (gop_start) {
+            const auto max_from = reverse_to_ - static_cast<int64_t>(reverse_max_frames_) * frame_duration;
+            reverse_from_       = std::max({start, max_from, *gop_start - start_time});
+        }
+
+        // Start the stretch at the first keyframe within it, if that is known, and leave the frames before it to the
+        // next stretch.
+        auto keyframe = input_.next_keyframe(reverse_from_ + start_time);
+        if (keyframe && *keyframe - start_time < reverse_to_) {
+            reverse_from_ = *keyframe - start_time;
+        }
+
+        decode_from(reverse_from_);
+        reverse_decoding_ = true;
+
+        return true;
+    }
+
+    // Returns whether reverse_schedule can't make progress until the buffer makes room for the last stretch, or, at
+    // the start of the clip, until it is seeked, looped or trimmed. Called with buffer_mutex_ held.
+    bool reverse_blocked() const
+    {
+        if (seek_ != AV_NOPTS_VALUE) {
+            return false;
+        }
+        if (!reverse_queue_.empty()) {
+            return buffer_.size() >= buffer_capacity_;
+        }
+        auto start = start_.load();
+        start      = start != AV_NOPTS_VALUE ? start : 0;
+        return reverse_to_ <= start && (!loop_ || duration_ == AV_NOPTS_VALUE);
+    }
+
+    // Ends the stretch which is being decoded. The next one ends where it starts.
+    void reverse_complete()
+    {
+        reverse_decoding_ = false;
+        reverse_to_       = reverse_decoded_.empty() ? reverse_from_ : reverse_decoded_.front().pts;
+    }
+
     bool want_packet()
     {
         return std::any_of(decoders_.begin(), decoders_.end(), [](auto& p) { return p.second.want_packet(); });
@@ -1201,7 +1501,63 @@ struct AVProducer::Impl
         return result;
     }
 
+    // Serves the frames decoded from time from the cue cache, if they are there, and seeks to where they end. Returns
+    // false, without seeking, if they aren't, in which case the frames decoded from time are stored for the next cue.
+    bool cue(int64_t time, std::vector<int>& audio_cadence)
+    {
+        cue_key_.reset();
+        cue_frames_.clear();
+
+        auto write_time = file_write_time(path_);
+        if (!write_time || !seekable_ || cue_frame_count() == 0) {
+            return false;
+        }
+
+        auto key =
+            CueKey{path_, *write_time, vfilter_, afilter_, format_desc_.name, static_cast<int>(scale_mode_), time};
+
+        auto frames = find_cue(key);
+        if (!frames) {
+            cue_key_ = std::move(key);
+            return false;
+        }
+
+        seek_internal(frames->back().pts + frames->back().duration);
+
+        // The frames are buffered like decoded ones, waiting for room as the buffer fills up.
+        boost::unique_lock<boost::mutex> lock(buffer_mutex_);
+        for (auto& cued : *frames) {
+            buffer_cond_.wait(lock, [&] { return buffer_.size() < buffer_capacity_; });
+            if (seek_ != AV_NOPTS_VALUE) {
+                return true;
+            }
+
+            Frame frame;
+            frame.frame       = core::draw_frame(cued.frame.with_tag(this));
+            frame.start_time  = cued.start_time;
+            frame.pts         = cued.pts;
+            frame.duration    = cued.duration;
+            frame.frame_count = frame_count_++;
+            buffer_.push_back(std::move(frame));
+            buffer_cond_.notify_all();
+
+            boost::range::rotate(audio_cadence, std::end(audio_cadence) - 1);
+        }
+
+        return true;
+    }
+
     void seek_internal(int64_t time)
+    {
+        frame_flush_ = true;
+        frame_count_ = 0;
+        buffer_eof_  = false;
+
+        decode_from(time);
+    }
+
+    // Restarts decoding at time, without flushing the frames which have been decoded.
+    void decode_from(int64_t time)
     {
         time = time != AV_NOPTS_VALUE ? time : 0;
         time = time + (input_->start_time != AV_NOPTS_VALUE ? input_->start_time : 0);
@@ -1210,9 +1566,6 @@ struct AVProducer::Impl
         if (seekable_) {
             input_.seek(time);
         }
-        frame_flush_ = true;
-        frame_count_ = 0;
-        buffer_eof_  = false;
 
         decoders_.clear();
 
@@ -1221,8 +1574,10 @@ struct AVProducer::Impl
 
     void reset(int64_t start_time)
     {
-        video_filter_ = Filter(vfilter_, input_, decoders_, start_time, AVMEDIA_TYPE_VIDEO, format_desc_);
-        audio_filter_ = Filter(afilter_, input_, decoders_, start_time, AVMEDIA_TYPE_AUDIO, format_desc_);
+        video_filter_ =
+            Filter(vfilter_, input_, decoders_, *frame_factory_, start_time, AVMEDIA_TYPE_VIDEO, format_desc_);
+        audio_filter_ =
+            Filter(afilter_, input_, decoders_, *frame_factory_, start_time, AVMEDIA_TYPE_AUDIO, format_desc_);
 
         sources_.clear();
         for (auto& p : video_filter_.sources) {
@@ -1295,6 +1650,14 @@ AVProducer& AVProducer::seek(int64_t time)
     return *this;
 }
 
+AVProducer& AVProducer::speed(double speed)
+{
+    impl_->speed(speed);
+    return *this;
+}
+
+double AVProducer::speed() const { return impl_->speed(); }
+
 AVProducer& AVProducer::loop(bool loop)
 {
     impl_->loop(loop);
@@ -35,6 +35,11 @@ class AVProducer
     AVProducer& seek(int64_t time);
     int64_t     time() const;
 
+    // Plays at speed times the normal rate, backwards if it is negative. Audio is muted at any other speed than 1, and
+    // 0 holds the frame which is shown.
+    AVProducer& speed(double speed);
+    double      speed() const;
+
     AVProducer& loop(bool loop);
     bool        loop() const;
 
@@ -0,0 +1,85 @@
+#include "av_worker_pool.h"
+
+#include <common/log.h>
+
+#include <tbb/task_arena.h>
+
+namespace caspar { namespace ffmpeg {
+
+namespace {
+
+tbb::task_arena& get_arena(Priority priority)
+{
+    // The arenas share TBB's worker threads, which serve the foreground arena first. Both leave a slot for the
+    // producer threads which wait in execute.
+    static tbb::task_arena foreground(tbb::task_arena::automatic, 1, tbb::task_arena::priority::normal);
+    static tbb::task_arena background(tbb::task_arena::automatic, 1, tbb::task_arena::priority::low);
+    return priority == Priority::foreground ? foreground : background;
+}
+
+} // namespace
+
+void execute(Priority priority, const std::function<void()>& func) { get_arena(priority).execute(func); }
+
+Task::Task(std::function<void()> func, const std::atomic<Priority>& priority)
+    : func_(std::move(func))
+    , priority_(priority)
+{
+}
+
+Task::~Task()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    aborted_ = true;
+    cond_.wait(lock, [&] { return !running_ && !scheduled_; });
+}
+
+void Task::schedule()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (aborted_) {
+        return;
+    }
+
+    if (running_) {
+        rerun_ = true;
+    } else if (!scheduled_) {
+        enqueue();
+    }
+}
+
+void Task::enqueue()
+{
+    scheduled_ = true;
+    get_arena(priority_).enqueue([this] { run(); });
+}
+
+void Task::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scheduled_ = false;
+        if (aborted_) {
+            cond_.notify_all();
+            return;
+        }
+        running_ = true;
+    }
+
+    try {
+        func_();
+    } catch (...) {
+        CASPAR_LOG_CURRENT_EXCEPTION();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    if (rerun_ && !aborted_) {
+        rerun_ = false;
+        enqueue();
+    }
+    cond_.notify_all();
+}
+
+}} // namespace caspar::ffmpeg
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace caspar { namespace ffmpeg {
+
+// Producers which are being played are served before producers which are only preloading, such as a LOADBG'ed clip.
+enum class Priority
+{
+    foreground,
+    background,
+};
+
+// Runs func on the worker pool shared by all ffmpeg producers and waits for it. Work spawned by func, such as with
+// tbb::parallel_invoke, runs on the pool as well.
+void execute(Priority priority, const std::function<void()>& func);
+
+// A step of a producer, such as demuxing the input or decoding a stream, which runs on the shared worker pool. The step
+// should return as soon as it would have to wait, for input or for room for its output, and be scheduled again once it
+// can make progress. At most one invocation runs at a time, and scheduling it while it runs makes it run once more.
+class Task
+{
+  public:
+    Task(std::function<void()> func, const std::atomic<Priority>& priority);
+    ~Task();
+
+    Task(const Task&)            = delete;
+    Task& operator=(const Task&) = delete;
+
+    void schedule();
+
+  private:
+    void enqueue();
+    void run();
+
+    std::function<void()>        func_;
+    const std::atomic<Priority>& priority_;
+
+    std::mutex              mutex_;
+    std::condition_variable cond_;
+    bool                    scheduled_ = false;
+    bool                    running_   = false;
+    bool                    rerun_     = false;
+    bool                    aborted_   = false;
+};
+
+}} // namespace caspar::ffmpeg
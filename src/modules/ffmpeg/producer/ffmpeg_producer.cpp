@@ -184,6 +184,20 @@ struct ffmpeg_producer : public core::frame_producer
             producer_->seek(seek);
 
             result = std::to_wstring(seek);
+        } else if (boost::iequals(cmd, L"speed")) {
+            if (!value.empty()) {
+                producer_->speed(boost::lexical_cast<double>(value));
+            }
+
+            result = std::to_wstring(producer_->speed());
+        } else if (boost::iequals(cmd, L"step")) {
+            // Pauses and shows the frame which is the given number of frames away, 1 by default.
+            const auto frames = value.empty() ? INT64_C(1) : boost::lexical_cast<int64_t>(value);
+            const auto step   = std::max(producer_->speed(0.0).time() + frames, producer_->start());
+
+            producer_->seek(step);
+
+            result = std::to_wstring(step);
         } else {
             CASPAR_THROW_EXCEPTION(invalid_argument());
         }
@@ -3,6 +3,8 @@
 
 #include <common/bit_depth.hpp>
 
+#include <boost/range/algorithm/find.hpp>
+
 #if defined(_MSC_VER)
 #pragma warning(push)
 #pragma warning(disable : 4244)
@@ -11,8 +13,10 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavfilter/avfilter.h>
 #include <libavutil/channel_layout.h>
+#include <libavutil/cpu.h>
 #include <libavutil/frame.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libavutil/pixfmt.h>
 }
 #if defined(_MSC_VER)
@@ -20,6 +24,7 @@ extern "C" {
 #endif
 
 #include <array>
+#include <cstdint>
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_invoke.h>
 
@@ -27,6 +32,117 @@ extern "C" {
 
 namespace caspar { namespace ffmpeg {
 
+namespace {
+
+// The image planes of a frame which was decoded into a frame factory's buffers. It is the frame's opaque_ref, which
+// filters that pass the frame on, such as fps, keep along with its planes.
+struct FrameBuffers
+{
+    std::vector<array<std::uint8_t>> planes;
+};
+
+// The opaque of the AVBuffer which holds FrameBuffers, which tells it apart from any other opaque_ref a frame may have.
+char frame_buffers_tag;
+
+int get_frame_buffer(AVCodecContext* ctx, AVFrame* frame, int flags)
+{
+    const auto format = static_cast<AVPixelFormat>(frame->format);
+
+    std::vector<int> data_map;
+    const auto       desc = pixel_format_desc(format, frame->width, frame->height, data_map);
+
+    // The frame factory's planes have no padding, so the decoder has to write rows of exactly the frame's width.
+    int width  = frame->width;
+    int height = frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx, &width, &height, linesize_align);
+
+    auto supported = (ctx->codec->capabilities & AV_CODEC_CAP_DR1) && desc.format != core::pixel_format::invalid &&
+                     data_map.empty() && static_cast<int>(desc.planes.size()) == av_pix_fmt_count_planes(format) &&
+                     width == frame->width;
+    for (int n = 0; n < static_cast<int>(desc.planes.size()) && supported; ++n) {
+        supported = linesize_align[n] > 0 && desc.planes[n].linesize % linesize_align[n] == 0;
+    }
+    if (!supported) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+
+    // Room for the rows the decoder writes beyond the frame's height, and for the padding it may read past the end.
+    auto buffers_desc = core::pixel_format_desc(core::pixel_format::gray);
+    for (auto& plane : desc.planes) {
+        buffers_desc.planes.push_back(core::pixel_format_desc::plane(
+            plane.size + plane.linesize * (height - frame->height) + AV_INPUT_BUFFER_PADDING_SIZE, 1, 1));
+    }
+
+    auto buffers_frame = static_cast<core::frame_factory*>(ctx->opaque)->create_frame(nullptr, buffers_desc);
+    for (int n = 0; n < static_cast<int>(desc.planes.size()); ++n) {
+        if (reinterpret_cast<std::uintptr_t>(buffers_frame.image_data(n).data()) % av_cpu_max_align() != 0) {
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        }
+    }
+
+    auto buffers    = new FrameBuffers();
+    auto opaque_ref = av_buffer_create(
+        reinterpret_cast<uint8_t*>(buffers),
+        sizeof(FrameBuffers),
+        [](void*, uint8_t* data) { delete reinterpret_cast<FrameBuffers*>(data); },
+        &frame_buffers_tag,
+        0);
+    if (!opaque_ref) {
+        delete buffers;
+        return AVERROR(ENOMEM);
+    }
+
+    for (int n = 0; n < static_cast<int>(desc.planes.size()); ++n) {
+        auto& plane = buffers_frame.image_data(n);
+        auto  data  = new array<std::uint8_t>(plane.share());
+        frame->buf[n] = av_buffer_create(
+            data->data(),
+            data->size(),
+            [](void* opaque, uint8_t*) { delete static_cast<array<std::uint8_t>*>(opaque); },
+            data,
+            0);
+        if (!frame->buf[n]) {
+            delete data;
+            for (int m = 0; m < n; ++m) {
+                av_buffer_unref(&frame->buf[m]);
+            }
+            av_buffer_unref(&opaque_ref);
+            return AVERROR(ENOMEM);
+        }
+        frame->data[n]     = frame->buf[n]->data;
+        frame->linesize[n] = desc.planes[n].linesize;
+        buffers->planes.push_back(std::move(plane));
+    }
+    frame->extended_data = frame->data;
+
+    av_buffer_unref(&frame->opaque_ref);
+    frame->opaque_ref = opaque_ref;
+
+    return 0;
+}
+
+// Returns the frame factory's buffers which video was decoded into, unless a filter has moved the image elsewhere.
+const FrameBuffers* frame_buffers(const AVFrame& video, const core::pixel_format_desc& desc)
+{
+    if (!video.opaque_ref || av_buffer_get_opaque(video.opaque_ref) != &frame_buffers_tag) {
+        return nullptr;
+    }
+
+    auto buffers = reinterpret_cast<const FrameBuffers*>(video.opaque_ref->data);
+    if (buffers->planes.size() != desc.planes.size()) {
+        return nullptr;
+    }
+    for (int n = 0; n < static_cast<int>(desc.planes.size()); ++n) {
+        if (buffers->planes[n].data() != video.data[n] || video.linesize[n] != desc.planes[n].linesize) {
+            return nullptr;
+        }
+    }
+    return buffers;
+}
+
+} // namespace
+
 std::shared_ptr<AVFrame> alloc_frame()
 {
     const auto frame = std::shared_ptr<AVFrame>(av_frame_alloc(), [](AVFrame* ptr) { av_frame_free(&ptr); });
@@ -51,7 +167,7 @@ core::mutable_frame make_frame(void*                            tag,
                                core::frame_geometry::scale_mode scale_mode,
                                bool                             is_straight_alpha)
 {
-    std::vector<int> data_map; // TODO(perf) when using data_map, avoid uploading duplicate planes
+    std::vector<int> data_map;
 
     auto pix_desc =
         video ? pixel_format_desc(
@@ -59,17 +175,39 @@ core::mutable_frame make_frame(void*                            tag,
               : core::pixel_format_desc(core::pixel_format::invalid);
     pix_desc.is_straight_alpha = is_straight_alpha;
 
-    auto frame = frame_factory.create_frame(tag, pix_desc);
+    // A frame which was decoded into the frame factory's buffers, see set_frame_buffers, keeps them rather than being
+    // copied. It is uploaded when it is first drawn.
+    auto buffers = video ? frame_buffers(*video, pix_desc) : nullptr;
+
+    auto frame = [&] {
+        if (!buffers) {
+            return frame_factory.create_frame(tag, pix_desc);
+        }
+        std::vector<array<std::uint8_t>> image_data;
+        for (auto& plane : buffers->planes) {
+            image_data.push_back(plane.share());
+        }
+        return core::mutable_frame(tag, std::move(image_data), array<std::int32_t>{}, pix_desc);
+    }();
     if (scale_mode != core::frame_geometry::scale_mode::stretch) {
         frame.geometry() = core::frame_geometry::get_default(scale_mode);
     }
 
     tbb::parallel_invoke(
         [&]() {
-            if (video) {
+            if (video && !buffers) {
                 for (int n = 0; n < static_cast<int>(pix_desc.planes.size()); ++n) {
                     auto frame_plan_index = data_map.empty() ? n : data_map.at(n);
 
+                    // Planes which are views of the same data, such as the two planes of uyvy, share one copy.
+                    auto shared = data_map.empty() ? n
+                                                   : static_cast<int>(boost::range::find(data_map, frame_plan_index) -
+                                                                      data_map.begin());
+                    if (shared < n && frame.image_data(n).size() == frame.image_data(shared).size()) {
+                        frame.image_data(n) = frame.image_data(shared).share();
+                        continue;
+                    }
+
                     tbb::parallel_for(0, pix_desc.planes[n].height, [&](int y) {
                         std::memcpy(frame.image_data(n).begin() + y * pix_desc.planes[n].linesize,
                                     video->data[frame_plan_index] + y * video->linesize[frame_plan_index],
@@ -80,36 +218,38 @@ core::mutable_frame make_frame(void*                            tag,
         },
         [&]() {
             if (audio) {
-                const int channel_count = 16;
-                frame.audio_data()      = std::vector<int32_t>(audio->nb_samples * channel_count, 0);
-
 #if FFMPEG_NEW_CHANNEL_LAYOUT
-                auto source_channel_count = audio->ch_layout.nb_channels;
+                auto channel_count = audio->ch_layout.nb_channels;
 #else
-                auto source_channel_count = audio->channels;
+                auto channel_count = audio->channels;
 #endif
 
-                if (source_channel_count == channel_count) {
-                    std::memcpy(frame.audio_data().data(),
-                                reinterpret_cast<int32_t*>(audio->data[0]),
-                                sizeof(int32_t) * channel_count * audio->nb_samples);
-                } else {
-                    // This isn't pretty, but some callers may not provide 16 channels
-
-                    auto dst = frame.audio_data().data();
-                    auto src = reinterpret_cast<int32_t*>(audio->data[0]);
-                    for (auto i = 0; i < audio->nb_samples; i++) {
-                        for (auto j = 0; j < std::min(channel_count, source_channel_count); ++j) {
-                            dst[i * channel_count + j] = src[i * source_channel_count + j];
-                        }
-                    }
-                }
+                // The audio keeps the stream's channel count, the audio mixer maps it onto the channel's.
+                frame.audio_data()     = std::vector<int32_t>(audio->nb_samples * channel_count);
+                frame.audio_channels() = channel_count;
+                std::memcpy(frame.audio_data().data(),
+                            reinterpret_cast<int32_t*>(audio->data[0]),
+                            sizeof(int32_t) * channel_count * audio->nb_samples);
             }
         });
 
     return frame;
 }
 
+void set_frame_buffers(AVCodecContext* ctx, core::frame_factory& frame_factory)
+{
+    // The buffers are mapped write only and come from a bounded pool. Codecs which predict from earlier frames would
+    // read their reference frames back from them and keep a pooled buffer per reference frame, so only intra only
+    // codecs, such as ProRes and DNxHR, decode into them.
+    const auto desc = avcodec_descriptor_get(ctx->codec_id);
+    if (!desc || !(desc->props & AV_CODEC_PROP_INTRA_ONLY)) {
+        return;
+    }
+
+    ctx->opaque      = &frame_factory;
+    ctx->get_buffer2 = get_frame_buffer;
+}
+
 std::tuple<core::pixel_format, common::bit_depth> get_pixel_format(AVPixelFormat pix_fmt)
 {
     switch (pix_fmt) {
@@ -342,9 +482,36 @@ std::shared_ptr<AVFrame> make_av_video_frame(const core::const_frame& frame, con
             break;
     }
 
-    FF(av_frame_get_buffer(av_frame.get(), is_16bit ? 64 : 32));
+    // Reference the frame's planes directly when they are aligned as well as av_frame_get_buffer would align them.
+    const auto align   = is_16bit ? 64 : 32;
+    auto       aligned = planes.size() <= AV_NUM_DATA_POINTERS;
+    for (int n = 0; n < planes.size() && aligned; ++n) {
+        aligned = reinterpret_cast<std::uintptr_t>(frame.image_data(n).data()) % align == 0 &&
+                  planes[n].linesize % align == 0 &&
+                  frame.image_data(n).size() >= static_cast<std::size_t>(planes[n].linesize) * av_frame->height;
+    }
+
+    if (aligned) {
+        for (int n = 0; n < planes.size(); ++n) {
+            auto data = new std::shared_ptr<const uint8_t>(frame.share_image_data(n));
+            av_frame->buf[n] = av_buffer_create(
+                const_cast<uint8_t*>(data->get()),
+                frame.image_data(n).size(),
+                [](void* opaque, uint8_t*) { delete static_cast<std::shared_ptr<const uint8_t>*>(opaque); },
+                data,
+                AV_BUFFER_FLAG_READONLY);
+            if (!av_frame->buf[n]) {
+                delete data;
+                FF_RET(AVERROR(ENOMEM), "av_buffer_create");
+            }
+            av_frame->data[n]     = av_frame->buf[n]->data;
+            av_frame->linesize[n] = planes[n].linesize;
+        }
+        return av_frame;
+    }
+
+    FF(av_frame_get_buffer(av_frame.get(), align));
 
-    // TODO (perf) Avoid extra memcpy.
     for (int n = 0; n < planes.size(); ++n) {
         for (int y = 0; y < av_frame->height; ++y) {
             std::memcpy(av_frame->data[n] + y * av_frame->linesize[n],
@@ -40,6 +40,11 @@ core::mutable_frame     make_frame(void*                    tag,
                                    core::frame_geometry::scale_mode     = core::frame_geometry::scale_mode::stretch,
                                    bool is_straight_alpha               = false);
 
+// Has ctx decode video into buffers from frame_factory, which make_frame then hands on without copying them. Frames
+// which don't fit the frame factory's plane layout, and those of codecs which aren't intra only, are decoded into
+// ffmpeg's own buffers. frame_factory must outlive ctx.
+void set_frame_buffers(AVCodecContext* ctx, core::frame_factory& frame_factory);
+
 std::shared_ptr<AVFrame> make_av_video_frame(const core::const_frame& frame, const core::video_format_desc& format_des);
 std::shared_ptr<AVFrame> make_av_audio_frame(const core::const_frame& frame, const core::video_format_desc& format_des);
 
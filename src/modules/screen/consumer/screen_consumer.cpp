@@ -27,6 +27,7 @@ module;
 #include <SFML/Window/WindowEnums.hpp>
 #include <common/array.h>
 #include <common/diagnostics/graph.h>
+#include <common/except.h>
 #include <common/future.h>
 #include <common/gl/gl_check.h>
 #include <common/log.h>
@@ -123,8 +124,55 @@ struct configuration
     bool            always_on_top = false;
     colour_spaces   colour_space  = colour_spaces::RGB;
     bool            high_bitdepth = false;
+
+    // The rendition of the channel to show. The channel downscales it on the GPU, so small preview windows of large
+    // channels don't read back and upload full frames.
+    core::output_format preview_format = core::output_format::bgra;
 };
 
+core::output_format get_preview_format(int scale)
+{
+    switch (scale) {
+        case 1:
+            return core::output_format::bgra;
+        case 2:
+            return core::output_format::bgra_half;
+        case 4:
+            return core::output_format::bgra_quarter;
+        case 8:
+            return core::output_format::bgra_eighth;
+    }
+    CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid preview scale: " + std::to_wstring(scale)));
+}
+
+// Drops the options which can't be combined, whether they were set in the configuration or over AMCP.
+void validate(configuration& config)
+{
+    if (config.sbs_key && config.key_only) {
+        CASPAR_LOG(warning) << L" Key-only not supported with configuration of side-by-side fill and key. Ignored.";
+        config.key_only = false;
+    }
+
+    const auto datavideo = config.colour_space == configuration::colour_spaces::datavideo_full ||
+                           config.colour_space == configuration::colour_spaces::datavideo_limited;
+
+    if (datavideo && config.sbs_key) {
+        CASPAR_LOG(warning) << L" Side-by-side fill and key not supported for DataVideo TC100/TC200. Ignored.";
+        config.sbs_key = false;
+    }
+
+    if (datavideo && config.key_only) {
+        CASPAR_LOG(warning) << L" Key only not supported for DataVideo TC100/TC200. Ignored.";
+        config.key_only = false;
+    }
+
+    // The DataVideo conversion packs pairs of output pixels, which have to be those of the full-size image.
+    if (datavideo && config.preview_format != core::output_format::bgra) {
+        CASPAR_LOG(warning) << L" Preview scale not supported for DataVideo TC100/TC200. Ignored.";
+        config.preview_format = core::output_format::bgra;
+    }
+}
+
 struct frame
 {
     GLuint pbo   = 0;
@@ -148,6 +196,14 @@ struct screen_consumer
     int screen_x_      = 0;
     int screen_y_      = 0;
 
+    const int         image_width_  = format_desc_.width / core::output_format_scale(config_.preview_format);
+    const int         image_height_ = format_desc_.height / core::output_format_scale(config_.preview_format);
+    const std::size_t image_size_ =
+        core::output_format_size(config_.preview_format,
+                                 format_desc_.width,
+                                 format_desc_.height,
+                                 config_.high_bitdepth ? common::bit_depth::bit16 : common::bit_depth::bit8);
+
     std::vector<core::frame_geometry::coord> draw_coords_;
 
     sf::Window window_;
@@ -184,6 +240,10 @@ struct screen_consumer
             }
         }
 
+        // The default window, a stretch of none and side-by-side fill and key go by the size of the preview shown.
+        square_width_ /= core::output_format_scale(config_.preview_format);
+        square_height_ /= core::output_format_scale(config_.preview_format);
+
         frame_buffer_.set_capacity(1);
 
         graph_->set_color("tick-time", diagnostics::color(0.0f, 0.6f, 0.9f));
@@ -292,10 +352,9 @@ struct screen_consumer
                     screen::frame frame;
                     auto          flags = GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_MAP_WRITE_BIT;
                     GL(glCreateBuffers(1, &frame.pbo));
-                    auto size_multiplier = config_.high_bitdepth ? 2 : 1;
-                    GL(glNamedBufferStorage(frame.pbo, format_desc_.size * size_multiplier, nullptr, flags));
-                    frame.ptr = reinterpret_cast<char*>(
-                        GL2(glMapNamedBufferRange(frame.pbo, 0, format_desc_.size * size_multiplier, flags)));
+                    GL(glNamedBufferStorage(frame.pbo, image_size_, nullptr, flags));
+                    frame.ptr =
+                        reinterpret_cast<char*>(GL2(glMapNamedBufferRange(frame.pbo, 0, image_size_, flags)));
 
                     GL(glCreateTextures(GL_TEXTURE_2D, 1, &frame.tex));
                     GL(glTextureParameteri(frame.tex,
@@ -312,11 +371,8 @@ struct screen_consumer
                                                : GL_LINEAR));
                     GL(glTextureParameteri(frame.tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
                     GL(glTextureParameteri(frame.tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-                    GL(glTextureStorage2D(frame.tex,
-                                          1,
-                                          config_.high_bitdepth ? GL_RGBA16 : GL_RGBA8,
-                                          format_desc_.width,
-                                          format_desc_.height));
+                    GL(glTextureStorage2D(
+                        frame.tex, 1, config_.high_bitdepth ? GL_RGBA16 : GL_RGBA8, image_width_, image_height_));
                     GL(glClearTexImage(
                         frame.tex, 0, GL_BGRA, config_.high_bitdepth ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE, nullptr));
 
@@ -325,8 +381,7 @@ struct screen_consumer
 
                 GL(glDisable(GL_DEPTH_TEST));
                 GL(glClearColor(0.0, 0.0, 0.0, 0.0));
-                GL(glViewport(
-                    0, 0, config_.sbs_key ? format_desc_.width * 2 : format_desc_.width, format_desc_.height));
+                GL(glViewport(0, 0, config_.sbs_key ? image_width_ * 2 : image_width_, image_height_));
 
                 calculate_aspect();
 
@@ -422,16 +477,15 @@ struct screen_consumer
                 }
             }
 
-            auto size_multiplier = config_.high_bitdepth ? 2 : 1;
-            std::memcpy(frame.ptr, in_frame.image_data(0).begin(), format_desc_.size * size_multiplier);
+            std::memcpy(frame.ptr, in_frame.image_data(0).begin(), image_size_);
 
             GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frame.pbo));
             GL(glTextureSubImage2D(frame.tex,
                                    0,
                                    0,
                                    0,
-                                   format_desc_.width,
-                                   format_desc_.height,
+                                   image_width_,
+                                   image_height_,
                                    GL_BGRA,
                                    config_.high_bitdepth ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE,
                                    nullptr));
@@ -498,6 +552,15 @@ struct screen_consumer
 
     std::future<bool> send(core::video_field field, const core::const_frame& frame)
     {
+        if (config_.preview_format != core::output_format::bgra) {
+            // Frames mixed before the channel knew of this consumer have no rendition.
+            auto rendition = frame.rendition(config_.preview_format);
+            if (rendition && !frame_buffer_.try_push(rendition)) {
+                graph_->set_tag(diagnostics::tag_severity::WARNING, "dropped-frame");
+            }
+            return make_ready_future(is_running_.load());
+        }
+
         if (!frame_buffer_.try_push(frame)) {
             graph_->set_tag(diagnostics::tag_severity::WARNING, "dropped-frame");
         }
@@ -628,6 +691,8 @@ struct screen_consumer_proxy : public core::frame_consumer
 
     std::wstring name() const override { return L"screen"; }
 
+    std::vector<core::output_format> output_formats() const override { return {config_.preview_format}; }
+
     bool has_synchronization_clock() const override { return false; }
 
     int index() const override { return 600 + (config_.key_only ? 10 : 0) + config_.screen_index; }
@@ -685,12 +750,12 @@ spl::shared_ptr<core::frame_consumer> create_consumer(const std::vector<std::wst
     if (contains_param(L"HEIGHT", params)) {
         config.screen_height = get_param(L"HEIGHT", params, 0);
     }
-
-    if (config.sbs_key && config.key_only) {
-        CASPAR_LOG(warning) << L" Key-only not supported with configuration of side-by-side fill and key. Ignored.";
-        config.key_only = false;
+    if (contains_param(L"PREVIEW_SCALE", params)) {
+        config.preview_format = get_preview_format(get_param(L"PREVIEW_SCALE", params, 1));
     }
 
+    validate(config);
+
     return spl::make_shared<screen_consumer_proxy>(config);
 }
 
@@ -717,6 +782,7 @@ create_preconfigured_consumer(const boost::property_tree::wptree&
     config.interactive   = ptree.get(L"interactive", config.interactive);
     config.borderless    = ptree.get(L"borderless", config.borderless);
     config.always_on_top = ptree.get(L"always-on-top", config.always_on_top);
+    config.preview_format = get_preview_format(ptree.get(L"preview-scale", 1));
 
     auto colour_space_value = ptree.get(L"colour-space", L"RGB");
     config.colour_space     = configuration::colour_spaces::RGB;
@@ -725,24 +791,7 @@ create_preconfigured_consumer(const boost::property_tree::wptree&
     else if (colour_space_value == L"datavideo-limited")
         config.colour_space = configuration::colour_spaces::datavideo_limited;
 
-    if (config.sbs_key && config.key_only) {
-        CASPAR_LOG(warning) << L" Key-only not supported with configuration of side-by-side fill and key. Ignored.";
-        config.key_only = false;
-    }
-
-    if ((config.colour_space == configuration::colour_spaces::datavideo_full ||
-         config.colour_space == configuration::colour_spaces::datavideo_limited) &&
-        config.sbs_key) {
-        CASPAR_LOG(warning) << L" Side-by-side fill and key not supported for DataVideo TC100/TC200. Ignored.";
-        config.sbs_key = false;
-    }
-
-    if ((config.colour_space == configuration::colour_spaces::datavideo_full ||
-         config.colour_space == configuration::colour_spaces::datavideo_limited) &&
-        config.key_only) {
-        CASPAR_LOG(warning) << L" Key only not supported for DataVideo TC100/TC200. Ignored.";
-        config.key_only = false;
-    }
+    validate(config);
 
     auto stretch_str = ptree.get(L"stretch", L"fill");
     if (stretch_str == L"none") {
@@ -42,6 +42,7 @@ import caspar.modules.screen;
 #include <core/diagnostics/osd_graph.h>
 #include <core/frame/pixel_format.h>
 #include <core/mixer/image/image_mixer.h>
+#include <core/mixer/mixer.h>
 #include <core/producer/cg_proxy.h>
 #include <core/producer/color/color_producer.h>
 #include <core/producer/frame_producer.h>
@@ -281,6 +282,24 @@ struct server::impl
             if (format_desc.format == video_format::invalid)
                 CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid video-mode: " + format_desc_str));
 
+            auto parallel_produce = xml_channel.second.get(L"parallel-produce", false);
+            auto pipeline_depth   = xml_channel.second.get(L"pipeline-depth", 1);
+            if (pipeline_depth < 1)
+                CASPAR_THROW_EXCEPTION(user_error()
+                                       << msg_info(L"Invalid pipeline-depth: " + std::to_wstring(pipeline_depth)));
+
+            auto readback_depth = xml_channel.second.get(L"readback-depth", 2);
+            if (readback_depth < 1)
+                CASPAR_THROW_EXCEPTION(user_error()
+                                       << msg_info(L"Invalid readback-depth: " + std::to_wstring(readback_depth)));
+
+            auto accelerator_device = xml_channel.second.get(L"accelerator-device", 0);
+
+            auto gain_ramp_str = boost::to_lower_copy(xml_channel.second.get(L"audio-gain-ramp", L"linear"));
+            if (gain_ramp_str != L"linear" && gain_ramp_str != L"equal-power")
+                CASPAR_THROW_EXCEPTION(user_error()
+                                       << msg_info(L"Invalid audio-gain-ramp, must be linear or equal-power"));
+
             auto weak_client = std::weak_ptr<osc::client>(osc_client_);
             auto channel_id  = static_cast<int>(channels_->size() + 1);
             auto depth       = color_depth == 16 ? common::bit_depth::bit16 : common::bit_depth::bit8;
@@ -290,7 +309,10 @@ struct server::impl
                 spl::make_shared<video_channel>(channel_id,
                                                 format_desc,
                                                 default_color_space,
-                                                accelerator_.create_image_mixer(channel_id, depth),
+                                                parallel_produce,
+                                                pipeline_depth,
+                                                readback_depth,
+                                                accelerator_.create_image_mixer(channel_id, depth, accelerator_device),
                                                 [channel_id, weak_client](core::monitor::state channel_state) {
                                                     monitor::state state;
                                                     state[""]["channel"][channel_id] = channel_state;
@@ -300,6 +322,9 @@ struct server::impl
                                                     }
                                                 });
 
+            channel->mixer().set_audio_gain_ramp(gain_ramp_str == L"equal-power" ? core::audio_gain_ramp::equal_power
+                                                                                  : core::audio_gain_ramp::linear);
+
             const std::wstring lifecycle_key = L"lock" + std::to_wstring(channel_id);
             channels_->emplace_back(channel, channel->stage(), lifecycle_key);
         }